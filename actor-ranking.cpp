@@ -0,0 +1,140 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include "actor-ranking.h"
+#include "replacement-file.h"
+
+const char *const actorRanking::kRankingFileName = "ranking.data";
+
+namespace {
+
+const int32_t kMagic = 0x4b4e4152; // "RANK"
+const int32_t kVersion = 2;
+
+/**
+ * Function: rankBy
+ * ----------------
+ * Actor ids 1 through scores.size() - 1, highest score first, ties by id.
+ */
+template <typename T>
+vector<int32_t> rankBy(const vector<T>& scores)
+{
+    vector<int32_t> ids(scores.size() - 1);
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = i + 1;
+    stable_sort(ids.begin(), ids.end(), [&scores](const int32_t a, const int32_t b) { return scores[a] > scores[b]; });
+    return ids;
+}
+
+}
+
+actorRanking::actorRanking(const string& directory) : fd(-1), fileSize(0), fileMap(NULL)
+{
+    const string fileName = directory + "/" + kRankingFileName;
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) != 0 || (size_t) stats.st_size < sizeof(header)) return;
+    fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) return;
+    fileSize = stats.st_size;
+    void *mapped = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return;
+    fileMap = mapped;
+
+    const header *h = getHeader();
+    if (h->magic != kMagic || h->version != kVersion || h->numActors < 0 ||
+        h->source != imdb::readFingerprint(directory) ||
+        (size_t) h->rankingsOffset + kMetricCount * sizeof(int32_t) * h->numActors > fileSize) {
+        munmap((char *) fileMap, fileSize);
+        fileMap = NULL;
+    }
+}
+
+actorRanking::~actorRanking()
+{
+    if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+    if (fd != -1) close(fd);
+}
+
+bool actorRanking::good() const
+{
+    return fileMap != NULL;
+}
+
+int actorRanking::getActorCount() const
+{
+    return getHeader()->numActors;
+}
+
+int actorRanking::getSampledSources() const
+{
+    return getHeader()->sampledSources;
+}
+
+int actorRanking::getDegree(const int actorId) const
+{
+    return getBlock<int32_t>(getHeader()->degreesOffset)[actorId];
+}
+
+int actorRanking::getCostarCount(const int actorId) const
+{
+    return getBlock<int32_t>(getHeader()->costarsOffset)[actorId];
+}
+
+double actorRanking::getBetweenness(const int actorId) const
+{
+    return getBlock<float>(getHeader()->betweennessOffset)[actorId];
+}
+
+int actorRanking::getRanked(const metric by, const int rank) const
+{
+    const header *h = getHeader();
+    return getBlock<int32_t>(h->rankingsOffset)[int64_t(by) * h->numActors + rank];
+}
+
+bool actorRanking::write(const string& directory, const vector<int32_t>& degrees, const vector<int32_t>& costars,
+                         const vector<float>& betweenness, const int sampledSources,
+                         const imdb::fingerprint& source)
+{
+    const int numActors = degrees.size() - 1;
+    header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.numActors = numActors;
+    h.sampledSources = sampledSources;
+    h.source = source;
+    h.degreesOffset = sizeof(header);
+    h.costarsOffset = h.degreesOffset + (numActors + 1) * sizeof(int32_t);
+    h.betweennessOffset = h.costarsOffset + (numActors + 1) * sizeof(int32_t);
+    h.rankingsOffset = h.betweennessOffset + (numActors + 1) * sizeof(float);
+
+    const string fileName = directory + "/" + kRankingFileName;
+    replacementFile file(fileName);
+    if (!file.good()) return false;
+    ofstream& out = file.stream();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    writeBlock(out, degrees);
+    writeBlock(out, costars);
+    writeBlock(out, betweenness);
+    writeBlock(out, rankBy(degrees));
+    writeBlock(out, rankBy(costars));
+    writeBlock(out, rankBy(betweenness));
+    return file.commit();
+}
+
+const actorRanking::header *actorRanking::getHeader() const
+{
+    return static_cast<const header*>(fileMap);
+}
+
+template <typename T>
+const T *actorRanking::getBlock(const int64_t offset) const
+{
+    return reinterpret_cast<const T*>(static_cast<const char*>(fileMap) + offset);
+}
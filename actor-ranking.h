@@ -0,0 +1,116 @@
+#ifndef __actor_ranking__
+#define __actor_ranking__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: actorRanking
+ * -------------------
+ * How central each actor is, precomputed by imdb-centrality, by three
+ * measures: degree (the number of credits), costar count (the number of
+ * distinct actors sharing at least one credit) and betweenness (roughly,
+ * how many shortest paths between other actors run through this one,
+ * estimated from a sample of sources).
+ *
+ * The file, ranking.data, lives next to the data files and is mmapped:
+ *
+ *     header                       counts, offsets, and the data files' fingerprint
+ *     degrees[numActors + 1]       int32, indexed by actor id
+ *     costars[numActors + 1]       int32
+ *     betweenness[numActors + 1]   float
+ *     rankings[3][numActors]       actor ids, most central first, one list per metric
+ *
+ * Scores are only as current as the data files they were computed from,
+ * so the header records those files' fingerprint (see imdb::fingerprint),
+ * and a ranking.data the data files or credits.delta have since changed
+ * under is stale and not mapped.
+ */
+
+class actorRanking {
+
+ public:
+  enum metric { kDegree, kCostars, kBetweenness, kMetricCount };
+
+  /**
+   * Constructor: actorRanking
+   * -------------------------
+   * Maps directory/ranking.data, unless it is stale.  Use write to create it.
+   */
+  actorRanking(const string& directory);
+  ~actorRanking();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the ranking file was found, mapped and looks
+   * sane, and was computed from the data files and delta in the directory.
+   */
+  bool good() const;
+
+  int getActorCount() const;
+
+  /**
+   * Method: getSampledSources
+   * -------------------------
+   * @return how many BFS sources the betweenness estimate was made from
+   */
+  int getSampledSources() const;
+
+  int getDegree(const int actorId) const;
+  int getCostarCount(const int actorId) const;
+  double getBetweenness(const int actorId) const;
+
+  /**
+   * Method: getRanked
+   * -----------------
+   * @return the id of the actor ranked rank (0 being the most central) by
+   *         the metric; ties go to the lower id
+   */
+  int getRanked(const metric by, const int rank) const;
+
+  /**
+   * Static Method: write
+   * --------------------
+   * Ranks the actors by each metric and writes directory/ranking.data.
+   * The score vectors are indexed by actor id, entry 0 unused.
+   *
+   * @param source the fingerprint of the imdb the scores were computed from
+   *
+   * @return true if and only if the file was written successfully
+   */
+  static bool write(const string& directory, const vector<int32_t>& degrees, const vector<int32_t>& costars,
+                    const vector<float>& betweenness, const int sampledSources,
+                    const imdb::fingerprint& source);
+
+  // the ranking file's name within the data directory (ranking.data)
+  static const char *const kRankingFileName;
+
+ private:
+  struct header {
+    int32_t magic;
+    int32_t version;
+    int32_t numActors;
+    int32_t sampledSources;
+    int64_t degreesOffset;
+    int64_t costarsOffset;
+    int64_t betweennessOffset;
+    int64_t rankingsOffset;
+    imdb::fingerprint source;
+  };
+
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  const header *getHeader() const;
+  template <typename T> const T *getBlock(const int64_t offset) const;
+
+  actorRanking(const actorRanking& original);
+  actorRanking& operator=(const actorRanking& rhs);
+};
+
+#endif
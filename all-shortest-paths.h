@@ -0,0 +1,320 @@
+#ifndef __all_shortest_paths__
+#define __all_shortest_paths__
+
+#include "path-count.h"
+#include "search-filter.h"
+#include "query-options.h"
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+/**
+ * Class: allShortestPaths
+ * -----------------------
+ * Every shortest path between two actors, rather than the one graphSearch
+ * happens to find first.  build runs a breadth first search level by level
+ * and keeps, for every actor and movie it reaches, its depth and the number
+ * of shortest paths from the source to it: a movie first reached at depth d
+ * collects the counts of its depth d - 1 cast, and an actor first reached at
+ * depth d collects the counts of its depth d movies.  Those depths are the
+ * shortest path DAG; it is never stored as edges, since stepping back from
+ * an actor to its movies one level up (or from a movie to its cast one
+ * level up) is just a filter on the ordinary adjacency lists.
+ *
+ * nextPath walks the DAG backwards from the target, depth first, and so
+ * hands the paths out one at a time in a fixed order while holding only the
+ * one path it is on.  Every actor and movie in the DAG leads back to the
+ * source, so the walk never wanders into a dead end.
+ *
+ * Graph is anything graphSearch can search.  As with graphSearch, marks are
+ * stamped per build, so one allShortestPaths serves any number of queries,
+ * and queryOptions can bound how long a build runs and how big its
+ * frontier grows.
+ */
+
+template <typename Graph>
+class allShortestPaths {
+
+ public:
+
+  /**
+   * Constructor: allShortestPaths
+   * -----------------------------
+   * @param graph the adjacency to search; it must outlive the allShortestPaths
+   */
+  allShortestPaths(const Graph& graph) : graph(graph), stamp(0), length(-1),
+    actorSeen(graph.getActorCount() + 1, 0), movieSeen(graph.getMovieCount() + 1, 0),
+    actorDepth(graph.getActorCount() + 1, 0), movieDepth(graph.getMovieCount() + 1, 0),
+    actorPaths(graph.getActorCount() + 1), moviePaths(graph.getMovieCount() + 1), height(0), exhausted(true) {}
+
+  /**
+   * Method: build
+   * -------------
+   * Finds the depth of the target and counts the shortest paths to it,
+   * and gets nextPath ready to list them.
+   *
+   * @param source the id of the starting actor
+   * @param target the id of the actor being searched for
+   * @param maxDepth the longest path (in movies) worth looking for
+   * @return true if and only if there are paths of at most maxDepth movies
+   */
+  bool build(const int source, const int target, const int maxDepth)
+  {
+    return search(source, target, maxDepth, noFilter(), noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: build
+   * -------------
+   * As above, but only through the movies and actors the filter allows.
+   */
+  bool build(const int source, const int target, const int maxDepth, const searchFilter& filter)
+  {
+    return filteredSearch(source, target, maxDepth, filter, noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: build
+   * -------------
+   * Either of the above, but giving up once the options say so, in which
+   * case there are no paths to list.
+   *
+   * @return kPathFound, kNoPath, or why the build was given up
+   */
+  queryStatus build(const int source, const int target, const int maxDepth, const queryOptions& options)
+  {
+    return search(source, target, maxDepth, noFilter(), options);
+  }
+
+  queryStatus build(const int source, const int target, const int maxDepth, const searchFilter& filter,
+                    const queryOptions& options)
+  {
+    return filteredSearch(source, target, maxDepth, filter, options);
+  }
+
+  /**
+   * Methods: getLength
+   *          getCount
+   * ------------------
+   * The number of movies on each of the paths the last build found, or -1
+   * if it found none, and how many paths there are.
+   */
+  int getLength() const { return length; }
+  const pathCount& getCount() const { return count; }
+
+  /**
+   * Method: nextPath
+   * ----------------
+   * @param hops cleared and filled with the next path, in the same form
+   *             graphSearch::shortestPath uses: alternating movie and
+   *             actor ids, ending with the target
+   * @return false once every path has been handed out
+   */
+  bool nextPath(vector<int>& hops)
+  {
+    hops.clear();
+    if (exhausted) return false;
+    if (height == 0) {
+      push(target);
+      descend();
+    } else if (!advance()) {
+      exhausted = true;
+      return false;
+    }
+    for (size_t i = height - 1; i-- > 0;) hops.push_back(trail[i].node);
+    return true;
+  }
+
+  /**
+   * Method: rewind
+   * --------------
+   * Starts the paths of the last build over from the first.
+   */
+  void rewind()
+  {
+    height = 0;
+    exhausted = length < 0;
+  }
+
+ private:
+  const Graph& graph;
+  unsigned stamp;
+  int source, target, length;
+  pathCount count;
+  vector<unsigned> actorSeen, movieSeen;
+  vector<int> actorDepth, movieDepth;
+  vector<pathCount> actorPaths, moviePaths;
+  vector<int> frontier, next, levelMovies, credits, cast;
+
+  // the path being listed, target first: actors at even heights, movies at odd ones
+  struct frame {
+    int node;
+    vector<int> choices;  // the nodes one level nearer the source
+    size_t chosen;
+  };
+  vector<frame> trail;
+  size_t height;
+  bool exhausted;
+
+  // edges looked at between checks of the query options
+  static constexpr size_t kCheckInterval = 1 << 16;
+
+  struct noFilter {
+    bool allowsMovie(const int) const { return true; }
+    bool allowsActor(const int) const { return true; }
+  };
+
+  struct noLimits {
+    queryStatus check(const size_t) const { return kSearching; }
+  };
+
+  template <typename Limits>
+  queryStatus filteredSearch(const int from, const int to, const int maxDepth, const searchFilter& filter,
+                             const Limits& limits)
+  {
+    if (!filter.allowsActor(from) || !filter.allowsActor(to)) {
+      length = -1;
+      exhausted = true;
+      return kNoPath;
+    }
+    return search(from, to, maxDepth, filter, limits);
+  }
+
+  template <typename Filter, typename Limits>
+  queryStatus search(const int from, const int to, const int maxDepth, const Filter& filter, const Limits& limits)
+  {
+    if (++stamp == 0) resetStamps();
+    source = from;
+    target = to;
+    length = -1;
+
+    frontier.assign(1, source);
+    reachActor(source, 0);
+    actorPaths[source] = pathCount(1);
+    size_t work = 0, nextCheck = kCheckInterval;
+
+    for (int depth = 0; depth < maxDepth && !frontier.empty() && actorSeen[target] != stamp; ++depth) {
+      levelMovies.clear();
+      for (size_t n = 0; n < frontier.size(); ++n) {
+        const int actor = frontier[n];
+        graph.getCreditIds(actor, credits);
+        for (size_t f = 0; f < credits.size(); ++f) {
+          const int movie = credits[f];
+          if (!filter.allowsMovie(movie)) continue;
+          if (movieSeen[movie] != stamp) {
+            reachMovie(movie, depth + 1);
+            levelMovies.push_back(movie);
+          }
+          if (movieDepth[movie] == depth + 1) moviePaths[movie].add(actorPaths[actor]);
+        }
+      }
+
+      // every movie of this level has its full count before any of its cast takes it up
+      next.clear();
+      for (size_t m = 0; m < levelMovies.size(); ++m) {
+        const int movie = levelMovies[m];
+        graph.getCastIds(movie, cast);
+        for (size_t p = 0; p < cast.size(); ++p) {
+          const int costar = cast[p];
+          if (!filter.allowsActor(costar)) continue;
+          if (actorSeen[costar] != stamp) {
+            reachActor(costar, depth + 1);
+            next.push_back(costar);
+          }
+          if (actorDepth[costar] == depth + 1) actorPaths[costar].add(moviePaths[movie]);
+        }
+
+        if ((work += cast.size()) >= nextCheck) {
+          nextCheck = work + kCheckInterval;
+          const size_t bytes = (frontier.capacity() + next.capacity() + levelMovies.capacity()) * sizeof(int);
+          const queryStatus status = limits.check(bytes);
+          if (status != kSearching) {
+            rewind();
+            return status;
+          }
+        }
+      }
+      frontier.swap(next);
+    }
+
+    if (actorSeen[target] == stamp) {
+      length = actorDepth[target];
+      count = actorPaths[target];
+    }
+    rewind();
+    return length >= 0 ? kPathFound : kNoPath;
+  }
+
+  void reachActor(const int actor, const int depth)
+  {
+    actorSeen[actor] = stamp;
+    actorDepth[actor] = depth;
+    actorPaths[actor] = pathCount();
+  }
+
+  void reachMovie(const int movie, const int depth)
+  {
+    movieSeen[movie] = stamp;
+    movieDepth[movie] = depth;
+    moviePaths[movie] = pathCount();
+  }
+
+  // pushes node onto the trail, listing the nodes it can be reached from
+  void push(const int node)
+  {
+    if (trail.size() == height) trail.push_back(frame());
+    frame& top = trail[height++];
+    top.node = node;
+    top.chosen = 0;
+    top.choices.clear();
+
+    if (height % 2 == 1) {
+      const int depth = actorDepth[node];
+      if (depth == 0) return; // the source
+      graph.getCreditIds(node, credits);
+      for (size_t f = 0; f < credits.size(); ++f) {
+        if (movieSeen[credits[f]] == stamp && movieDepth[credits[f]] == depth) top.choices.push_back(credits[f]);
+      }
+    } else {
+      const int depth = movieDepth[node];
+      graph.getCastIds(node, cast);
+      for (size_t p = 0; p < cast.size(); ++p) {
+        if (actorSeen[cast[p]] == stamp && actorDepth[cast[p]] == depth - 1) top.choices.push_back(cast[p]);
+      }
+    }
+  }
+
+  // follows the first choice at every step until the trail reaches the source
+  void descend()
+  {
+    while (!trail[height - 1].choices.empty()) push(trail[height - 1].choices[0]);
+  }
+
+  // moves the trail on to the next path, or returns false if there isn't one
+  bool advance()
+  {
+    height--; // the source
+    while (height > 0) {
+      frame& top = trail[height - 1];
+      if (++top.chosen < top.choices.size()) {
+        push(top.choices[top.chosen]);
+        descend();
+        return true;
+      }
+      height--;
+    }
+    return false;
+  }
+
+  void resetStamps()
+  {
+    fill(actorSeen.begin(), actorSeen.end(), 0);
+    fill(movieSeen.begin(), movieSeen.end(), 0);
+    stamp = 1;
+  }
+
+  allShortestPaths(const allShortestPaths& original);
+  allShortestPaths& operator=(const allShortestPaths& rhs);
+};
+
+#endif
@@ -0,0 +1,35 @@
+using namespace std;
+#include <time.h>
+#include "bench-utils.h"
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint64_t splitMix(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+vector<pair<int, int> > pickPairs(const imdb& db, const int count, uint64_t seed)
+{
+    vector<pair<int, int> > pairs;
+    vector<int> credits;
+    while ((int) pairs.size() < count) {
+        int actors[2];
+        for (int i = 0; i < 2; i++) {
+            do {
+                actors[i] = 1 + splitMix(seed) % db.getActorCount();
+                db.getCreditIds(actors[i], credits);
+            } while (credits.empty());
+        }
+        if (actors[0] != actors[1]) pairs.push_back(make_pair(actors[0], actors[1]));
+    }
+    return pairs;
+}
@@ -0,0 +1,42 @@
+#ifndef __bench_utils__
+#define __bench_utils__
+
+#include "imdb.h"
+#include <vector>
+#include <utility>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Helpers the tools share for timing themselves and for drawing the same
+ * random actors from the same --seed.
+ */
+
+/**
+ * Function: now
+ * -------------
+ * Monotonic wall clock, in seconds.
+ */
+double now();
+
+/**
+ * Function: splitMix
+ * ------------------
+ * SplitMix64: advances state and returns the next 64 random bits.  Every
+ * seeded choice the tools and libsixdegrees make goes through it, so a
+ * seed picks the same actors wherever it is given.  Called on a copy of a
+ * key, it is a good 64-bit hash of the key.
+ */
+uint64_t splitMix(uint64_t& state);
+
+/**
+ * Function: pickPairs
+ * -------------------
+ * Picks pairs of distinct actors with at least one credit each, as the
+ * benchmarks and imdb-verify query them.
+ *
+ * @return count pairs of actor ids, the same ones for the same seed
+ */
+vector<pair<int, int> > pickPairs(const imdb& db, const int count, uint64_t seed);
+
+#endif
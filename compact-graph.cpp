@@ -0,0 +1,370 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include "compact-graph.h"
+#include "replacement-file.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMPACT_GRAPH_SSSE3 1
+#endif
+
+const char *const compactGraph::kGraphFileName = "graph.vbyte";
+
+namespace {
+
+const int32_t kMagic = 0x48505247; // "GRPH"
+const int32_t kVersion = 2;
+
+// the decoder reads whole 16 byte blocks, so the data section carries this much slack
+const int kSlackBytes = 16;
+
+// how much of a packed list prefetchCredits/prefetchCast bring in
+const int kPrefetchBytes = 256;
+const int kCacheLineBytes = 64;
+
+/**
+ * Class: streamVByteTables
+ * ------------------------
+ * For each of the 256 control bytes: the number of data bytes the group of
+ * four uses, and the pshufb mask that spreads those bytes into four 32-bit lanes.
+ */
+struct streamVByteTables {
+    uint8_t length[256];
+    uint8_t shuffle[256][16];
+
+    streamVByteTables()
+    {
+        for (int control = 0; control < 256; ++control) {
+            int source = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                const int bytes = ((control >> (2*lane)) & 3) + 1;
+                for (int b = 0; b < 4; ++b) {
+                    shuffle[control][4*lane + b] = (b < bytes) ? source++ : 0x80; // 0x80 zeroes the byte
+                }
+            }
+            length[control] = source;
+        }
+    }
+};
+
+const streamVByteTables kTables;
+
+/**
+ * Function: decodeTail
+ * --------------------
+ * Scalar Stream VByte decode of values [first, count), continuing the
+ * running sum from prev.
+ */
+void decodeTail(const uint8_t *control, const uint8_t *data, int first, int count, int prev, int *out)
+{
+    for (int i = first; i < count; ++i) {
+        const int bytes = ((control[i / 4] >> (2*(i % 4))) & 3) + 1;
+        uint32_t delta = 0;
+        for (int b = 0; b < bytes; ++b) delta |= (uint32_t) data[b] << (8*b);
+        data += bytes;
+        prev += delta;
+        out[i] = prev;
+    }
+}
+
+#ifdef COMPACT_GRAPH_SSSE3
+__attribute__((target("ssse3")))
+void decodeSsse3(const uint8_t *in, int count, int *out)
+{
+    const uint8_t *control = in;
+    const uint8_t *data = in + (count + 3) / 4;
+    const int groups = count / 4;
+
+    __m128i prev = _mm_setzero_si128();
+    for (int g = 0; g < groups; ++g) {
+        const uint8_t c = control[g];
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        v = _mm_shuffle_epi8(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kTables.shuffle[c])));
+        data += kTables.length[c];
+
+        // undo the delta encoding: in-register prefix sum, plus the last id of the previous group
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, prev);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4*g), v);
+        prev = _mm_shuffle_epi32(v, 0xFF);
+    }
+    decodeTail(control, data, 4*groups, count, groups > 0 ? out[4*groups - 1] : 0, out);
+}
+#endif
+
+}
+
+compactGraph::compactGraph(const string& directory) : fd(-1), fileSize(0), fileMap(NULL)
+{
+    const string fileName = directory + "/" + kGraphFileName;
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) != 0 || (size_t) stats.st_size < sizeof(header)) return;
+    fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) return;
+    fileSize = stats.st_size;
+    void *mapped = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return;
+    fileMap = mapped;
+
+    const header *h = getHeader();
+    if (h->magic != kMagic || h->version != kVersion || (size_t) h->dataOffset > fileSize ||
+        h->source != imdb::readFingerprint(directory)) {
+        munmap((char *) fileMap, fileSize);
+        fileMap = NULL;
+    }
+}
+
+compactGraph::compactGraph() : fd(-1), fileSize(0), fileMap(NULL) {}
+
+compactGraph *compactGraph::replicate(const compactGraph& original)
+{
+    compactGraph *replica = new compactGraph();
+    if (!original.good()) return replica;
+    void *memory = mmap(0, original.fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return replica;
+    memcpy(memory, original.fileMap, original.fileSize);
+    mprotect(memory, original.fileSize, PROT_READ);
+    replica->fileSize = original.fileSize;
+    replica->fileMap = memory;
+    return replica;
+}
+
+bool compactGraph::good() const
+{
+    return fileMap != NULL;
+}
+
+compactGraph::~compactGraph()
+{
+    if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+    if (fd != -1) close(fd);
+}
+
+int compactGraph::getActorCount() const
+{
+    return getHeader()->numActors;
+}
+
+int compactGraph::getMovieCount() const
+{
+    return getHeader()->numMovies;
+}
+
+int64_t compactGraph::getEdgeCount() const
+{
+    return getHeader()->numEdges;
+}
+
+size_t compactGraph::getFileSize() const
+{
+    return fileSize;
+}
+
+const imdb::fingerprint& compactGraph::getFingerprint() const
+{
+    return getHeader()->source;
+}
+
+void compactGraph::getCreditIds(const int actorId, vector<int>& movieIds) const
+{
+    const header *h = getHeader();
+    decode(getData() + getStarts(h->creditStartsOffset)[actorId],
+           getCounts(h->creditCountsOffset)[actorId], movieIds);
+}
+
+void compactGraph::getCastIds(const int movieId, vector<int>& actorIds) const
+{
+    const header *h = getHeader();
+    decode(getData() + getStarts(h->castStartsOffset)[movieId],
+           getCounts(h->castCountsOffset)[movieId], actorIds);
+}
+
+void compactGraph::prefetchCreditIndex(const int actorId) const
+{
+    const header *h = getHeader();
+    __builtin_prefetch(getStarts(h->creditStartsOffset) + actorId);
+    __builtin_prefetch(getCounts(h->creditCountsOffset) + actorId);
+}
+
+void compactGraph::prefetchCredits(const int actorId) const
+{
+    const header *h = getHeader();
+    const int64_t *starts = getStarts(h->creditStartsOffset) + actorId;
+    prefetchList(getData() + starts[0], actorId < h->numActors ? starts[1] - starts[0] : kPrefetchBytes);
+}
+
+void compactGraph::prefetchCastIndex(const int movieId) const
+{
+    const header *h = getHeader();
+    __builtin_prefetch(getStarts(h->castStartsOffset) + movieId);
+    __builtin_prefetch(getCounts(h->castCountsOffset) + movieId);
+}
+
+void compactGraph::prefetchCast(const int movieId) const
+{
+    const header *h = getHeader();
+    const int64_t *starts = getStarts(h->castStartsOffset) + movieId;
+    prefetchList(getData() + starts[0], movieId < h->numMovies ? starts[1] - starts[0] : kPrefetchBytes);
+}
+
+void compactGraph::prefetchList(const uint8_t *list, const int64_t bytes)
+{
+    for (int64_t i = 0; i < min<int64_t>(bytes, kPrefetchBytes); i += kCacheLineBytes) __builtin_prefetch(list + i);
+}
+
+/*
+ * *********************************************************************************************
+ * Codec
+ * *********************************************************************************************
+ */
+
+void compactGraph::encode(vector<int> ids, vector<uint8_t>& out)
+{
+    sort(ids.begin(), ids.end());
+    const size_t controlStart = out.size();
+    out.resize(out.size() + (ids.size() + 3) / 4, 0);
+
+    int prev = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        uint32_t delta = ids[i] - prev;
+        prev = ids[i];
+        const int bytes = delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+        out[controlStart + i / 4] |= (bytes - 1) << (2*(i % 4));
+        for (int b = 0; b < bytes; ++b) out.push_back((delta >> (8*b)) & 0xff);
+    }
+}
+
+void compactGraph::decode(const uint8_t *in, int count, vector<int>& ids)
+{
+    ids.resize(count);
+    if (count == 0) return;
+#ifdef COMPACT_GRAPH_SSSE3
+    if (hasSimdDecode()) {
+        decodeSsse3(in, count, &ids[0]);
+        return;
+    }
+#endif
+    decodeScalar(in, count, ids);
+}
+
+void compactGraph::decodeScalar(const uint8_t *in, int count, vector<int>& ids)
+{
+    ids.resize(count);
+    if (count == 0) return;
+    const uint8_t *control = in;
+    const uint8_t *data = in + (count + 3) / 4;
+    decodeTail(control, data, 0, count, 0, &ids[0]);
+}
+
+bool compactGraph::hasSimdDecode()
+{
+#ifdef COMPACT_GRAPH_SSSE3
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+/*
+ * *********************************************************************************************
+ * Building
+ * *********************************************************************************************
+ */
+
+bool compactGraph::build(const imdb& db, const string& directory)
+{
+    const int numActors = db.getActorCount();
+    const int numMovies = db.getMovieCount();
+
+    header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.numActors = numActors;
+    h.numMovies = numMovies;
+    h.source = db.getFingerprint();
+    h.creditStartsOffset = sizeof(header);
+    h.castStartsOffset = h.creditStartsOffset + (numActors + 1) * sizeof(int64_t);
+    h.creditCountsOffset = h.castStartsOffset + (numMovies + 1) * sizeof(int64_t);
+    h.castCountsOffset = h.creditCountsOffset + (numActors + 1) * sizeof(int32_t);
+    h.dataOffset = h.castCountsOffset + (numMovies + 1) * sizeof(int32_t);
+    h.dataOffset += (8 - h.dataOffset % 8) % 8;
+
+    const string fileName = directory + "/" + kGraphFileName;
+    replacementFile file(fileName);
+    if (!file.good()) return false;
+    ofstream& out = file.stream();
+
+    // stream the packed lists out first, remembering where each one went
+    vector<int64_t> creditStarts(numActors + 1, 0), castStarts(numMovies + 1, 0);
+    vector<int32_t> creditCounts(numActors + 1, 0), castCounts(numMovies + 1, 0);
+    vector<int> ids;
+    vector<uint8_t> packed;
+    int64_t dataBytes = 0;
+    out.seekp(h.dataOffset);
+    for (int actor = 1; actor <= numActors; ++actor) {
+        db.getCreditIds(actor, ids);
+        packed.clear();
+        encode(ids, packed);
+        creditStarts[actor] = dataBytes;
+        creditCounts[actor] = ids.size();
+        h.numEdges += ids.size();
+        writeBlock(out, packed);
+        dataBytes += packed.size();
+    }
+    for (int movie = 1; movie <= numMovies; ++movie) {
+        db.getCastIds(movie, ids);
+        packed.clear();
+        encode(ids, packed);
+        castStarts[movie] = dataBytes;
+        castCounts[movie] = ids.size();
+        writeBlock(out, packed);
+        dataBytes += packed.size();
+    }
+    writeBlock(out, vector<uint8_t>(kSlackBytes, 0));
+
+    // then go back for the header and the index
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    writeBlock(out, creditStarts);
+    writeBlock(out, castStarts);
+    writeBlock(out, creditCounts);
+    writeBlock(out, castCounts);
+    return file.commit();
+}
+
+/*
+ * *********************************************************************************************
+ * File layout
+ * *********************************************************************************************
+ */
+
+const compactGraph::header *compactGraph::getHeader() const
+{
+    return static_cast<const header*>(fileMap);
+}
+
+const int64_t *compactGraph::getStarts(const int64_t offset) const
+{
+    return reinterpret_cast<const int64_t*>(static_cast<const char*>(fileMap) + offset);
+}
+
+const int32_t *compactGraph::getCounts(const int64_t offset) const
+{
+    return reinterpret_cast<const int32_t*>(static_cast<const char*>(fileMap) + offset);
+}
+
+const uint8_t *compactGraph::getData() const
+{
+    return static_cast<const uint8_t*>(fileMap) + getHeader()->dataOffset;
+}
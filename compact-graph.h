@@ -0,0 +1,182 @@
+#ifndef __compact_graph__
+#define __compact_graph__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: compactGraph
+ * -------------------
+ * A compressed copy of the actor/movie adjacency held in actors.data and
+ * movies.data, for machines where the raw 4-byte offsets don't fit in the
+ * page cache.  Each credit and cast list is stored as sorted ids, delta
+ * encoded and packed with Stream VByte: a run of 2-bit length codes
+ * (4 per control byte) followed by the 1-4 byte deltas themselves.  Groups
+ * of four are decoded with a single SSSE3 shuffle where the CPU has one.
+ *
+ * The file, graph.vbyte, lives next to the data files and is mmapped:
+ *
+ *     header                        counts, section offsets, and the data files' fingerprint
+ *     creditStarts[numActors + 1]   byte offset of each actor's list in the data section
+ *     castStarts[numMovies + 1]     byte offset of each movie's list in the data section
+ *     creditCounts[numActors + 1]   list lengths
+ *     castCounts[numMovies + 1]
+ *     data                          the packed lists, followed by 16 bytes of slack
+ *                                   so the decoder may over-read the last one
+ *
+ * compactGraph offers the same id-level interface as imdb, so graphSearch
+ * traverses it directly.  Names and titles still come from the imdb.
+ */
+
+class compactGraph {
+
+ public:
+
+  /**
+   * Constructor: compactGraph
+   * -------------------------
+   * Maps directory/graph.vbyte.  Use build to create it.  A graph built
+   * from other data files than the directory holds now, or before a change
+   * to its credits.delta, is stale (see imdb::fingerprint) and not mapped.
+   *
+   * @param directory the directory housing the imdb data files
+   */
+  compactGraph(const string& directory);
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the graph file was found, mapped and looks
+   * sane, and was built from the data files and delta in the directory.
+   */
+  bool good() const;
+
+  int getActorCount() const;
+  int getMovieCount() const;
+
+  /**
+   * Methods: getCreditIds
+   *          getCastIds
+   * ---------------------
+   * Same contract as imdb::getCreditIds/imdb::getCastIds, except that
+   * both lists come back sorted by id.
+   */
+  void getCreditIds(const int actorId, vector<int>& movieIds) const;
+  void getCastIds(const int movieId, vector<int>& actorIds) const;
+
+  /**
+   * Methods: prefetchCreditIndex
+   *          prefetchCredits
+   *          prefetchCastIndex
+   *          prefetchCast
+   * ---------------------
+   * Same contract as the imdb methods of the same names: the Index forms
+   * prefetch the id's start and count, the others read the start and
+   * prefetch the head of the packed list.
+   */
+  void prefetchCreditIndex(const int actorId) const;
+  void prefetchCredits(const int actorId) const;
+  void prefetchCastIndex(const int movieId) const;
+  void prefetchCast(const int movieId) const;
+
+  /**
+   * Method: getEdgeCount
+   * --------------------
+   * @return the total number of credits (which is also the total number of cast entries)
+   */
+  int64_t getEdgeCount() const;
+
+  /**
+   * Method: getFileSize
+   * -------------------
+   * @return the size in bytes of the mapped graph file
+   */
+  size_t getFileSize() const;
+
+  /**
+   * Method: getFingerprint
+   * ----------------------
+   * @return the fingerprint of the data files the graph was built from
+   */
+  const imdb::fingerprint& getFingerprint() const;
+
+  /**
+   * Static Method: replicate
+   * ------------------------
+   * Copies a graph into private memory.  The copy is written, and so first
+   * touched, by the calling thread; pin that thread to a NUMA node first
+   * (see numaTopology) to place the copy on the node.
+   *
+   * @return a new graph the caller owns, good only if original was and
+   *         the memory could be had
+   */
+  static compactGraph *replicate(const compactGraph& original);
+
+  /**
+   * Static Method: build
+   * --------------------
+   * Writes the compressed adjacency of the imdb to directory/graph.vbyte.
+   *
+   * @return true if and only if the file was written successfully
+   */
+  static bool build(const imdb& db, const string& directory);
+
+  /**
+   * Static Methods: encode
+   *                 decode
+   * ----------------------
+   * The list codec on its own.  encode sorts and delta encodes the ids and
+   * appends the packed bytes to out.  decode reads count ids back; it may
+   * read up to 16 bytes past the end of the packed list.  decodeScalar is
+   * the portable decoder decode falls back on, exposed for benchmarking.
+   */
+  static void encode(vector<int> ids, vector<uint8_t>& out);
+  static void decode(const uint8_t *in, int count, vector<int>& ids);
+  static void decodeScalar(const uint8_t *in, int count, vector<int>& ids);
+
+  /**
+   * Static Method: hasSimdDecode
+   * ----------------------------
+   * @return true if decode uses the SSSE3 kernel on this machine
+   */
+  static bool hasSimdDecode();
+
+  ~compactGraph();
+
+  // the graph file's name within the data directory (graph.vbyte)
+  static const char *const kGraphFileName;
+
+ private:
+  struct header {
+    int32_t magic;
+    int32_t version;
+    int32_t numActors;
+    int32_t numMovies;
+    int64_t numEdges;
+    int64_t creditStartsOffset;
+    int64_t castStartsOffset;
+    int64_t creditCountsOffset;
+    int64_t castCountsOffset;
+    int64_t dataOffset;
+    imdb::fingerprint source;
+  };
+
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  const header *getHeader() const;
+  const int64_t *getStarts(const int64_t offset) const;
+  const int32_t *getCounts(const int64_t offset) const;
+  const uint8_t *getData() const;
+  static void prefetchList(const uint8_t *list, const int64_t bytes);
+
+  compactGraph();
+  compactGraph(const compactGraph& original);
+  compactGraph& operator=(const compactGraph& rhs);
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+size_t fileSize(const string& fileName)
+{
+  struct stat stats;
+  return stat(fileName.c_str(), &stats) == 0 ? stats.st_size : 0;
+}
+
+/**
+ * Function: timeAdjacency
+ * -----------------------
+ * Reads every credit and cast list of the graph once.
+ *
+ * @return the time taken, in nanoseconds per edge
+ */
+template <typename Graph>
+double timeAdjacency(const Graph& graph, int64_t edges)
+{
+  vector<int> ids;
+  int64_t checksum = 0;
+  double start = now();
+  for (int actor = 1; actor <= graph.getActorCount(); actor++) {
+    graph.getCreditIds(actor, ids);
+    checksum += ids.size();
+  }
+  for (int movie = 1; movie <= graph.getMovieCount(); movie++) {
+    graph.getCastIds(movie, ids);
+    checksum += ids.size();
+  }
+  double elapsed = now() - start;
+  if (checksum != 2 * edges) cerr << "Warning: adjacency lists disagree on the edge count" << endl;
+  return elapsed * 1e9 / (2 * edges);
+}
+
+/**
+ * Function: timeCodec
+ * -------------------
+ * Re-packs every credit list of the graph into one buffer and decodes it
+ * all with the given decoder, isolating the codec from page faults and
+ * the index lookups.
+ *
+ * @return the time taken, in nanoseconds per edge
+ */
+double timeCodec(const compactGraph& graph, void (*decoder)(const uint8_t *, int, vector<int>&))
+{
+  vector<uint8_t> packed;
+  vector<size_t> starts;
+  vector<int> counts, ids;
+  int64_t edges = 0;
+  for (int actor = 1; actor <= graph.getActorCount(); actor++) {
+    graph.getCreditIds(actor, ids);
+    starts.push_back(packed.size());
+    counts.push_back(ids.size());
+    compactGraph::encode(ids, packed);
+    edges += ids.size();
+  }
+  packed.resize(packed.size() + 16);
+
+  double start = now();
+  for (size_t i = 0; i < starts.size(); i++) decoder(&packed[starts[i]], counts[i], ids);
+  return (now() - start) * 1e9 / edges;
+}
+
+}
+
+/**
+ * Builds graph.vbyte next to the data files (unless an up-to-date one is there)
+ * and reports how much smaller it is than the raw adjacency, and what
+ * it costs per edge to decode.
+ */
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2) {
+    cerr << "Usage: graph-compress <data-files-path>" << endl;
+    return 1;
+  }
+
+  const string directory = argv[1];
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+
+  // rebuild when missing, or stale: built from different data files, or before the delta changed
+  compactGraph *graph = new compactGraph(directory);
+  if (!graph->good()) {
+    delete graph;
+    double start = now();
+    if (!compactGraph::build(db, directory)) {
+      cerr << "Couldn't write the compressed graph to " << directory << endl;
+      return 1;
+    }
+    cout << "Built the compressed graph in " << fixed << setprecision(2) << now() - start << "s" << endl;
+    graph = new compactGraph(directory);
+  }
+
+  const int64_t edges = graph->getEdgeCount();
+  const size_t dataFiles = fileSize(directory + "/actors.data") + fileSize(directory + "/movies.data");
+  const size_t rawAdjacency = 2 * edges * (db.hasWideOffsets() ? sizeof(int64_t) : sizeof(int32_t));
+  cout << fixed << setprecision(2);
+  cout << "actors/movies/credits:    " << graph->getActorCount() << " / " << graph->getMovieCount()
+       << " / " << edges << endl;
+  cout << "actors.data + movies.data: " << dataFiles / 1048576.0 << " MiB" << endl;
+  cout << "raw adjacency (offsets):   " << rawAdjacency / 1048576.0 << " MiB, "
+       << (double) rawAdjacency / (2 * edges) << " bytes/edge" << endl;
+  cout << "graph.vbyte:               " << graph->getFileSize() / 1048576.0 << " MiB, "
+       << (double) graph->getFileSize() / (2 * edges) << " bytes/edge (index included)" << endl;
+  cout << "saved vs raw adjacency:    " << 100.0 * (1.0 - (double) graph->getFileSize() / rawAdjacency)
+       << "%" << endl;
+
+  cout << setprecision(3);
+  cout << "decode, raw files (imdb):  " << timeAdjacency(db, edges) << " ns/edge" << endl;
+  cout << "decode, graph.vbyte:       " << timeAdjacency(*graph, edges) << " ns/edge" << endl;
+  cout << "codec only, scalar:        " << timeCodec(*graph, compactGraph::decodeScalar) << " ns/edge" << endl;
+  cout << "codec only, decode:        " << timeCodec(*graph, compactGraph::decode) << " ns/edge"
+       << (compactGraph::hasSimdDecode() ? " (ssse3)" : " (scalar)") << endl;
+
+  delete graph;
+  return 0;
+}
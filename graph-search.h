@@ -0,0 +1,264 @@
+#ifndef __graph_search__
+#define __graph_search__
+
+#include "imdb.h"
+#include "path.h"
+#include "search-filter.h"
+#include "query-options.h"
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+/**
+ * Class: graphSearch
+ * ------------------
+ * Breadth first search for the shortest path between two actors, working
+ * on actor/movie ids instead of names and film structs.  Graph is any
+ * adjacency source offering the id-level interface imdb itself has:
+ *
+ *     int getActorCount() const;
+ *     int getMovieCount() const;
+ *     void getCreditIds(const int actorId, vector<int>& movieIds) const;
+ *     void getCastIds(const int movieId, vector<int>& actorIds) const;
+ *     void prefetchCreditIndex(const int actorId) const;
+ *     void prefetchCredits(const int actorId) const;
+ *     void prefetchCastIndex(const int movieId) const;
+ *     void prefetchCast(const int movieId) const;
+ *
+ * so the same search runs over the raw data files (imdb) or over a
+ * compactGraph.  Each level is expanded a few frontier actors at a time,
+ * with the next groups' records and the group's movies' casts prefetched
+ * ahead of their use, so the cache misses of a level overlap rather than
+ * being waited on one by one.  Visited marks are stamped with a per-search number, so a
+ * graphSearch can be reused for many searches without clearing anything.
+ * A searchFilter can restrict which movies and actors a search may use,
+ * and queryOptions can bound how long it runs and how big its frontier
+ * grows (the visited marks are allocated up front, once per graphSearch).
+ */
+
+template <typename Graph>
+class graphSearch {
+
+ public:
+
+  /**
+   * Constructor: graphSearch
+   * ------------------------
+   * @param graph the adjacency to search; it must outlive the graphSearch
+   */
+  graphSearch(const Graph& graph) : graph(graph), stamp(0),
+    actorSeen(graph.getActorCount() + 1, 0), movieSeen(graph.getMovieCount() + 1, 0),
+    actorVia(graph.getActorCount() + 1, 0), movieVia(graph.getMovieCount() + 1, 0) {}
+
+  /**
+   * Method: shortestPath
+   * --------------------
+   * Searches level by level, each level being one movie deep.
+   *
+   * @param source the id of the starting actor
+   * @param target the id of the actor being searched for
+   * @param maxDepth the longest path (in movies) worth looking for
+   * @param hops cleared and filled with the path as alternating movie and actor ids,
+   *             ending with target.  Left empty if no path was found.
+   * @return true if and only if a path of at most maxDepth movies was found
+   */
+  bool shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops)
+  {
+    return search(source, target, maxDepth, hops, noFilter(), noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: shortestPath
+   * --------------------
+   * As above, but only through the movies and actors the filter allows.
+   */
+  bool shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops,
+                    const searchFilter& filter)
+  {
+    return filteredSearch(source, target, maxDepth, hops, filter, noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: shortestPath
+   * --------------------
+   * Either of the above, but giving up once the options say so.
+   *
+   * @return kPathFound, kNoPath, or why the search was given up
+   */
+  queryStatus shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops,
+                           const queryOptions& options)
+  {
+    return search(source, target, maxDepth, hops, noFilter(), options);
+  }
+
+  queryStatus shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops,
+                           const searchFilter& filter, const queryOptions& options)
+  {
+    return filteredSearch(source, target, maxDepth, hops, filter, options);
+  }
+
+ private:
+  const Graph& graph;
+  unsigned stamp;
+  vector<unsigned> actorSeen, movieSeen;
+  vector<int> actorVia, movieVia;
+  vector<int> frontier, next, credits, cast, movies;
+
+  // edges looked at between checks of the query options
+  static constexpr size_t kCheckInterval = 1 << 16;
+
+  // frontier actors expanded together, and how far ahead of the movie being
+  // expanded its successors' index slots are prefetched (records, half as far)
+  static constexpr size_t kGroupSize = 8;
+  static constexpr size_t kMovieLead = 16;
+
+  // lets the unfiltered search compile without any of the filter's tests
+  struct noFilter {
+    bool allowsMovie(const int) const { return true; }
+    bool allowsActor(const int) const { return true; }
+  };
+
+  // and the unbounded search without any of the options' checks
+  struct noLimits {
+    queryStatus check(const size_t) const { return kSearching; }
+  };
+
+  template <typename Limits>
+  queryStatus filteredSearch(const int source, const int target, const int maxDepth, vector<int>& hops,
+                             const searchFilter& filter, const Limits& limits)
+  {
+    hops.clear();
+    if (!filter.allowsActor(source) || !filter.allowsActor(target)) return kNoPath;
+    return search(source, target, maxDepth, hops, filter, limits);
+  }
+
+  template <typename Filter, typename Limits>
+  queryStatus search(const int source, const int target, const int maxDepth, vector<int>& hops,
+                     const Filter& filter, const Limits& limits)
+  {
+    hops.clear();
+    if (++stamp == 0) resetStamps();
+
+    frontier.assign(1, source);
+    actorSeen[source] = stamp;
+    actorVia[source] = 0;
+    if (source == target) return kPathFound;
+
+    size_t work = 0, nextCheck = kCheckInterval;
+
+    for (int depth = 0; depth < maxDepth && !frontier.empty(); ++depth) {
+      next.clear();
+      for (size_t group = 0; group < frontier.size(); group += kGroupSize) {
+        const size_t end = min(group + kGroupSize, frontier.size());
+        prefetchActors(group);
+
+        // the group's credits, whose records the last two groups prefetched
+        movies.clear();
+        for (size_t n = group; n < end; ++n) {
+          const int actor = frontier[n];
+          graph.getCreditIds(actor, credits);
+          for (size_t f = 0; f < credits.size(); ++f) {
+            const int movie = credits[f];
+            if (movieSeen[movie] == stamp || !filter.allowsMovie(movie)) continue;
+            movieSeen[movie] = stamp;
+            movieVia[movie] = actor;
+            movies.push_back(movie);
+          }
+        }
+
+        // then their casts, kMovieLead movies behind the index prefetches
+        // and half that behind the record prefetches
+        for (size_t m = 0; m < min(movies.size(), kMovieLead); ++m) graph.prefetchCastIndex(movies[m]);
+        for (size_t m = 0; m < min(movies.size(), kMovieLead / 2); ++m) graph.prefetchCast(movies[m]);
+        for (size_t m = 0; m < movies.size(); ++m) {
+          if (m + kMovieLead < movies.size()) graph.prefetchCastIndex(movies[m + kMovieLead]);
+          if (m + kMovieLead / 2 < movies.size()) graph.prefetchCast(movies[m + kMovieLead / 2]);
+
+          const int movie = movies[m];
+          graph.getCastIds(movie, cast);
+          for (size_t p = 0; p < cast.size(); ++p) {
+            const int costar = cast[p];
+            if (actorSeen[costar] == stamp || !filter.allowsActor(costar)) continue;
+            actorSeen[costar] = stamp;
+            actorVia[costar] = movie;
+            if (costar == target) {
+              tracePath(source, target, hops);
+              return kPathFound;
+            }
+            next.push_back(costar);
+          }
+
+          if ((work += cast.size()) >= nextCheck) {
+            nextCheck = work + kCheckInterval;
+            const queryStatus status = limits.check((frontier.capacity() + next.capacity()) * sizeof(int));
+            if (status != kSearching) return status;
+          }
+        }
+      }
+      frontier.swap(next);
+    }
+    return kNoPath;
+  }
+
+  /**
+   * Method: prefetchActors
+   * ----------------------
+   * Keeps the frontier's actor records ahead of the search.  Before the
+   * group at first is expanded, it prefetches the records of the group
+   * after it, whose index slots were prefetched a group ago, and the index
+   * slots of the group after that.  Prefetching never looks past the frontier.
+   */
+  void prefetchActors(const size_t first) const
+  {
+    const size_t size = frontier.size();
+    if (first == 0) {
+      // a new level, so nothing has been prefetched yet
+      for (size_t n = 0; n < min(2 * kGroupSize, size); ++n) graph.prefetchCreditIndex(frontier[n]);
+    }
+    for (size_t n = first + kGroupSize; n < min(first + 2 * kGroupSize, size); ++n) graph.prefetchCredits(frontier[n]);
+    for (size_t n = first + 2 * kGroupSize; n < min(first + 3 * kGroupSize, size); ++n) {
+      graph.prefetchCreditIndex(frontier[n]);
+    }
+  }
+
+  void tracePath(const int source, const int target, vector<int>& hops) const
+  {
+    for (int actor = target; actor != source; actor = movieVia[actorVia[actor]]) {
+      hops.push_back(actor);
+      hops.push_back(actorVia[actor]);
+    }
+    reverse(hops.begin(), hops.end());
+  }
+
+  void resetStamps()
+  {
+    fill(actorSeen.begin(), actorSeen.end(), 0);
+    fill(movieSeen.begin(), movieSeen.end(), 0);
+    stamp = 1;
+  }
+
+  graphSearch(const graphSearch& original);
+  graphSearch& operator=(const graphSearch& rhs);
+};
+
+/**
+ * Function: makePath
+ * ------------------
+ * Turns the hops produced by graphSearch::shortestPath back into a path
+ * of names and films.
+ *
+ * @param db the imdb the ids refer to
+ * @param source the id of the starting actor
+ * @param hops alternating movie and actor ids
+ * @return the equivalent path
+ */
+inline path makePath(const imdb& db, const int source, const vector<int>& hops)
+{
+  path p(db.getActorName(source));
+  for (size_t i = 0; i + 1 < hops.size(); i += 2) {
+    p.addConnection(db.getFilm(hops[i]), db.getActorName(hops[i + 1]));
+  }
+  return p;
+}
+
+#endif
@@ -0,0 +1,203 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include "graph-shard.h"
+#include "compact-graph.h"
+#include "replacement-file.h"
+
+namespace {
+
+const int32_t kMagic = 0x44524853; // "SHRD"
+const int32_t kVersion = 2;
+
+// compactGraph::decode reads whole 16 byte blocks, so the data section carries this much slack
+const int kSlackBytes = 16;
+
+// index slots a shard keeps for ids up to count: id / shardCount runs 0 through count / shardCount
+int ownedSlots(const int count, const int shardCount)
+{
+    return count / shardCount + 1;
+}
+
+}
+
+graphShard::graphShard(const string& directory, const int shard, const int shardCount) :
+    fd(-1), fileSize(0), fileMap(NULL)
+{
+    const string fileName = getFileName(directory, shard, shardCount);
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) != 0 || (size_t) stats.st_size < sizeof(header)) return;
+    fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) return;
+    fileSize = stats.st_size;
+    void *mapped = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return;
+    fileMap = mapped;
+
+    const header *h = getHeader();
+    if (h->magic != kMagic || h->version != kVersion || h->shard != shard || h->shardCount != shardCount ||
+        (size_t) h->dataOffset > fileSize || h->source != imdb::readFingerprint(directory)) {
+        munmap((char *) fileMap, fileSize);
+        fileMap = NULL;
+    }
+}
+
+graphShard::~graphShard()
+{
+    if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+    if (fd != -1) close(fd);
+}
+
+bool graphShard::good() const
+{
+    return fileMap != NULL;
+}
+
+int graphShard::getActorCount() const
+{
+    return getHeader()->numActors;
+}
+
+int graphShard::getMovieCount() const
+{
+    return getHeader()->numMovies;
+}
+
+size_t graphShard::getFileSize() const
+{
+    return fileSize;
+}
+
+void graphShard::getCreditIds(const int actorId, vector<int>& movieIds) const
+{
+    const header *h = getHeader();
+    const int slot = actorId / h->shardCount;
+    compactGraph::decode(getData() + getStarts(h->creditStartsOffset)[slot],
+                         getCounts(h->creditCountsOffset)[slot], movieIds);
+}
+
+void graphShard::getCastIds(const int movieId, vector<int>& actorIds) const
+{
+    const header *h = getHeader();
+    const int slot = movieId / h->shardCount;
+    compactGraph::decode(getData() + getStarts(h->castStartsOffset)[slot],
+                         getCounts(h->castCountsOffset)[slot], actorIds);
+}
+
+string graphShard::getFileName(const string& directory, const int shard, const int shardCount)
+{
+    ostringstream name;
+    name << directory << "/shard-" << shard << "-of-" << shardCount << ".graph";
+    return name.str();
+}
+
+bool graphShard::build(const imdb& db, const string& directory, const int shardCount)
+{
+    for (int shard = 0; shard < shardCount; shard++) {
+        if (!buildShard(db, directory, shard, shardCount)) return false;
+    }
+    return true;
+}
+
+bool graphShard::isCurrent(const string& directory, const int shardCount)
+{
+    for (int shard = 0; shard < shardCount; shard++) {
+        if (!graphShard(directory, shard, shardCount).good()) return false;
+    }
+    return true;
+}
+
+bool graphShard::buildShard(const imdb& db, const string& directory, const int shard, const int shardCount)
+{
+    const int actorSlots = ownedSlots(db.getActorCount(), shardCount);
+    const int movieSlots = ownedSlots(db.getMovieCount(), shardCount);
+
+    header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.shard = shard;
+    h.shardCount = shardCount;
+    h.numActors = db.getActorCount();
+    h.numMovies = db.getMovieCount();
+    h.source = db.getFingerprint();
+    h.ownedActors = actorSlots;
+    h.ownedMovies = movieSlots;
+    h.creditStartsOffset = sizeof(header);
+    h.castStartsOffset = h.creditStartsOffset + (actorSlots + 1) * sizeof(int64_t);
+    h.creditCountsOffset = h.castStartsOffset + (movieSlots + 1) * sizeof(int64_t);
+    h.castCountsOffset = h.creditCountsOffset + (actorSlots + 1) * sizeof(int32_t);
+    h.dataOffset = h.castCountsOffset + (movieSlots + 1) * sizeof(int32_t);
+    h.dataOffset += (8 - h.dataOffset % 8) % 8;
+
+    const string fileName = getFileName(directory, shard, shardCount);
+    replacementFile file(fileName);
+    if (!file.good()) return false;
+    ofstream& out = file.stream();
+
+    // as compactGraph::build: the packed lists first, then the header and index
+    vector<int64_t> creditStarts(actorSlots + 1, 0), castStarts(movieSlots + 1, 0);
+    vector<int32_t> creditCounts(actorSlots + 1, 0), castCounts(movieSlots + 1, 0);
+    vector<int> ids;
+    vector<uint8_t> packed;
+    int64_t dataBytes = 0;
+    out.seekp(h.dataOffset);
+    for (int slot = 0; slot < actorSlots; slot++) {
+        const int actor = slot * shardCount + shard;
+        creditStarts[slot] = dataBytes;
+        if (actor < 1 || actor > h.numActors) continue;
+        db.getCreditIds(actor, ids);
+        packed.clear();
+        compactGraph::encode(ids, packed);
+        creditCounts[slot] = ids.size();
+        writeBlock(out, packed);
+        dataBytes += packed.size();
+    }
+    for (int slot = 0; slot < movieSlots; slot++) {
+        const int movie = slot * shardCount + shard;
+        castStarts[slot] = dataBytes;
+        if (movie < 1 || movie > h.numMovies) continue;
+        db.getCastIds(movie, ids);
+        packed.clear();
+        compactGraph::encode(ids, packed);
+        castCounts[slot] = ids.size();
+        writeBlock(out, packed);
+        dataBytes += packed.size();
+    }
+    writeBlock(out, vector<uint8_t>(kSlackBytes, 0));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    writeBlock(out, creditStarts);
+    writeBlock(out, castStarts);
+    writeBlock(out, creditCounts);
+    writeBlock(out, castCounts);
+    return file.commit();
+}
+
+const graphShard::header *graphShard::getHeader() const
+{
+    return static_cast<const header*>(fileMap);
+}
+
+const int64_t *graphShard::getStarts(const int64_t offset) const
+{
+    return reinterpret_cast<const int64_t*>(static_cast<const char*>(fileMap) + offset);
+}
+
+const int32_t *graphShard::getCounts(const int64_t offset) const
+{
+    return reinterpret_cast<const int32_t*>(static_cast<const char*>(fileMap) + offset);
+}
+
+const uint8_t *graphShard::getData() const
+{
+    return static_cast<const uint8_t*>(fileMap) + getHeader()->dataOffset;
+}
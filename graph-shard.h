@@ -0,0 +1,134 @@
+#ifndef __graph_shard__
+#define __graph_shard__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: graphShard
+ * -----------------
+ * One of shardCount slices of the actor/movie adjacency, for running a
+ * search across processes (or, one day, machines) that each hold only
+ * their slice.  Actor and movie ids are dealt round robin: shard s owns
+ * the ids congruent to s modulo shardCount, and holds the credit lists of
+ * its actors and the cast lists of its movies, packed with compactGraph's
+ * codec.  Lists name ids of any shard.
+ *
+ * Each shard is its own file, shard-<s>-of-<shardCount>.graph, next to
+ * the data files, and is mmapped:
+ *
+ *     header                          counts, offsets, and the data files' fingerprint
+ *     creditStarts[ownedActors + 1]   byte offset of each owned actor's list in the data section
+ *     castStarts[ownedMovies + 1]     byte offset of each owned movie's list in the data section
+ *     creditCounts[ownedActors + 1]   list lengths
+ *     castCounts[ownedMovies + 1]
+ *     data                            the packed lists, and 16 bytes of slack
+ *
+ * where owned id i is at index i / shardCount.
+ */
+
+class graphShard {
+
+ public:
+
+  /**
+   * Constructor: graphShard
+   * -----------------------
+   * Maps shard shard of shardCount.  Use build to create them.  A shard
+   * built from other data files than the directory holds now, or before a
+   * change to its credits.delta, is stale (see imdb::fingerprint) and not
+   * mapped.
+   *
+   * @param directory the directory housing the imdb data files
+   */
+  graphShard(const string& directory, const int shard, const int shardCount);
+  ~graphShard();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the shard file was found, mapped and looks
+   * sane, and was built from the data files and delta in the directory.
+   */
+  bool good() const;
+
+  int getActorCount() const;
+  int getMovieCount() const;
+  size_t getFileSize() const;
+
+  /**
+   * Methods: getCreditIds
+   *          getCastIds
+   * ---------------------
+   * Same contract as compactGraph's, for ids this shard owns only.
+   */
+  void getCreditIds(const int actorId, vector<int>& movieIds) const;
+  void getCastIds(const int movieId, vector<int>& actorIds) const;
+
+  /**
+   * Static Method: ownerOf
+   * ----------------------
+   * @return the shard owning an actor or movie id
+   */
+  static int ownerOf(const int id, const int shardCount) { return id % shardCount; }
+
+  /**
+   * Static Method: build
+   * --------------------
+   * Writes all shardCount shards of the imdb's adjacency into directory.
+   *
+   * @return true if and only if every shard was written successfully
+   */
+  static bool build(const imdb& db, const string& directory, const int shardCount);
+
+  /**
+   * Static Method: isCurrent
+   * ------------------------
+   * @return true if and only if all shardCount shards are in directory and
+   *         none of them is stale, so build needn't run
+   */
+  static bool isCurrent(const string& directory, const int shardCount);
+
+  /**
+   * Static Method: getFileName
+   * --------------------------
+   * @return the path of a shard's file
+   */
+  static string getFileName(const string& directory, const int shard, const int shardCount);
+
+ private:
+  struct header {
+    int32_t magic;
+    int32_t version;
+    int32_t shard;
+    int32_t shardCount;
+    int32_t numActors;
+    int32_t numMovies;
+    int32_t ownedActors;
+    int32_t ownedMovies;
+    int64_t creditStartsOffset;
+    int64_t castStartsOffset;
+    int64_t creditCountsOffset;
+    int64_t castCountsOffset;
+    int64_t dataOffset;
+    imdb::fingerprint source;
+  };
+
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  const header *getHeader() const;
+  const int64_t *getStarts(const int64_t offset) const;
+  const int32_t *getCounts(const int64_t offset) const;
+  const uint8_t *getData() const;
+  static bool buildShard(const imdb& db, const string& directory, const int shard, const int shardCount);
+
+  graphShard(const graphShard& original);
+  graphShard& operator=(const graphShard& rhs);
+};
+
+#endif
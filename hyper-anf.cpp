@@ -0,0 +1,201 @@
+using namespace std;
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "hyper-anf.h"
+#include "bench-utils.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HYPER_ANF_SSE2 1
+#endif
+
+namespace {
+
+// ids handed to a thread at a time, so threads that finish early take more
+const int kChunkIds = 1024;
+
+/**
+ * Class: inversePowers
+ * --------------------
+ * 2^-r for every register value r, so estimates needn't call ldexp.
+ */
+class inversePowers {
+ public:
+  inversePowers() { for (int r = 0; r < 65; r++) values[r] = ldexp(1.0, -r); }
+  double operator[](const int r) const { return values[r]; }
+ private:
+  double values[65];
+};
+
+const inversePowers kInversePowers;
+
+/**
+ * Function: mergeRegisters
+ * ------------------------
+ * Takes the bytewise max of two counters into the first.  Counters are at
+ * least 16 bytes, a multiple of 16 long.
+ *
+ * @return true if and only if into changed
+ */
+bool mergeRegisters(uint8_t *into, const uint8_t *from, const int count)
+{
+#ifdef HYPER_ANF_SSE2
+    __m128i changed = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 16) {
+        const __m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i*>(into + i));
+        const __m128i merged = _mm_max_epu8(before, _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i)));
+        changed = _mm_or_si128(changed, _mm_xor_si128(merged, before));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(into + i), merged);
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) != 0xFFFF;
+#else
+    bool changed = false;
+    for (int i = 0; i < count; i++) {
+        if (from[i] > into[i]) {
+            into[i] = from[i];
+            changed = true;
+        }
+    }
+    return changed;
+#endif
+}
+
+/**
+ * Function: forEachChunk
+ * ----------------------
+ * Calls work(first, last) over [1, count] in chunks, from several threads.
+ */
+template <typename Work>
+void forEachChunk(const int count, const int threads, Work work)
+{
+    atomic<int> nextId(1);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(thread([&]() {
+            for (int first = nextId.fetch_add(kChunkIds); first <= count; first = nextId.fetch_add(kChunkIds)) {
+                work(first, min(count, first + kChunkIds - 1));
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+}
+
+void hyperAnf::run(const int threads, const int maxDistance, roundCallback reportRound)
+{
+    const size_t m = registers;
+    vector<uint8_t> current((actorCount + 1) * m, 0), next((actorCount + 1) * m), pools((movieCount + 1) * m);
+    vector<double> estimates(actorCount + 1, 0);
+
+    double start = now();
+    for (int actor = 1; actor <= actorCount; actor++) {
+        addActor(&current[actor * m], actor);
+        estimates[actor] = estimate(&current[actor * m]);
+    }
+    pairsWithin.assign(1, 0);
+    for (int actor = 1; actor <= actorCount; actor++) pairsWithin[0] += estimates[actor];
+    if (reportRound) reportRound(0, pairsWithin[0], now() - start);
+
+    for (int distance = 1; distance <= maxDistance; distance++) {
+        start = now();
+        // every movie pools the counters of its cast...
+        forEachChunk(movieCount, threads, [&](const int first, const int last) {
+            for (int movie = first; movie <= last; movie++) {
+                uint8_t *pool = &pools[movie * m];
+                memset(pool, 0, m);
+                for (int64_t i = castStarts[movie]; i < castStarts[movie + 1]; i++) {
+                    mergeRegisters(pool, &current[cast[i] * m], m);
+                }
+            }
+        });
+
+        // ...and every actor takes in the pools of its movies
+        atomic<bool> anyChanged(false);
+        forEachChunk(actorCount, threads, [&](const int first, const int last) {
+            bool changed = false;
+            for (int actor = first; actor <= last; actor++) {
+                uint8_t *counter = &next[actor * m];
+                memcpy(counter, &current[actor * m], m);
+                bool grew = false;
+                for (int64_t i = creditStarts[actor]; i < creditStarts[actor + 1]; i++) {
+                    grew |= mergeRegisters(counter, &pools[credits[i] * m], m);
+                }
+                if (grew) estimates[actor] = estimate(counter);
+                changed |= grew;
+            }
+            if (changed) anyChanged = true;
+        });
+        if (!anyChanged) break;
+
+        current.swap(next);
+        double pairs = 0;
+        for (int actor = 1; actor <= actorCount; actor++) pairs += estimates[actor];
+        pairsWithin.push_back(pairs);
+        if (reportRound) reportRound(distance, pairs, now() - start);
+    }
+}
+
+double hyperAnf::getConnectedPairs() const
+{
+    return pairsWithin.back() - pairsWithin[0];
+}
+
+double hyperAnf::getMeanSeparation() const
+{
+    const double connected = getConnectedPairs();
+    if (connected <= 0) return 0;
+    double total = 0;
+    for (size_t t = 1; t < pairsWithin.size(); t++) total += t * (pairsWithin[t] - pairsWithin[t - 1]);
+    return total / connected;
+}
+
+double hyperAnf::getEffectiveDiameter(const double fraction) const
+{
+    const double wanted = fraction * getConnectedPairs();
+    for (size_t t = 1; t < pairsWithin.size(); t++) {
+        const double within = pairsWithin[t] - pairsWithin[0], before = pairsWithin[t - 1] - pairsWithin[0];
+        if (within >= wanted) return t - 1 + (within > before ? (wanted - before) / (within - before) : 1);
+    }
+    return pairsWithin.size() - 1;
+}
+
+/**
+ * Method: addActor
+ * ----------------
+ * The usual HyperLogLog update: the top log2Registers bits of the id's hash
+ * pick a register, which keeps the most leading zeros (plus one) seen in
+ * the rest of the hash.
+ */
+void hyperAnf::addActor(uint8_t *counter, const int actorId) const
+{
+    uint64_t state = actorId;
+    const uint64_t hash = splitMix(state);
+    const uint64_t rest = hash << log2Registers;
+    const int rank = rest == 0 ? 64 - log2Registers + 1 : __builtin_clzll(rest) + 1;
+    uint8_t& reg = counter[hash >> (64 - log2Registers)];
+    reg = max<int>(reg, rank);
+}
+
+/**
+ * Method: estimate
+ * ----------------
+ * The HyperLogLog estimate of a counter, falling back on linear counting
+ * (from the number of empty registers) while the counter is small.
+ */
+double hyperAnf::estimate(const uint8_t *counter) const
+{
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < registers; i++) {
+        sum += kInversePowers[counter[i]];
+        zeros += counter[i] == 0;
+    }
+    const double m = registers;
+    const double alpha = registers == 16 ? 0.673 : registers == 32 ? 0.697 : registers == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+    const double raw = alpha * m * m / sum;
+    return raw <= 2.5 * m && zeros > 0 ? m * log(m / zeros) : raw;
+}
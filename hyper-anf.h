@@ -0,0 +1,116 @@
+#ifndef __hyper_anf__
+#define __hyper_anf__
+
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: hyperAnf
+ * ---------------
+ * Approximates the neighbourhood function of the actor graph, N(t), the
+ * number of (ordered) pairs of actors at most t films apart, the way
+ * HyperANF does: every actor carries a HyperLogLog counter of the actors
+ * it can reach, and each round every counter absorbs its neighbours', so
+ * after t rounds it counts the actors within t films.  A round is two
+ * sweeps over the credits: one pooling the counters of each movie's cast,
+ * and one merging the pools of each actor's movies into the actor.  Merging
+ * counters is a bytewise max over their registers, done 16 at a time with
+ * SSE2 where the CPU has it, and each sweep is split across threads.
+ *
+ * Counters take 2^log2Registers bytes each, three times over per actor
+ * (the counters, their next round, and their movies' pools); each estimate
+ * is off by about 1.04 / sqrt(2^log2Registers).  The counters of a
+ * connected component all end up holding the same union, so their errors
+ * don't cancel in N(t) at large t; the shape of N (the mean separation and
+ * effective diameter) is much steadier than its totals.
+ *
+ * Graph is any adjacency source with imdb's id-level interface (see
+ * graphSearch).  The adjacency is copied into flat arrays once up front,
+ * since every round reads all of it.
+ */
+
+class hyperAnf {
+
+ public:
+
+  /**
+   * Constructor: hyperAnf
+   * ---------------------
+   * @param graph the adjacency; only needed while constructing
+   * @param log2Registers 4 to 12
+   */
+  template <typename Graph>
+  hyperAnf(const Graph& graph, const int log2Registers);
+
+  /**
+   * Method: run
+   * -----------
+   * Runs rounds until no counter changes (or maxDistance rounds have run),
+   * calling back after each with the distance it reached, its estimate of
+   * N(distance) and how long it took.
+   *
+   * @param threads how many threads share each sweep
+   */
+  typedef void (*roundCallback)(int distance, double pairs, double seconds);
+  void run(const int threads, const int maxDistance, roundCallback reportRound = 0);
+
+  /**
+   * Method: getPairsWithin
+   * ----------------------
+   * @return N(0), N(1), ... as estimated by run; N(0) is (about) the
+   *         number of actors, each at distance 0 from itself, and is
+   *         estimated like the rest so their differences aren't skewed
+   */
+  const vector<double>& getPairsWithin() const { return pairsWithin; }
+
+  /**
+   * Methods: getMeanSeparation
+   *          getEffectiveDiameter
+   *          getConnectedPairs
+   * ---------------------------
+   * Over the pairs of distinct actors connected at all: their mean
+   * distance, the (linearly interpolated) distance within which the given
+   * fraction of them lie, and how many there are.
+   */
+  double getMeanSeparation() const;
+  double getEffectiveDiameter(const double fraction = 0.9) const;
+  double getConnectedPairs() const;
+
+ private:
+  int actorCount, movieCount;
+  int log2Registers, registers;
+  vector<int64_t> creditStarts, castStarts; // flat adjacency, indexed by id
+  vector<int> credits, cast;
+  vector<double> pairsWithin;
+
+  void addActor(uint8_t *counter, const int actorId) const;
+  double estimate(const uint8_t *counter) const;
+
+  hyperAnf(const hyperAnf& original);
+  hyperAnf& operator=(const hyperAnf& rhs);
+};
+
+template <typename Graph>
+hyperAnf::hyperAnf(const Graph& graph, const int log2Registers) :
+  actorCount(graph.getActorCount()), movieCount(graph.getMovieCount()),
+  log2Registers(log2Registers), registers(1 << log2Registers)
+{
+  vector<int> ids;
+  creditStarts.push_back(0);
+  creditStarts.push_back(0);
+  for (int actor = 1; actor <= actorCount; actor++) {
+    graph.getCreditIds(actor, ids);
+    credits.insert(credits.end(), ids.begin(), ids.end());
+    creditStarts.push_back(credits.size());
+  }
+  castStarts.push_back(0);
+  castStarts.push_back(0);
+  for (int movie = 1; movie <= movieCount; movie++) {
+    graph.getCastIds(movie, ids);
+    cast.insert(cast.end(), ids.begin(), ids.end());
+    castStarts.push_back(cast.size());
+  }
+}
+
+#endif
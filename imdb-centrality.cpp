@@ -0,0 +1,297 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <stdint.h>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "actor-ranking.h"
+#include "work-pool.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+// a range of actors no bigger than this runs as one task rather than splitting
+const int kSplitIds = 2048;
+const int kTopCount = 10;
+
+/**
+ * Function: submitRange
+ * ---------------------
+ * Calls perActor(worker, actor) for every actor in [first, last] on the
+ * pool.  The range splits in half until it is small enough, leaving the
+ * upper halves on the worker's deque for idle workers to steal.  perActor
+ * must outlive the pool's next wait.
+ */
+template <typename PerActor>
+void submitRange(workStealingPool& pool, const int first, const int last, const PerActor& perActor)
+{
+  pool.submit([&pool, first, last, &perActor](const int worker) {
+    int end = last;
+    while (end - first >= 2 * kSplitIds) {
+      const int middle = first + (end - first) / 2;
+      submitRange(pool, middle + 1, end, perActor);
+      end = middle;
+    }
+    for (int actor = first; actor <= end; actor++) perActor(worker, actor);
+  });
+}
+
+/**
+ * Class: brandesState
+ * -------------------
+ * One worker's scratch space for single source dependency accumulation
+ * (Brandes) over the credit graph, and the dependencies it has summed so
+ * far.  Actors and movies are both vertices, as in allShortestPaths, so
+ * paths through different films between the same actors count separately;
+ * only actors count as endpoints and only actors are scored.
+ */
+struct brandesState {
+  vector<int> actorDepth, movieDepth;
+  vector<double> actorPaths, moviePaths, actorDependency, movieDependency;
+  vector<int> order;                // vertices in BFS order, movies as negative ids
+  vector<int> ids;
+  vector<double> sums;              // summed dependency of each actor
+
+  brandesState(const int actorCount, const int movieCount) :
+    actorDepth(actorCount + 1, -1), movieDepth(movieCount + 1, -1),
+    actorPaths(actorCount + 1, 0), moviePaths(movieCount + 1, 0),
+    actorDependency(actorCount + 1, 0), movieDependency(movieCount + 1, 0), sums(actorCount + 1, 0) {}
+
+  template <typename Graph>
+  void accumulate(const Graph& graph, const int source)
+  {
+    order.assign(1, source);
+    actorDepth[source] = 0;
+    actorPaths[source] = 1;
+    for (size_t next = 0; next < order.size(); next++) {
+      const int vertex = order[next];
+      if (vertex > 0) {
+        graph.getCreditIds(vertex, ids);
+        const int depth = actorDepth[vertex] + 1;
+        for (size_t i = 0; i < ids.size(); i++) {
+          const int movie = ids[i];
+          if (movieDepth[movie] < 0) {
+            movieDepth[movie] = depth;
+            order.push_back(-movie);
+          }
+          if (movieDepth[movie] == depth) moviePaths[movie] += actorPaths[vertex];
+        }
+      } else {
+        graph.getCastIds(-vertex, ids);
+        const int depth = movieDepth[-vertex] + 1;
+        for (size_t i = 0; i < ids.size(); i++) {
+          const int actor = ids[i];
+          if (actorDepth[actor] < 0) {
+            actorDepth[actor] = depth;
+            order.push_back(actor);
+          }
+          if (actorDepth[actor] == depth) actorPaths[actor] += moviePaths[-vertex];
+        }
+      }
+    }
+
+    // deepest first, each vertex hands its dependency back to the vertices
+    // one level up, in proportion to the paths through them
+    for (size_t next = order.size(); next-- > 1; ) {
+      const int vertex = order[next];
+      if (vertex > 0) {
+        const double share = (1 + actorDependency[vertex]) / actorPaths[vertex];
+        graph.getCreditIds(vertex, ids);
+        for (size_t i = 0; i < ids.size(); i++) {
+          if (movieDepth[ids[i]] == actorDepth[vertex] - 1) movieDependency[ids[i]] += moviePaths[ids[i]] * share;
+        }
+        sums[vertex] += actorDependency[vertex];
+      } else {
+        const double share = movieDependency[-vertex] / moviePaths[-vertex];
+        graph.getCastIds(-vertex, ids);
+        for (size_t i = 0; i < ids.size(); i++) {
+          if (actorDepth[ids[i]] == movieDepth[-vertex] - 1) actorDependency[ids[i]] += actorPaths[ids[i]] * share;
+        }
+      }
+    }
+
+    for (size_t next = 0; next < order.size(); next++) {
+      const int vertex = order[next];
+      if (vertex > 0) {
+        actorDepth[vertex] = -1;
+        actorPaths[vertex] = actorDependency[vertex] = 0;
+      } else {
+        movieDepth[-vertex] = -1;
+        moviePaths[-vertex] = movieDependency[-vertex] = 0;
+      }
+    }
+  }
+};
+
+/**
+ * Function: timePhase
+ * -------------------
+ * Runs a phase, waits for the pool to drain and prints a row of the
+ * runtime breakdown.
+ */
+template <typename Phase>
+void timePhase(const string& name, workStealingPool& pool, Phase phase)
+{
+  const uint64_t tasksBefore = pool.getTasksRun(), stealsBefore = pool.getSteals();
+  const double start = now();
+  phase();
+  pool.wait();
+  cout << left << setw(14) << name << right << setw(10) << setprecision(3) << now() - start
+       << setw(10) << pool.getTasksRun() - tasksBefore << setw(10) << pool.getSteals() - stealsBefore << endl;
+}
+
+/**
+ * Function: computeRanking
+ * ------------------------
+ * Computes the three metrics on the pool, reporting each phase, and writes
+ * the ranking file, stamped with db's fingerprint.
+ */
+template <typename Graph>
+bool computeRanking(const Graph& graph, const imdb& db, const string& directory, workStealingPool& pool,
+                    const int samples, uint64_t seed)
+{
+  const int actorCount = graph.getActorCount();
+  const int threads = pool.getThreadCount();
+  vector<int32_t> degrees(actorCount + 1, 0), costars(actorCount + 1, 0);
+  vector<float> betweenness(actorCount + 1, 0);
+  vector<vector<int> > movies(threads), cast(threads);
+
+  cout << "metric           seconds     tasks    steals" << endl;
+  const auto countCredits = [&](const int worker, const int actor) {
+    graph.getCreditIds(actor, movies[worker]);
+    degrees[actor] = movies[worker].size();
+  };
+  timePhase("degree", pool, [&]() { submitRange(pool, 1, actorCount, countCredits); });
+
+  // an actor's id doubles as its stamp in the worker's seen marks
+  vector<vector<int> > seen(threads, vector<int>(actorCount + 1, 0));
+  const auto countCostars = [&](const int worker, const int actor) {
+    vector<int>& marks = seen[worker];
+    graph.getCreditIds(actor, movies[worker]);
+    marks[actor] = actor;
+    int count = 0;
+    for (size_t i = 0; i < movies[worker].size(); i++) {
+      graph.getCastIds(movies[worker][i], cast[worker]);
+      for (size_t j = 0; j < cast[worker].size(); j++) {
+        const int costar = cast[worker][j];
+        if (marks[costar] != actor) {
+          marks[costar] = actor;
+          count++;
+        }
+      }
+    }
+    costars[actor] = count;
+  };
+  timePhase("costars", pool, [&]() { submitRange(pool, 1, actorCount, countCostars); });
+  seen.clear();
+
+  // sources are actors with credits, so every sample explores something
+  vector<int> sources;
+  for (int tries = 0; (int) sources.size() < samples && tries < 100 * samples; tries++) {
+    const int actor = 1 + splitMix(seed) % actorCount;
+    if (degrees[actor] > 0) sources.push_back(actor);
+  }
+  vector<brandesState *> states(threads, (brandesState *) NULL);
+  timePhase("betweenness", pool, [&]() {
+    for (size_t i = 0; i < sources.size(); i++) {
+      const int source = sources[i];
+      pool.submit([&, source](const int worker) {
+        if (states[worker] == NULL) states[worker] = new brandesState(actorCount, graph.getMovieCount());
+        states[worker]->accumulate(graph, source);
+      });
+    }
+  });
+
+  // each pair is counted from both ends, and the sample stands for all sources
+  const double scale = sources.empty() ? 0 : double(actorCount) / sources.size() / 2;
+  bool written = false;
+  timePhase("rank + write", pool, [&]() {
+    for (int actor = 1; actor <= actorCount; actor++) {
+      double sum = 0;
+      for (int worker = 0; worker < threads; worker++) {
+        if (states[worker] != NULL) sum += states[worker]->sums[actor];
+      }
+      betweenness[actor] = sum * scale;
+    }
+    for (int worker = 0; worker < threads; worker++) delete states[worker];
+    written = actorRanking::write(directory, degrees, costars, betweenness, sources.size(), db.getFingerprint());
+  });
+  return written;
+}
+
+void printTop(const imdb& db, const actorRanking& ranking, const actorRanking::metric by, const string& name)
+{
+  cout << endl << "most central by " << name << endl;
+  cout << "rank  credits  costars     betweenness  actor" << endl;
+  for (int rank = 0; rank < kTopCount && rank < ranking.getActorCount(); rank++) {
+    const int actor = ranking.getRanked(by, rank);
+    cout << setw(4) << rank + 1 << setw(8) << ranking.getDegree(actor) << setw(10) << ranking.getCostarCount(actor)
+         << setw(16) << setprecision(0) << ranking.getBetweenness(actor) << "  " << db.getActorName(actor) << endl;
+  }
+}
+
+}
+
+/**
+ * Ranks the actors by how central they are (see actorRanking): degree,
+ * costar count and betweenness estimated from --samples BFS sources.  The
+ * work runs on a work-stealing pool of --threads workers, the runtime of
+ * each metric is reported, and the ranking is written to ranking.data in
+ * the data directory.  Reads graph.vbyte if there is one, else the data
+ * files.
+ *
+ * Usage: imdb-centrality [--samples n] [--seed n] [--threads n] <data-files-path>
+ */
+
+int main(int argc, char *argv[])
+{
+  int samples = 64, threads = max(1u, thread::hardware_concurrency());
+  uint64_t seed = 1;
+  string directory;
+  bool understood = true;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--samples" && i + 1 < argc) samples = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || samples < 0 || threads <= 0) {
+    cerr << "Usage: imdb-centrality [--samples n] [--seed n] [--threads n] <data-files-path>" << endl;
+    return 1;
+  }
+
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  compactGraph graph(directory);
+  cout << "reading " << (graph.good() ? "graph.vbyte" : "the data files") << ", " << threads << " threads, "
+       << samples << " betweenness samples" << endl << fixed;
+
+  workStealingPool pool(threads);
+  const double start = now();
+  const bool written = graph.good() ? computeRanking(graph, db, directory, pool, samples, seed)
+                                    : computeRanking(db, db, directory, pool, samples, seed);
+  cout << left << setw(14) << "total" << right << setw(10) << setprecision(3) << now() - start << endl;
+  if (!written) {
+    cerr << "Couldn't write " << directory << "/" << actorRanking::kRankingFileName << endl;
+    return 1;
+  }
+
+  const actorRanking ranking(directory);
+  if (!ranking.good()) {
+    cerr << "Couldn't read back " << directory << "/" << actorRanking::kRankingFileName << endl;
+    return 1;
+  }
+  printTop(db, ranking, actorRanking::kDegree, "degree");
+  printTop(db, ranking, actorRanking::kCostars, "costar count");
+  printTop(db, ranking, actorRanking::kBetweenness, "betweenness");
+  return 0;
+}
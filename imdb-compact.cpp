@@ -0,0 +1,199 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include "imdb.h"
+#include "imdb-delta.h"
+#include "imdb-writer.h"
+#include "name-index.h"
+#include "compact-graph.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+struct actorOrder {
+  const imdb& db;
+  bool operator()(const int a, const int b) const { return db.getActorName(a) < db.getActorName(b); }
+};
+
+struct movieOrder {
+  const imdb& db;
+  bool operator()(const int a, const int b) const { return db.getFilm(a) < db.getFilm(b); }
+};
+
+/**
+ * Function: sortedIds
+ * -------------------
+ * The ids of the files are already in sorted order and the delta's new ones
+ * follow them, so sorting everything is just sorting the (few) new ones and
+ * merging them in.
+ *
+ * @return the ids in the order of their records in the compacted file, front-padded with a 0
+ */
+template <typename Order>
+vector<int> sortedIds(const int baseCount, const int count, const Order& order)
+{
+  vector<int> ids(1, 0);
+  for (int id = 1; id <= count; id++) ids.push_back(id);
+  sort(ids.begin() + baseCount + 1, ids.end(), order);
+  inplace_merge(ids.begin() + 1, ids.begin() + baseCount + 1, ids.end(), order);
+  return ids;
+}
+
+/**
+ * Function: writeCompacted
+ * ------------------------
+ * Writes fresh actors.data/movies.data for the merged view of db under the given names.
+ *
+ * @return the total size of the two files, or -1 on failure
+ */
+int64_t writeCompacted(const imdb& db, const string& actorFileName, const string& movieFileName)
+{
+  const vector<int> actorsInOrder = sortedIds(db.getFileActorCount(), db.getActorCount(), actorOrder{db});
+  const vector<int> moviesInOrder = sortedIds(db.getFileMovieCount(), db.getMovieCount(), movieOrder{db});
+  vector<int> actorRank(actorsInOrder.size()), movieRank(moviesInOrder.size());
+  for (size_t rank = 1; rank < actorsInOrder.size(); rank++) actorRank[actorsInOrder[rank]] = rank;
+  for (size_t rank = 1; rank < moviesInOrder.size(); rank++) movieRank[moviesInOrder[rank]] = rank;
+
+  bool wide = false;
+  vector<int> ids;
+  vector<int64_t> actorBytes(actorsInOrder.size(), 0), movieBytes(moviesInOrder.size(), 0);
+  vector<int64_t> actorOffsets, movieOffsets;
+  int64_t actorFileBytes, movieFileBytes;
+  while (true) {
+    for (size_t rank = 1; rank < actorsInOrder.size(); rank++) {
+      db.getCreditIds(actorsInOrder[rank], ids);
+      actorBytes[rank] = imdbWriter::actorRecordBytes(db.getActorName(actorsInOrder[rank]).size(), ids.size(), wide);
+    }
+    for (size_t rank = 1; rank < moviesInOrder.size(); rank++) {
+      db.getCastIds(moviesInOrder[rank], ids);
+      movieBytes[rank] = imdbWriter::movieRecordBytes(db.getFilm(moviesInOrder[rank]).title.size(), ids.size(), wide);
+    }
+    actorFileBytes = imdbWriter::layoutRecords(actorBytes, actorOffsets, wide);
+    movieFileBytes = imdbWriter::layoutRecords(movieBytes, movieOffsets, wide);
+    if (wide || (imdbWriter::fitsNarrowOffsets(actorFileBytes) && imdbWriter::fitsNarrowOffsets(movieFileBytes))) break;
+    wide = true;
+  }
+
+  vector<int64_t> offsets;
+  imdbWriter actorFile(actorFileName, actorOffsets, wide);
+  for (size_t rank = 1; rank < actorsInOrder.size(); rank++) {
+    db.getCreditIds(actorsInOrder[rank], ids);
+    offsets.clear();
+    for (size_t i = 0; i < ids.size(); i++) offsets.push_back(movieOffsets[movieRank[ids[i]]]);
+    actorFile.writeActorRecord(db.getActorName(actorsInOrder[rank]), offsets);
+  }
+  imdbWriter movieFile(movieFileName, movieOffsets, wide);
+  for (size_t rank = 1; rank < moviesInOrder.size(); rank++) {
+    db.getCastIds(moviesInOrder[rank], ids);
+    offsets.clear();
+    for (size_t i = 0; i < ids.size(); i++) offsets.push_back(actorOffsets[actorRank[ids[i]]]);
+    movieFile.writeMovieRecord(db.getFilm(moviesInOrder[rank]), offsets);
+  }
+  const bool actorsWritten = actorFile.close(), moviesWritten = movieFile.close();
+  return actorsWritten && moviesWritten ? actorFileBytes + movieFileBytes : -1;
+}
+
+/**
+ * Function: swapInPair
+ * --------------------
+ * Renames the .compact files over the data files.  Two renames can't be
+ * made one, so the old actors.data is kept under a second name until the
+ * new movies.data is in, and put back if it can't be: the directory never
+ * keeps one file of each generation.  Readers are kept out by the caller's
+ * lock on the directory.
+ *
+ * @return true if both new files are in place, false if neither is
+ */
+bool swapInPair(const string& actorFileName, const string& movieFileName)
+{
+  const string previous = actorFileName + ".previous";
+  unlink(previous.c_str());
+  if (link(actorFileName.c_str(), previous.c_str()) != 0) return false;
+  if (rename((actorFileName + ".compact").c_str(), actorFileName.c_str()) != 0) {
+    unlink(previous.c_str());
+    return false;
+  }
+  if (rename((movieFileName + ".compact").c_str(), movieFileName.c_str()) != 0) {
+    rename(previous.c_str(), actorFileName.c_str());
+    return false;
+  }
+  unlink(previous.c_str());
+  return true;
+}
+
+}
+
+/**
+ * Folds credits.delta into fresh data files.  The new files are written next
+ * to the old ones and renamed over them, so processes that already have the
+ * old files mapped keep a consistent (if dated) view, and the tool can run in
+ * the background while they serve queries.  The renames and the trimming of
+ * the delta happen under an exclusive lock on the directory, which every
+ * imdb takes shared while it opens the files, so nothing ever opens an old
+ * file with a new one.  Edits appended to the delta while
+ * it runs are kept for next time; replaying the ones it did fold is harmless,
+ * since edits are idempotent.  The derived names.index and graph.vbyte are
+ * removed so they get rebuilt from the new files.
+ */
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2) {
+    cerr << "Usage: imdb-compact <data-files-path>" << endl;
+    return 1;
+  }
+
+  const string directory = argv[1];
+  const double start = now();
+
+  // read the delta before the imdb does, so everything discarded below has been folded
+  vector<imdbDelta::edit> edits;
+  size_t deltaBytes;
+  imdbDelta::read(directory, edits, &deltaBytes);
+  if (edits.empty()) {
+    cout << "Nothing to compact." << endl;
+    return 0;
+  }
+
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  const int changed = db.getDeltaEditCount();
+  const int newActors = db.getActorCount() - db.getFileActorCount();
+  const int newMovies = db.getMovieCount() - db.getFileMovieCount();
+
+  const string actorFileName = directory + "/actors.data", movieFileName = directory + "/movies.data";
+  const int64_t bytes = writeCompacted(db, actorFileName + ".compact", movieFileName + ".compact");
+  const int directoryFd = bytes < 0 ? -1 : open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (directoryFd == -1 || flock(directoryFd, LOCK_EX) != 0 || !swapInPair(actorFileName, movieFileName)) {
+    cerr << "Couldn't write the compacted data files to " << directory << endl;
+    unlink((actorFileName + ".compact").c_str());
+    unlink((movieFileName + ".compact").c_str());
+    return 1;
+  }
+  unlink((directory + "/" + nameIndex::kIndexFileName).c_str());
+  unlink((directory + "/" + compactGraph::kGraphFileName).c_str());
+  if (!imdbDelta::discard(directory, deltaBytes)) {
+    cerr << "Warning: couldn't trim " << directory << "/" << imdbDelta::kDeltaFileName
+         << "; its edits are already in the data files, and replaying them is harmless" << endl;
+  }
+  close(directoryFd);
+
+  cout << "edits read:     " << edits.size() << " (" << changed << " changed the data files)" << endl;
+  cout << "new actors:     " << newActors << endl;
+  cout << "new movies:     " << newMovies << endl;
+  cout << fixed << setprecision(2);
+  cout << "data files:     " << bytes / 1048576.0 << " MiB" << endl;
+  cout << "elapsed:        " << now() - start << "s" << endl;
+  return 0;
+}
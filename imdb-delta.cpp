@@ -0,0 +1,163 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sstream>
+#include "imdb-delta.h"
+
+const char *const imdbDelta::kDeltaFileName = "credits.delta";
+
+namespace {
+
+string deltaFileName(const string& directory)
+{
+    return directory + "/" + imdbDelta::kDeltaFileName;
+}
+
+bool readAll(const int fd, string& contents)
+{
+    char buffer[1 << 16];
+    contents.clear();
+    while (true) {
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        if (count == 0) return true;
+        contents.append(buffer, count);
+    }
+}
+
+bool writeAll(const int fd, const string& contents)
+{
+    for (size_t written = 0; written < contents.size(); ) {
+        const ssize_t count = ::write(fd, contents.data() + written, contents.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        written += count;
+    }
+    return true;
+}
+
+/**
+ * Function: parseEdit
+ * -------------------
+ * Parses one line (without its newline) of the delta file.
+ */
+bool parseEdit(const string& line, imdbDelta::edit& e)
+{
+    vector<string> fields;
+    size_t start = 0;
+    while (true) {
+        const size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == string::npos ? string::npos : tab - start));
+        if (tab == string::npos) break;
+        start = tab + 1;
+    }
+    if (fields.size() != 4 || (fields[0] != "+" && fields[0] != "-")) return false;
+    if (fields[1].empty() || fields[2].empty()) return false;
+
+    char *end;
+    const long year = strtol(fields[3].c_str(), &end, 10);
+    if (*end != '\0' || end == fields[3].c_str()) return false;
+    e.isAddition = fields[0] == "+";
+    e.player = fields[1];
+    e.movie.title = fields[2];
+    e.movie.year = year;
+    return true;
+}
+
+/**
+ * Function: lockDeltaFile
+ * -----------------------
+ * Opens and exclusively locks the delta file, making sure the lock is on the
+ * file currently at that path: discard replaces the file, so whoever was
+ * waiting on the old one must try again.
+ *
+ * @return the locked descriptor, or -1
+ */
+int lockDeltaFile(const string& fileName, const int flags)
+{
+    while (true) {
+        const int fd = open(fileName.c_str(), flags, 0644);
+        if (fd == -1) return -1;
+        struct stat locked, current;
+        if (flock(fd, LOCK_EX) != 0 || fstat(fd, &locked) != 0) {
+            close(fd);
+            return -1;
+        }
+        if (stat(fileName.c_str(), &current) == 0 && locked.st_ino == current.st_ino &&
+            locked.st_dev == current.st_dev) {
+            return fd;
+        }
+        close(fd); // replaced while we waited
+    }
+}
+
+}
+
+bool imdbDelta::read(const string& directory, vector<edit>& edits, size_t *bytesRead)
+{
+    edits.clear();
+    if (bytesRead != NULL) *bytesRead = 0;
+    const int fd = open(deltaFileName(directory).c_str(), O_RDONLY);
+    if (fd == -1) return errno == ENOENT;
+
+    string contents;
+    const bool readOk = readAll(fd, contents);
+    close(fd);
+    if (!readOk) return false;
+
+    // a line still being appended has no newline yet; leave it for next time
+    bool wellFormed = true;
+    size_t start = 0;
+    for (size_t newline = contents.find('\n'); newline != string::npos; newline = contents.find('\n', start)) {
+        string line = contents.substr(start, newline - start);
+        start = newline + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#') continue;
+        edit e;
+        if (parseEdit(line, e)) edits.push_back(e);
+        else wellFormed = false;
+    }
+    if (bytesRead != NULL) *bytesRead = start;
+    return wellFormed;
+}
+
+bool imdbDelta::append(const string& directory, const vector<edit>& edits)
+{
+    ostringstream lines;
+    for (size_t i = 0; i < edits.size(); i++) {
+        lines << (edits[i].isAddition ? '+' : '-') << '\t' << edits[i].player << '\t'
+              << edits[i].movie.title << '\t' << edits[i].movie.year << '\n';
+    }
+
+    const int fd = lockDeltaFile(deltaFileName(directory), O_WRONLY | O_CREAT | O_APPEND);
+    if (fd == -1) return false;
+    const bool written = writeAll(fd, lines.str()) && fsync(fd) == 0;
+    close(fd); // releases the lock
+    return written;
+}
+
+bool imdbDelta::discard(const string& directory, const size_t bytes)
+{
+    const string fileName = deltaFileName(directory);
+    const int fd = lockDeltaFile(fileName, O_RDONLY);
+    if (fd == -1) return errno == ENOENT && bytes == 0;
+
+    string contents;
+    bool ok = readAll(fd, contents) && bytes <= contents.size();
+    if (ok) {
+        const string tempFileName = fileName + ".tmp";
+        const int temp = open(tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = temp != -1 && writeAll(temp, contents.substr(bytes)) && fsync(temp) == 0;
+        if (temp != -1) close(temp);
+        ok = ok && rename(tempFileName.c_str(), fileName.c_str()) == 0;
+        if (!ok) unlink(tempFileName.c_str());
+    }
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,71 @@
+#ifndef __imdb_delta__
+#define __imdb_delta__
+
+#include "imdb-utils.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: imdbDelta
+ * ----------------
+ * Reads and writes credits.delta, the credits added to or removed from the
+ * data files since they were written, so a day's new releases don't mean
+ * rewriting gigabytes of sorted records.  imdb layers the edits over the
+ * files it maps, and imdb-compact folds them into fresh data files.
+ *
+ * The file is plain text, one edit per line, applied in order:
+ *
+ *     +<tab>actor name<tab>movie title<tab>year
+ *     -<tab>actor name<tab>movie title<tab>year
+ *
+ * Adding a credit for an actor or movie the data files don't have adds the
+ * actor or movie too.  Edits are idempotent against the data files (adding
+ * a credit that is already there, or removing one that isn't, does nothing),
+ * so replaying a delta over files it has already been folded into is
+ * harmless.  Blank lines and lines starting with # are ignored.
+ */
+
+class imdbDelta {
+
+ public:
+
+  struct edit {
+    bool isAddition;
+    string player;
+    film movie;
+  };
+
+  static const char *const kDeltaFileName;
+
+  /**
+   * Static Method: read
+   * -------------------
+   * Reads every edit in directory/credits.delta.  A missing file is an empty delta.
+   *
+   * @param edits cleared and filled with the edits, in file order
+   * @param bytesRead if not NULL, set to the number of bytes the edits came from,
+   *                  which is what discard should be given once they are folded in
+   * @return false if the file couldn't be read or had malformed lines (which are skipped)
+   */
+  static bool read(const string& directory, vector<edit>& edits, size_t *bytesRead = NULL);
+
+  /**
+   * Static Method: append
+   * ---------------------
+   * Appends edits to directory/credits.delta, creating it if need be.
+   * Appends and discards are serialized with an advisory lock on the file.
+   */
+  static bool append(const string& directory, const vector<edit>& edits);
+
+  /**
+   * Static Method: discard
+   * ----------------------
+   * Drops the first bytes of directory/credits.delta (edits that have been
+   * folded into the data files), keeping anything appended since they were
+   * read.  The file is replaced atomically.
+   */
+  static bool discard(const string& directory, const size_t bytes);
+};
+
+#endif
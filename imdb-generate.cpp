@@ -0,0 +1,324 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "imdb-utils.h"
+#include "imdb-writer.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+// "1x" is the size of the snapshot the course data was cut from:
+// over 1,000,000 actors and over 300,000 movies
+const int64_t kImdbActors = 1000000;
+const int64_t kImdbMovies = 300000;
+
+// credits per actor follow a power law P(d) ~ d^-kCreditExponent, like the real data:
+// most people have one or two credits, a few have hundreds
+const double kCreditExponent = 2.2;
+const int kMaxCredits = 2000;
+
+// movie popularity is skewed too: a credit picks popularity rank floor(M * u^kPopularitySkew),
+// so cast sizes run from a handful to the hundreds
+const double kPopularitySkew = 2.5;
+
+// spreads popularity ranks over the (alphabetical) movie ids; prime, and larger than any
+// movie count we generate, so rank -> id is a bijection
+const uint64_t kRankScramble = 2654435761ULL;
+
+const char *const kFirstNames[] = {
+  "Aaron", "Abigail", "Adam", "Alan", "Alice", "Amanda", "Amy", "Andrew", "Anna", "Anthony",
+  "Barbara", "Benjamin", "Betty", "Brian", "Carol", "Catherine", "Charles", "Christopher", "Daniel", "David",
+  "Deborah", "Dennis", "Donald", "Donna", "Dorothy", "Edward", "Elizabeth", "Emily", "Emma", "Eric",
+  "Frank", "Gary", "George", "Gregory", "Helen", "Henry", "Jack", "James", "Janet", "Jason",
+  "Jeffrey", "Jennifer", "Jessica", "John", "Joseph", "Joshua", "Karen", "Kate", "Kenneth", "Kevin",
+  "Laura", "Linda", "Lisa", "Margaret", "Maria", "Mark", "Mary", "Matthew", "Melissa", "Meryl",
+  "Michael", "Michelle", "Nancy", "Nicholas", "Patricia", "Paul", "Peter", "Rachel", "Raymond", "Rebecca",
+  "Richard", "Robert", "Ronald", "Ruth", "Sandra", "Sarah", "Scott", "Sharon", "Stephen", "Steven",
+  "Susan", "Thomas", "Timothy", "Virginia", "Walter", "William"
+};
+
+const char *const kLastNames[] = {
+  "Adams", "Allen", "Anderson", "Bacon", "Baker", "Barnes", "Bell", "Bennett", "Brooks", "Brown",
+  "Butler", "Campbell", "Carter", "Clark", "Collins", "Cook", "Cooper", "Cox", "Davis", "Edwards",
+  "Evans", "Fisher", "Flores", "Foster", "Garcia", "Gonzalez", "Gray", "Green", "Griffin", "Hall",
+  "Harris", "Hayes", "Henderson", "Hill", "Howard", "Hughes", "Jackson", "James", "Jenkins", "Johnson",
+  "Jones", "Kelly", "King", "Lee", "Lewis", "Long", "Lopez", "Martin", "Martinez", "Miller",
+  "Mitchell", "Moore", "Morgan", "Morris", "Murphy", "Nelson", "Nicholson", "Parker", "Perez", "Perry",
+  "Peterson", "Phillips", "Powell", "Price", "Reed", "Richardson", "Ritchie", "Rivera", "Roberts", "Robinson",
+  "Rodriguez", "Rogers", "Ross", "Russell", "Sanchez", "Sanders", "Scott", "Smith", "Stewart", "Streep",
+  "Sullivan", "Taylor", "Thomas", "Thompson", "Torres", "Turner", "Walker", "Ward", "Watson", "White",
+  "Williams", "Wilson", "Wood", "Wright", "Young"
+};
+
+const char *const kAdjectives[] = {
+  "Absent", "Broken", "Burning", "Cold", "Crimson", "Dangerous", "Dark", "Dead", "Distant", "Electric",
+  "Endless", "Eternal", "Fallen", "Final", "Forgotten", "Frozen", "Golden", "Hidden", "Hollow", "Last",
+  "Lonely", "Lost", "Midnight", "Mortal", "Perfect", "Quiet", "Restless", "Savage", "Secret", "Silent",
+  "Silver", "Sweet", "Twisted", "Wild"
+};
+
+const char *const kNouns[] = {
+  "Affair", "Angel", "Border", "Bridge", "City", "Crossing", "Dream", "Empire", "Escape", "Garden",
+  "Harbor", "Heart", "Highway", "Horizon", "House", "Island", "Journey", "Justice", "Kingdom", "Legacy",
+  "Machine", "Memory", "Mountain", "Night", "Ocean", "Promise", "Rain", "River", "Road", "Shadow",
+  "Signal", "Storm", "Stranger", "Summer", "Sun", "Train", "Valley", "Voyage", "Winter", "World"
+};
+
+/**
+ * Class: randomStream
+ * -------------------
+ * A tiny, fast 64-bit generator (splitMix).  Every actor and movie gets its
+ * own stream derived from the seed and its id, so any part of the dataset can
+ * be regenerated on its own, and the same seed always gives the same files.
+ */
+class randomStream {
+ public:
+  randomStream(const uint64_t seed, const uint64_t stream) : state(seed ^ (stream * 0xd1b54a32d192ed03ULL)) { next(); }
+
+  uint64_t next() { return splitMix(state); }
+
+  // uniform in [0, 1)
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+ private:
+  uint64_t state;
+};
+
+/**
+ * Class: sortedNames
+ * ------------------
+ * Names built as <part> <part> <suffix>, where each part list is sorted and
+ * the parts are letters only.  Because ' ' sorts below every letter, walking
+ * the combinations in mixed-radix order walks the names in sorted order, so
+ * the ith of n names can be produced directly, already sorted, without
+ * generating and sorting millions of strings.  The number of suffixes grows
+ * with n so there are always enough distinct names.
+ */
+class sortedNames {
+ public:
+  sortedNames(const char *const *firsts, size_t numFirsts, const char *const *seconds, size_t numSeconds,
+              const int64_t n, const bool romanSuffixes) :
+    firsts(firsts, firsts + numFirsts), seconds(seconds, seconds + numSeconds), n(n)
+  {
+    sort(this->firsts.begin(), this->firsts.end());
+    sort(this->seconds.begin(), this->seconds.end());
+    const int64_t pairs = numFirsts * numSeconds;
+    const int64_t numSuffixes = max((int64_t) 1, (n + pairs - 1) / pairs);
+    suffixes.push_back("");
+    for (int64_t i = 1; i < numSuffixes; ++i) {
+      if (romanSuffixes) suffixes.push_back(" (" + imdbWriter::romanNumeral(i + 1) + ")");
+      else {
+        ostringstream sequel;
+        sequel << " " << i + 1;
+        suffixes.push_back(sequel.str());
+      }
+    }
+    sort(suffixes.begin(), suffixes.end());
+    total = pairs * numSuffixes;
+  }
+
+  // the name of the ith (1-based) of n
+  string operator()(const int64_t ith) const
+  {
+    // spread the n names evenly over the whole space of combinations
+    const int64_t position = (ith - 1) * total / n;
+    const int64_t suffix = position % suffixes.size();
+    const int64_t second = (position / suffixes.size()) % seconds.size();
+    const int64_t first = position / (suffixes.size() * seconds.size());
+    return firsts[first] + " " + seconds[second] + suffixes[suffix];
+  }
+
+ private:
+  vector<string> firsts, seconds, suffixes;
+  int64_t n, total;
+};
+
+struct generatorOptions {
+  int64_t numActors;
+  int64_t numMovies;
+  uint64_t seed;
+  bool forceWide;
+};
+
+int movieYear(const generatorOptions& options, const int64_t movie)
+{
+  randomStream rng(options.seed ^ 0x6d6f766965ULL, movie);
+  return 1900 + rng.next() % 126;
+}
+
+/**
+ * Function: creditsOf
+ * -------------------
+ * Regenerates the sorted movie ids of one actor.  The first numMovies actors
+ * each get one guaranteed credit (a different movie each), so no movie is
+ * left without a cast.
+ */
+void creditsOf(const generatorOptions& options, const int64_t actor, vector<int>& movies)
+{
+  randomStream rng(options.seed, actor);
+  const int64_t maxCredits = min((int64_t) kMaxCredits, options.numMovies);
+  const int64_t degree = min(maxCredits, (int64_t) pow(1.0 - rng.uniform(), -1.0 / (kCreditExponent - 1.0)));
+
+  movies.clear();
+  if (actor <= options.numMovies) movies.push_back((actor - 1) * kRankScramble % options.numMovies + 1);
+  while ((int64_t) movies.size() < degree) {
+    const int64_t rank = (int64_t) (options.numMovies * pow(rng.uniform(), kPopularitySkew));
+    const int movie = rank * kRankScramble % options.numMovies + 1;
+    if (find(movies.begin(), movies.end(), movie) == movies.end()) movies.push_back(movie);
+  }
+  sort(movies.begin(), movies.end());
+}
+
+void progress(const string& phase, const double start)
+{
+  cerr << "  " << left << setw(32) << phase << right << fixed << setprecision(2) << now() - start << "s" << endl;
+}
+
+bool parseOptions(int argc, char *argv[], generatorOptions& options, string& directory)
+{
+  options.numActors = kImdbActors;
+  options.numMovies = kImdbMovies;
+  options.seed = 1;
+  options.forceWide = false;
+  for (int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if (arg == "--wide") options.forceWide = true;
+    else if (arg == "--scale" && i + 1 < argc) {
+      const double scale = atof(argv[++i]);
+      options.numActors = (int64_t) (kImdbActors * scale);
+      options.numMovies = (int64_t) (kImdbMovies * scale);
+    }
+    else if (arg == "--actors" && i + 1 < argc) options.numActors = atoll(argv[++i]);
+    else if (arg == "--movies" && i + 1 < argc) options.numMovies = atoll(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) options.seed = strtoull(argv[++i], NULL, 10);
+    else if (directory.empty() && arg[0] != '-') directory = arg;
+    else return false;
+  }
+  return !directory.empty() && options.numActors > 0 && options.numMovies > 0 &&
+         options.numActors < INT32_MAX && options.numMovies < INT32_MAX;
+}
+
+}
+
+/**
+ * Writes a synthetic actors.data/movies.data pair into the given directory,
+ * in exactly the format imdb maps.  Names are sorted the way imdb's binary
+ * searches expect, every offset is real, and the credit and cast counts follow
+ * power laws.  The same seed and sizes always produce byte-identical files.
+ */
+
+int main(int argc, char *argv[])
+{
+  generatorOptions options;
+  string directory;
+  if (!parseOptions(argc, argv, options, directory)) {
+    cerr << "Usage: imdb-generate [--scale <x> | --actors <n> --movies <n>] [--seed <n>] [--wide] <directory>" << endl;
+    cerr << "       --scale 1 is about IMDb size (" << kImdbActors << " actors, " << kImdbMovies << " movies)" << endl;
+    return 1;
+  }
+  mkdir(directory.c_str(), 0755);
+
+  const double start = now();
+  const int64_t numActors = options.numActors, numMovies = options.numMovies;
+  sortedNames actorName(kFirstNames, sizeof(kFirstNames) / sizeof(kFirstNames[0]),
+                        kLastNames, sizeof(kLastNames) / sizeof(kLastNames[0]), numActors, true);
+  sortedNames movieTitle(kAdjectives, sizeof(kAdjectives) / sizeof(kAdjectives[0]),
+                         kNouns, sizeof(kNouns) / sizeof(kNouns[0]), numMovies, false);
+
+  // pass 1: credit counts per actor and cast sizes per movie
+  vector<int64_t> castStarts(numMovies + 2, 0);
+  vector<int32_t> creditCounts(numActors + 1, 0);
+  vector<int> movies;
+  int64_t numCredits = 0;
+  for (int64_t actor = 1; actor <= numActors; ++actor) {
+    creditsOf(options, actor, movies);
+    creditCounts[actor] = movies.size();
+    numCredits += movies.size();
+    for (size_t i = 0; i < movies.size(); ++i) castStarts[movies[i] + 1]++;
+  }
+  for (int64_t movie = 1; movie <= numMovies + 1; ++movie) castStarts[movie] += castStarts[movie - 1];
+  progress("counted credits", start);
+
+  // lay out both files, going wide only if one of them needs it
+  bool wide = options.forceWide;
+  vector<int64_t> actorBytes(numActors + 1, 0), movieBytes(numMovies + 1, 0);
+  vector<int64_t> actorOffsets, movieOffsets;
+  int64_t actorFileBytes, movieFileBytes;
+  while (true) {
+    for (int64_t actor = 1; actor <= numActors; ++actor) {
+      actorBytes[actor] = imdbWriter::actorRecordBytes(actorName(actor).size(), creditCounts[actor], wide);
+    }
+    for (int64_t movie = 1; movie <= numMovies; ++movie) {
+      movieBytes[movie] = imdbWriter::movieRecordBytes(movieTitle(movie).size(),
+                                                       castStarts[movie + 1] - castStarts[movie], wide);
+    }
+    actorFileBytes = imdbWriter::layoutRecords(actorBytes, actorOffsets, wide);
+    movieFileBytes = imdbWriter::layoutRecords(movieBytes, movieOffsets, wide);
+    if (wide || (imdbWriter::fitsNarrowOffsets(actorFileBytes) && imdbWriter::fitsNarrowOffsets(movieFileBytes))) break;
+    wide = true;
+  }
+  progress("laid out records", start);
+
+  // pass 2: the cast of every movie, as actor ids (ascending, because actors are visited in order)
+  vector<int32_t> casts(numCredits);
+  {
+    vector<int64_t> fill(castStarts.begin(), castStarts.end() - 1);
+    for (int64_t actor = 1; actor <= numActors; ++actor) {
+      creditsOf(options, actor, movies);
+      for (size_t i = 0; i < movies.size(); ++i) casts[fill[movies[i]]++] = actor;
+    }
+  }
+  progress("collected casts", start);
+
+  vector<int64_t> offsets;
+  imdbWriter movieFile(directory + "/movies.data", movieOffsets, wide);
+  for (int64_t movie = 1; movie <= numMovies; ++movie) {
+    offsets.clear();
+    for (int64_t i = castStarts[movie]; i < castStarts[movie + 1]; ++i) offsets.push_back(actorOffsets[casts[i]]);
+    film f;
+    f.title = movieTitle(movie);
+    f.year = movieYear(options, movie);
+    movieFile.writeMovieRecord(f, offsets);
+  }
+  if (!movieFile.close()) {
+    cerr << "Couldn't write " << directory << "/movies.data" << endl;
+    return 1;
+  }
+  progress("wrote movies.data", start);
+
+  // pass 3: regenerate the credits once more as the actor records are written
+  imdbWriter actorFile(directory + "/actors.data", actorOffsets, wide);
+  for (int64_t actor = 1; actor <= numActors; ++actor) {
+    creditsOf(options, actor, movies);
+    offsets.clear();
+    for (size_t i = 0; i < movies.size(); ++i) offsets.push_back(movieOffsets[movies[i]]);
+    actorFile.writeActorRecord(actorName(actor), offsets);
+  }
+  if (!actorFile.close()) {
+    cerr << "Couldn't write " << directory << "/actors.data" << endl;
+    return 1;
+  }
+  progress("wrote actors.data", start);
+
+  int64_t maxCast = 0;
+  for (int64_t movie = 1; movie <= numMovies; ++movie) maxCast = max(maxCast, castStarts[movie + 1] - castStarts[movie]);
+  cout << "actors:      " << numActors << " (up to " << *max_element(creditCounts.begin(), creditCounts.end())
+       << " credits each)" << endl;
+  cout << "movies:      " << numMovies << " (casts of up to " << maxCast << ")" << endl;
+  cout << "credits:     " << numCredits << fixed << setprecision(2)
+       << " (" << (double) numCredits / numActors << " per actor)" << endl;
+  cout << "offsets:     " << (wide ? "8 bytes" : "4 bytes") << endl;
+  cout << "actors.data: " << actorFileBytes / 1048576.0 << " MiB" << endl;
+  cout << "movies.data: " << movieFileBytes / 1048576.0 << " MiB" << endl;
+  cout << "seed:        " << options.seed << endl;
+  return 0;
+}
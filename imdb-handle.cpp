@@ -0,0 +1,130 @@
+using namespace std;
+#include <sys/stat.h>
+#include <chrono>
+#include "imdb-handle.h"
+#include "imdb-delta.h"
+
+namespace {
+
+const char *const kWatchedFileNames[] = { "actors.data", "movies.data", imdbDelta::kDeltaFileName };
+
+}
+
+bool imdbHandle::fileStamp::operator==(const fileStamp& rhs) const
+{
+    return device == rhs.device && inode == rhs.inode && size == rhs.size &&
+           modifiedSeconds == rhs.modifiedSeconds && modifiedNanos == rhs.modifiedNanos;
+}
+
+imdbHandle::imdbHandle(const string& directory, const imdb::backing how) :
+    directory(directory), how(how), generation(0), stopping(false)
+{
+    loadedStamps = stampFiles();
+    imdb *first = new imdb(directory, how);
+    if (first->good()) first->prefault();
+    current = snapshot(first);
+}
+
+bool imdbHandle::good() const
+{
+    return acquire()->good();
+}
+
+imdbHandle::snapshot imdbHandle::acquire() const
+{
+    return atomic_load(&current);
+}
+
+bool imdbHandle::reload()
+{
+    lock_guard<mutex> hold(reloading);
+
+    // stamp first: if the files change while loading, the watcher sees it and reloads again
+    const vector<fileStamp> stamps = stampFiles();
+    snapshot fresh(new imdb(directory, how));
+    if (!fresh->good()) return false;
+    fresh->prefault();
+
+    retired.push_back(atomic_exchange(&current, fresh));
+    loadedStamps = stamps;
+    generation++;
+    releaseRetired();
+    return true;
+}
+
+void imdbHandle::watch(const int intervalMillis)
+{
+    if (watcher.joinable()) return;
+    watcher = thread(&imdbHandle::watchLoop, this, intervalMillis);
+}
+
+int imdbHandle::getGeneration() const
+{
+    return generation;
+}
+
+imdbHandle::~imdbHandle()
+{
+    {
+        lock_guard<mutex> hold(sleeping);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    if (watcher.joinable()) watcher.join();
+}
+
+vector<imdbHandle::fileStamp> imdbHandle::stampFiles() const
+{
+    vector<fileStamp> stamps;
+    for (size_t i = 0; i < sizeof(kWatchedFileNames) / sizeof(kWatchedFileNames[0]); i++) {
+        struct stat stats;
+        fileStamp stamp = { 0, 0, -1, 0, 0 }; // a missing file has a stamp too
+        if (stat((directory + "/" + kWatchedFileNames[i]).c_str(), &stats) == 0) {
+            stamp.device = stats.st_dev;
+            stamp.inode = stats.st_ino;
+            stamp.size = stats.st_size;
+            stamp.modifiedSeconds = stats.st_mtim.tv_sec;
+            stamp.modifiedNanos = stats.st_mtim.tv_nsec;
+        }
+        stamps.push_back(stamp);
+    }
+    return stamps;
+}
+
+/**
+ * Method: releaseRetired
+ * ----------------------
+ * Drops the retired snapshots no query holds any more, which unmaps their
+ * files here rather than in whichever query happened to let go last.
+ * Only called with reloading held.
+ */
+void imdbHandle::releaseRetired()
+{
+    vector<snapshot> stillHeld;
+    for (size_t i = 0; i < retired.size(); i++) {
+        if (retired[i].use_count() > 1) stillHeld.push_back(retired[i]);
+    }
+    retired.swap(stillHeld);
+}
+
+void imdbHandle::watchLoop(const int intervalMillis)
+{
+    vector<fileStamp> previous = stampFiles();
+    while (true) {
+        {
+            unique_lock<mutex> hold(sleeping);
+            wakeUp.wait_for(hold, chrono::milliseconds(intervalMillis), [this]() { return stopping; });
+            if (stopping) return;
+        }
+
+        const vector<fileStamp> stamps = stampFiles();
+        bool changed;
+        {
+            lock_guard<mutex> hold(reloading);
+            releaseRetired();
+            changed = !(stamps == loadedStamps);
+        }
+        if (changed && stamps == previous) reload(); // unchanged for a whole interval, so settled
+        previous = stamps;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef __imdb_handle__
+#define __imdb_handle__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <sys/types.h>
+using namespace std;
+
+/**
+ * Class: imdbHandle
+ * -----------------
+ * A reloadable imdb.  Queries pin the current snapshot with acquire and use
+ * it for as long as they like; reload maps the data files afresh, faults
+ * every page in, and only then swaps the new snapshot in with one atomic
+ * pointer exchange, so queries never wait on a reload and never see a
+ * half-loaded database.  Queries already running finish on the snapshot
+ * they pinned.
+ *
+ * Snapshots are reference counted.  A replaced snapshot is retired rather
+ * than dropped, and its files are unmapped (by the reloading or watching
+ * thread, never by a query) once the last query holding it lets go.
+ *
+ * Data files must be replaced by renaming new ones over them, as imdb-compact
+ * does, never rewritten in place: a mapping follows the file it was made
+ * from, so renaming leaves old snapshots intact.
+ */
+
+class imdbHandle {
+
+ public:
+
+  // a pinned, read-only view of the database
+  typedef shared_ptr<const imdb> snapshot;
+
+  /**
+   * Constructor: imdbHandle
+   * -----------------------
+   * Loads (and pre-faults) the first snapshot of the data files in directory.
+   * Every snapshot, this one and reloaded ones alike, uses the backing given
+   * (see imdb::backing).
+   */
+  imdbHandle(const string& directory, const imdb::backing how = imdb::kFileMapped);
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if the current snapshot is a good imdb.
+   */
+  bool good() const;
+
+  /**
+   * Method: acquire
+   * ---------------
+   * Pins the current snapshot.  Cheap, and never blocked by a reload.
+   */
+  snapshot acquire() const;
+
+  /**
+   * Method: reload
+   * --------------
+   * Maps the data files as they are now and swaps them in, unless they
+   * don't make a good imdb, in which case the current snapshot stays.
+   *
+   * @return true if a new snapshot was swapped in
+   */
+  bool reload();
+
+  /**
+   * Method: watch
+   * -------------
+   * Starts a background thread that reloads whenever actors.data, movies.data
+   * or credits.delta change, once they have stayed unchanged for a whole
+   * interval (so both halves of a replacement land in the same snapshot).
+   */
+  void watch(const int intervalMillis);
+
+  /**
+   * Method: getGeneration
+   * ---------------------
+   * @return how many snapshots have been swapped in since the first
+   */
+  int getGeneration() const;
+
+  /**
+   * Destructor: ~imdbHandle
+   * -----------------------
+   * Stops the watcher.  Snapshots still held by queries stay valid until released.
+   */
+  ~imdbHandle();
+
+ private:
+  // identifies one version of a file: replacing it changes the inode, editing it the size or time
+  struct fileStamp {
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    long modifiedSeconds, modifiedNanos;
+
+    bool operator==(const fileStamp& rhs) const;
+  };
+
+  string directory;
+  imdb::backing how;
+  snapshot current;             // only ever read and written through atomic_load/atomic_exchange
+  vector<snapshot> retired;     // replaced snapshots some query may still hold
+  vector<fileStamp> loadedStamps;
+  mutex reloading;              // serializes reloads; queries never take it
+  atomic<int> generation;
+
+  thread watcher;
+  mutex sleeping;
+  condition_variable wakeUp;
+  bool stopping;
+
+  vector<fileStamp> stampFiles() const;
+  void releaseRetired();
+  void watchLoop(const int intervalMillis);
+
+  imdbHandle(const imdbHandle& original);
+  imdbHandle& operator=(const imdbHandle& rhs);
+};
+
+#endif
@@ -0,0 +1,828 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "imdb-utils.h"
+#include "imdb-writer.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+const char *const kTitleFileName = "title.basics.tsv";
+const char *const kPrincipalFileName = "title.principals.tsv";
+const char *const kNameFileName = "name.basics.tsv";
+
+const int64_t kDefaultMemoryMiB = 2048;
+
+// the smallest buffer an external sort is given, however tight the memory limit
+const size_t kMinSortBytes = 16 << 20;
+
+// values handed from a parsing thread to a sorter at a time
+const size_t kBatchSize = 1 << 16;
+
+// movie years are stored as a signed byte relative to 1900
+const int kMinYear = 1900 - 128;
+const int kMaxYear = 1900 + 127;
+
+/**
+ * Function: peakResidentMiB
+ * -------------------------
+ * @return the high-water mark of this process's resident memory, or 0 if
+ *         the kernel doesn't say
+ */
+double peakResidentMiB()
+{
+  FILE *status = fopen("/proc/self/status", "r");
+  if (status == NULL) return 0;
+  char line[256];
+  long kb = 0;
+  while (fgets(line, sizeof(line), status) != NULL) {
+    if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+  }
+  fclose(status);
+  return kb / 1024.0;
+}
+
+void progress(const string& phase, const double start)
+{
+  cerr << "\r  " << left << setw(36) << phase << right << fixed << setprecision(2) << now() - start << "s" << endl;
+}
+
+/**
+ * Struct: field
+ * -------------
+ * One tab-separated field of a line, pointing into the mapped file.
+ */
+struct field {
+  const char *begin, *end;
+
+  bool is(const char *text) const { return (size_t) (end - begin) == strlen(text) && memcmp(begin, text, end - begin) == 0; }
+  bool isNull() const { return is("\\N"); }
+  string str() const { return string(begin, end); }
+};
+
+/**
+ * Function: splitFields
+ * ---------------------
+ * Splits the first maxFields fields off a line.
+ *
+ * @return the number of fields found
+ */
+int splitFields(const char *line, const char *end, field fields[], const int maxFields)
+{
+  int found = 0;
+  while (found < maxFields) {
+    const char *tab = (const char *) memchr(line, '\t', end - line);
+    fields[found].begin = line;
+    fields[found].end = tab == NULL ? end : tab;
+    found++;
+    if (tab == NULL) break;
+    line = tab + 1;
+  }
+  return found;
+}
+
+/**
+ * Function: parseId
+ * -----------------
+ * Turns an IMDb identifier like tt0111161 or nm0000102 into its number.
+ *
+ * @return the number, or 0 if the field isn't an identifier
+ */
+uint32_t parseId(const field& f)
+{
+  if (f.end - f.begin < 3) return 0;
+  uint64_t id = 0;
+  for (const char *c = f.begin + 2; c < f.end; c++) {
+    if (*c < '0' || *c > '9') return 0;
+    id = id * 10 + (*c - '0');
+    if (id > UINT32_MAX) return 0;
+  }
+  return id;
+}
+
+int parseYear(const field& f)
+{
+  if (f.isNull()) return 0;
+  return atoi(f.str().c_str());
+}
+
+/**
+ * Class: tsvFile
+ * --------------
+ * A read-only mapping of one TSV dump.  parse hands every data line (the
+ * header skipped) to a visitor, from several threads at once, while
+ * reporting how far through the file it is.
+ */
+class tsvFile {
+ public:
+  tsvFile(const string& fileName) : data(NULL), size(0)
+  {
+    fd = open(fileName.c_str(), O_RDONLY);
+    struct stat stats;
+    if (fd == -1 || fstat(fd, &stats) != 0) return;
+    size = stats.st_size;
+    if (size == 0) return;
+    data = (const char *) mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) data = NULL;
+    else madvise((void *) data, size, MADV_SEQUENTIAL);
+  }
+
+  ~tsvFile()
+  {
+    if (data != NULL) munmap((void *) data, size);
+    if (fd != -1) close(fd);
+  }
+
+  bool good() const { return data != NULL; }
+
+  /**
+   * Method: parse
+   * -------------
+   * Splits the file into line-aligned chunks that the threads claim one at a
+   * time; a chunk owns the lines that start inside it.  visit(worker, line, end)
+   * is called for every line, where worker is in [0, threads).
+   */
+  template <typename Visitor>
+  void parse(const string& label, const int threads, Visitor visit) const
+  {
+    const size_t numChunks = threads * 16;
+    const size_t chunkBytes = size / numChunks + 1;
+    const char *const headerEnd = (const char *) memchr(data, '\n', size);
+    atomic<size_t> nextChunk(0), bytesDone(0);
+    atomic<int> running(threads);
+
+    vector<thread> workers;
+    for (int worker = 0; worker < threads; worker++) {
+      workers.push_back(thread([&, worker]() {
+        for (size_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+          const char *begin = data + min(size, chunk * chunkBytes);
+          const char *end = data + min(size, (chunk + 1) * chunkBytes);
+          const char *fileEnd = data + size;
+          if (begin != data) {
+            const char *newline = (const char *) memchr(begin - 1, '\n', fileEnd - (begin - 1));
+            begin = newline == NULL ? fileEnd : newline + 1;
+          } else {
+            begin = headerEnd == NULL ? fileEnd : headerEnd + 1;
+          }
+          while (begin < end) {
+            const char *newline = (const char *) memchr(begin, '\n', fileEnd - begin);
+            const char *lineEnd = newline == NULL ? fileEnd : newline;
+            const char *textEnd = (lineEnd > begin && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+            if (textEnd > begin) visit(worker, begin, textEnd);
+            begin = lineEnd + 1;
+          }
+          dropPages(chunk * chunkBytes, (chunk + 1) * chunkBytes);
+          bytesDone += min(size, (chunk + 1) * chunkBytes) - min(size, chunk * chunkBytes);
+        }
+        running--;
+      }));
+    }
+
+    while (running > 0) {
+      cerr << "\r  " << label << " " << fixed << setprecision(0) << 100.0 * bytesDone / size << "%" << flush;
+      this_thread::sleep_for(chrono::milliseconds(250));
+    }
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  }
+
+ private:
+  int fd;
+  const char *data;
+  size_t size;
+
+  // parsed pages are only cached file data, so stop them counting against this process
+  void dropPages(const size_t begin, const size_t end) const
+  {
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t first = (begin + pageSize - 1) / pageSize * pageSize, last = min(size, end) / pageSize * pageSize;
+    if (first < last) madvise((void *) (data + first), last - first, MADV_DONTNEED);
+  }
+
+  tsvFile(const tsvFile& original);
+  tsvFile& operator=(const tsvFile& rhs);
+};
+
+/**
+ * Function: parallelSort
+ * ----------------------
+ * Sorts the values in parts, one per thread.
+ *
+ * @param partEnds filled with the end of each sorted part
+ */
+void parallelSort(vector<uint64_t>& values, const int threads, vector<size_t>& partEnds)
+{
+  const size_t parts = max(1, min(threads, (int) (values.size() / kBatchSize) + 1));
+  partEnds.clear();
+  vector<thread> sorters;
+  for (size_t i = 0; i < parts; i++) {
+    const size_t begin = values.size() * i / parts, end = values.size() * (i + 1) / parts;
+    partEnds.push_back(end);
+    sorters.push_back(thread([&values, begin, end]() { sort(values.begin() + begin, values.begin() + end); }));
+  }
+  for (size_t i = 0; i < sorters.size(); i++) sorters[i].join();
+}
+
+/**
+ * Class: externalSorter
+ * ---------------------
+ * Sorts more 64-bit values than fit in memory: values collect in a buffer of
+ * bounded size, and each time it fills it is sorted (in parallel) and spilled
+ * to a run file.  forEachUnique then merges the runs, or just the sorted
+ * buffer when nothing had to spill, and visits every distinct value in
+ * order.  Run files are deleted with the sorter.
+ */
+class externalSorter {
+ public:
+  externalSorter(const string& runPrefix, const size_t memoryBytes, const int threads) :
+    runPrefix(runPrefix), capacity(max(kMinSortBytes, memoryBytes) / sizeof(uint64_t)),
+    threads(threads), sorted(false), failed(false) {}
+
+  ~externalSorter()
+  {
+    for (size_t i = 0; i < runFiles.size(); i++) unlink(runFiles[i].c_str());
+  }
+
+  bool good() const { return !failed; }
+  int getRunCount() const { return runFiles.size(); }
+
+  /**
+   * Method: add
+   * -----------
+   * Adds a batch of values; safe to call from several threads.
+   */
+  void add(const vector<uint64_t>& values)
+  {
+    lock_guard<mutex> hold(lock);
+    for (size_t i = 0; i < values.size(); i++) {
+      if (buffer.size() == capacity) spill();
+      buffer.push_back(values[i]);
+    }
+    sorted = false;
+  }
+
+  /**
+   * Method: forEachUnique
+   * ---------------------
+   * Calls visit(value) for every distinct value, in increasing order.  May be
+   * called again to visit the same values again.
+   */
+  template <typename Visitor>
+  void forEachUnique(Visitor visit)
+  {
+    if (!runFiles.empty() && !buffer.empty()) spill();
+    if (runFiles.empty() && !sorted) {
+      parallelSort(buffer, threads, partEnds);
+      sorted = true;
+    }
+
+    vector<mergeSource *> sources;
+    if (runFiles.empty()) {
+      size_t begin = 0;
+      for (size_t i = 0; i < partEnds.size(); i++) {
+        sources.push_back(new mergeSource(&buffer[0] + begin, &buffer[0] + partEnds[i]));
+        begin = partEnds[i];
+      }
+    } else {
+      vector<uint64_t>().swap(buffer); // spilled, so give the memory back before merging
+      for (size_t i = 0; i < runFiles.size(); i++) {
+        sources.push_back(new mergeSource(fopen(runFiles[i].c_str(), "rb")));
+        if (!sources.back()->good()) failed = true;
+      }
+    }
+    merge(sources, visit);
+    for (size_t i = 0; i < sources.size(); i++) delete sources[i];
+  }
+
+ private:
+  string runPrefix;
+  size_t capacity;
+  int threads;
+  vector<uint64_t> buffer;
+  vector<size_t> partEnds;
+  vector<string> runFiles;
+  bool sorted;
+  bool failed;
+  mutex lock;
+
+  /**
+   * Class: mergeSource
+   * ------------------
+   * One sorted input to a merge: a part of the buffer, or a run file read a
+   * block at a time.
+   */
+  class mergeSource {
+   public:
+    mergeSource(const uint64_t *begin, const uint64_t *end) : next(begin), end(end), file(NULL), ok(true) {}
+    mergeSource(FILE *file) : next(NULL), end(NULL), file(file), ok(file != NULL), block(kBatchSize)
+    {
+      refill();
+    }
+    ~mergeSource() { if (file != NULL) fclose(file); }
+
+    bool good() const { return ok; }
+    bool empty() const { return next == end; }
+    uint64_t peek() const { return *next; }
+    void pop()
+    {
+      if (++next == end && file != NULL) refill();
+    }
+
+   private:
+    const uint64_t *next, *end;
+    FILE *file;
+    bool ok;
+    vector<uint64_t> block;
+
+    void refill()
+    {
+      if (file == NULL) return;
+      const size_t count = fread(&block[0], sizeof(uint64_t), block.size(), file);
+      next = &block[0];
+      end = next + count;
+    }
+  };
+
+  struct sourceOrder {
+    bool operator()(const mergeSource *a, const mergeSource *b) const { return a->peek() > b->peek(); }
+  };
+
+  template <typename Visitor>
+  static void merge(const vector<mergeSource *>& sources, Visitor& visit)
+  {
+    priority_queue<mergeSource *, vector<mergeSource *>, sourceOrder> heads;
+    for (size_t i = 0; i < sources.size(); i++) if (!sources[i]->empty()) heads.push(sources[i]);
+    bool first = true;
+    uint64_t previous = 0;
+    while (!heads.empty()) {
+      mergeSource *source = heads.top();
+      heads.pop();
+      const uint64_t value = source->peek();
+      if (first || value != previous) visit(value);
+      first = false;
+      previous = value;
+      source->pop();
+      if (!source->empty()) heads.push(source);
+    }
+  }
+
+  /**
+   * Method: spill
+   * -------------
+   * Sorts the buffer and writes it out as the next run, merging the sorted
+   * parts on the way out.
+   */
+  void spill()
+  {
+    ostringstream fileName;
+    fileName << runPrefix << runFiles.size();
+    runFiles.push_back(fileName.str());
+    FILE *run = fopen(runFiles.back().c_str(), "wb");
+    if (run == NULL) {
+      failed = true;
+      buffer.clear();
+      return;
+    }
+
+    parallelSort(buffer, threads, partEnds);
+    vector<mergeSource *> sources;
+    size_t begin = 0;
+    for (size_t i = 0; i < partEnds.size(); i++) {
+      sources.push_back(new mergeSource(&buffer[0] + begin, &buffer[0] + partEnds[i]));
+      begin = partEnds[i];
+    }
+    vector<uint64_t> block;
+    block.reserve(kBatchSize);
+    auto write = [&](const uint64_t value) {
+      block.push_back(value);
+      if (block.size() == kBatchSize) {
+        if (fwrite(&block[0], sizeof(uint64_t), block.size(), run) != block.size()) failed = true;
+        block.clear();
+      }
+    };
+    merge(sources, write);
+    if (!block.empty() && fwrite(&block[0], sizeof(uint64_t), block.size(), run) != block.size()) failed = true;
+    for (size_t i = 0; i < sources.size(); i++) delete sources[i];
+    if (fclose(run) != 0) failed = true;
+    buffer.clear();
+  }
+
+  externalSorter(const externalSorter& original);
+  externalSorter& operator=(const externalSorter& rhs);
+};
+
+/**
+ * Class: batchedAdder
+ * -------------------
+ * Per-thread staging for an externalSorter, so the sorter's lock is taken
+ * once per batch rather than once per value.
+ */
+class batchedAdder {
+ public:
+  batchedAdder(externalSorter& sorter) : sorter(sorter) { batch.reserve(kBatchSize); }
+  ~batchedAdder() { flush(); }
+
+  void add(const uint64_t value)
+  {
+    batch.push_back(value);
+    if (batch.size() == kBatchSize) flush();
+  }
+
+  void flush()
+  {
+    if (!batch.empty()) sorter.add(batch);
+    batch.clear();
+  }
+
+ private:
+  externalSorter& sorter;
+  vector<uint64_t> batch;
+};
+
+uint64_t pairKey(const uint32_t major, const uint32_t minor)
+{
+  return ((uint64_t) major << 32) | minor;
+}
+
+struct movieRow {
+  uint32_t tconst;
+  film movie;
+
+  bool operator<(const movieRow& rhs) const { return tconst < rhs.tconst; }
+};
+
+void appendSuffix(string& name, const string& suffix) { name += suffix; }
+void appendSuffix(film& movie, const string& suffix) { movie.title += suffix; }
+
+/**
+ * Function: disambiguate
+ * ----------------------
+ * imdb looks names and films up by binary search, so they must be unique.
+ * Entries that share a name (or title and year) are renamed the way IMDb
+ * itself does it, "John Smith (I)", "John Smith (II)", ..., in order of
+ * their IMDb ids; on the off chance that collides with a real name, the
+ * id itself is appended.
+ *
+ * @param labels the names or films, renamed in place
+ * @param ids the IMDb id of each entry
+ * @param prefix "nm" or "tt", for the fallback
+ * @param ranks filled with the 1-based position of each entry in sorted order
+ * @return the number of entries renamed
+ */
+template <typename Label>
+int disambiguate(vector<Label>& labels, const vector<uint32_t>& ids, const char *prefix, vector<int32_t>& ranks)
+{
+  vector<int32_t> order(labels.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  sort(order.begin(), order.end(), [&](const int32_t a, const int32_t b) {
+    return labels[a] < labels[b] || (labels[a] == labels[b] && ids[a] < ids[b]);
+  });
+
+  int renamed = 0;
+  for (size_t group = 0; group < order.size(); ) {
+    size_t end = group + 1;
+    while (end < order.size() && labels[order[end]] == labels[order[group]]) end++;
+    if (end - group > 1) {
+      for (size_t i = group; i < end; i++) appendSuffix(labels[order[i]], " (" + imdbWriter::romanNumeral(i - group + 1) + ")");
+      renamed += end - group;
+    }
+    group = end;
+  }
+
+  bool collided = true;
+  while (collided) {
+    sort(order.begin(), order.end(), [&](const int32_t a, const int32_t b) { return labels[a] < labels[b]; });
+    collided = false;
+    for (size_t i = 1; i < order.size(); i++) {
+      if (labels[order[i]] == labels[order[i - 1]]) {
+        ostringstream id;
+        id << " [" << prefix << setw(7) << setfill('0') << ids[order[i]] << "]";
+        appendSuffix(labels[order[i]], id.str());
+        collided = true;
+      }
+    }
+  }
+
+  ranks.assign(labels.size(), 0);
+  for (size_t i = 0; i < order.size(); i++) ranks[order[i]] = i + 1;
+  return renamed;
+}
+
+/**
+ * Function: writeDataFile
+ * -----------------------
+ * Writes actors.data or movies.data from pairs sorted by (record rank, other rank).
+ */
+template <typename WriteRecord>
+bool writeDataFile(const string& fileName, externalSorter& pairs, const vector<int64_t>& recordOffsets,
+                   const vector<int64_t>& otherOffsets, const bool wide, WriteRecord writeRecord)
+{
+  imdbWriter writer(fileName, recordOffsets, wide);
+  vector<int64_t> offsets;
+  uint32_t current = 1;
+  pairs.forEachUnique([&](const uint64_t key) {
+    const uint32_t rank = key >> 32;
+    while (current < rank) {
+      writeRecord(writer, current++, offsets);
+      offsets.clear();
+    }
+    offsets.push_back(otherOffsets[(uint32_t) key]);
+  });
+  while (current < recordOffsets.size()) {
+    writeRecord(writer, current++, offsets);
+    offsets.clear();
+  }
+  return writer.close() && pairs.good();
+}
+
+struct importOptions {
+  int threads;
+  int64_t memoryBytes;
+  vector<string> titleTypes;
+  string tsvDirectory;
+  string dataDirectory;
+};
+
+bool parseOptions(int argc, char *argv[], importOptions& options)
+{
+  options.threads = max(1u, thread::hardware_concurrency());
+  options.memoryBytes = kDefaultMemoryMiB << 20;
+  options.titleTypes.assign(1, "movie");
+  vector<string> directories;
+  for (int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) options.threads = max(1, atoi(argv[++i]));
+    else if (arg == "--memory" && i + 1 < argc) options.memoryBytes = (int64_t) atoll(argv[++i]) << 20;
+    else if (arg == "--types" && i + 1 < argc) {
+      options.titleTypes.clear();
+      stringstream types(argv[++i]);
+      string type;
+      while (getline(types, type, ',')) if (!type.empty()) options.titleTypes.push_back(type);
+    }
+    else if (arg[0] != '-') directories.push_back(arg);
+    else return false;
+  }
+  if (directories.size() != 2 || options.memoryBytes <= 0 || options.titleTypes.empty()) return false;
+  options.tsvDirectory = directories[0];
+  options.dataDirectory = directories[1];
+  return true;
+}
+
+}
+
+/**
+ * Builds actors.data and movies.data from IMDb's TSV dumps (title.basics,
+ * title.principals and name.basics, uncompressed):
+ *
+ *   1. keep the titles of the requested types that have a usable year
+ *   2. collect (person, title) credits of actors and actresses in those
+ *      titles in an external sort, which also drops repeated credits
+ *   3. look up the names of the people who have credits
+ *   4. make names and films unique, and rank them in the order imdb expects
+ *   5. re-sort the credits both ways by rank, and write both files at once
+ *
+ * Parsing and sorting run on all cores.  The memory limit bounds the sort
+ * buffers, which are the only part that grows with the number of credits;
+ * beyond it, sorted runs spill to disk next to the output.
+ */
+
+int main(int argc, char *argv[])
+{
+  importOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    cerr << "Usage: imdb-import [--threads <n>] [--memory <MiB>] [--types movie,tvMovie,...] "
+         << "<tsv-directory> <data-files-path>" << endl;
+    cerr << "       reads " << kTitleFileName << ", " << kPrincipalFileName << " and " << kNameFileName
+         << " (uncompressed)" << endl;
+    return 1;
+  }
+  mkdir(options.dataDirectory.c_str(), 0755);
+  const double start = now();
+  const int threads = options.threads;
+  const string runPrefix = options.dataDirectory + "/.imdb-import-run-";
+
+  // 1. titles
+  vector<movieRow> movies;
+  int64_t titlesSeen = 0;
+  {
+    tsvFile titles(options.tsvDirectory + "/" + kTitleFileName);
+    if (!titles.good()) {
+      cerr << "Couldn't read " << options.tsvDirectory << "/" << kTitleFileName << endl;
+      return 1;
+    }
+    vector<vector<movieRow> > found(threads);
+    vector<int64_t> seen(threads, 0);
+    titles.parse(kTitleFileName, threads, [&](const int worker, const char *line, const char *end) {
+      // tconst, titleType, primaryTitle, originalTitle, isAdult, startYear, ...
+      field fields[6];
+      seen[worker]++;
+      if (splitFields(line, end, fields, 6) < 6) return;
+      bool wanted = false;
+      for (size_t i = 0; i < options.titleTypes.size() && !wanted; i++) wanted = fields[1].is(options.titleTypes[i].c_str());
+      const int year = parseYear(fields[5]);
+      if (!wanted || year < kMinYear || year > kMaxYear) return;
+      movieRow row;
+      row.tconst = parseId(fields[0]);
+      row.movie.title = fields[2].str();
+      row.movie.year = year;
+      if (row.tconst != 0) found[worker].push_back(row);
+    });
+    for (int i = 0; i < threads; i++) {
+      movies.insert(movies.end(), found[i].begin(), found[i].end());
+      titlesSeen += seen[i];
+    }
+    sort(movies.begin(), movies.end());
+  }
+  vector<uint32_t> movieTconsts(movies.size());
+  for (size_t i = 0; i < movies.size(); i++) movieTconsts[i] = movies[i].tconst;
+  progress(kTitleFileName, start);
+
+  // 2. credits, as (nconst, movie index) pairs
+  externalSorter credits(runPrefix + "credits-", options.memoryBytes / 3, threads);
+  {
+    tsvFile principals(options.tsvDirectory + "/" + kPrincipalFileName);
+    if (!principals.good()) {
+      cerr << "Couldn't read " << options.tsvDirectory << "/" << kPrincipalFileName << endl;
+      return 1;
+    }
+    vector<batchedAdder *> adders;
+    for (int i = 0; i < threads; i++) adders.push_back(new batchedAdder(credits));
+    principals.parse(kPrincipalFileName, threads, [&](const int worker, const char *line, const char *end) {
+      // tconst, ordering, nconst, category, ...
+      field fields[4];
+      if (splitFields(line, end, fields, 4) < 4) return;
+      if (!fields[3].is("actor") && !fields[3].is("actress")) return;
+      const uint32_t tconst = parseId(fields[0]), nconst = parseId(fields[2]);
+      vector<uint32_t>::const_iterator found = lower_bound(movieTconsts.begin(), movieTconsts.end(), tconst);
+      if (nconst == 0 || found == movieTconsts.end() || *found != tconst) return;
+      adders[worker]->add(pairKey(nconst, found - movieTconsts.begin()));
+    });
+    for (int i = 0; i < threads; i++) delete adders[i];
+  }
+  vector<uint32_t>().swap(movieTconsts);
+
+  vector<uint32_t> actorNconsts;
+  vector<int32_t> creditCounts, castCounts(movies.size(), 0);
+  credits.forEachUnique([&](const uint64_t key) {
+    const uint32_t nconst = key >> 32;
+    if (actorNconsts.empty() || actorNconsts.back() != nconst) {
+      actorNconsts.push_back(nconst);
+      creditCounts.push_back(0);
+    }
+    creditCounts.back()++;
+    castCounts[(uint32_t) key]++;
+  });
+  if (!credits.good()) {
+    cerr << "Couldn't spill the credits to " << options.dataDirectory << endl;
+    return 1;
+  }
+  progress(kPrincipalFileName, start);
+
+  // 3. names of everyone with a credit
+  vector<string> names(actorNconsts.size());
+  {
+    tsvFile people(options.tsvDirectory + "/" + kNameFileName);
+    if (!people.good()) {
+      cerr << "Couldn't read " << options.tsvDirectory << "/" << kNameFileName << endl;
+      return 1;
+    }
+    people.parse(kNameFileName, threads, [&](const int, const char *line, const char *end) {
+      // nconst, primaryName, ...
+      field fields[2];
+      if (splitFields(line, end, fields, 2) < 2) return;
+      const uint32_t nconst = parseId(fields[0]);
+      vector<uint32_t>::const_iterator found = lower_bound(actorNconsts.begin(), actorNconsts.end(), nconst);
+      if (found != actorNconsts.end() && *found == nconst && !fields[1].isNull()) {
+        names[found - actorNconsts.begin()] = fields[1].str(); // each person is one line, so one writer
+      }
+    });
+  }
+  int unnamed = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    if (!names[i].empty()) continue;
+    ostringstream id;
+    id << "nm" << setw(7) << setfill('0') << actorNconsts[i];
+    names[i] = id.str();
+    unnamed++;
+  }
+  progress(kNameFileName, start);
+
+  // 4. unique names, and the rank of every actor and movie in the files
+  vector<int32_t> actorRanks, keptRanks, movieRanks(movies.size(), 0);
+  const int renamedActors = disambiguate(names, actorNconsts, "nm", actorRanks);
+  vector<film> keptMovies;
+  vector<uint32_t> keptTconsts;
+  vector<int32_t> keptIndices;
+  for (size_t i = 0; i < movies.size(); i++) {
+    if (castCounts[i] == 0) continue; // no actors, so not part of the graph
+    keptMovies.push_back(movies[i].movie);
+    keptTconsts.push_back(movies[i].tconst);
+    keptIndices.push_back(i);
+  }
+  const int renamedMovies = disambiguate(keptMovies, keptTconsts, "tt", keptRanks);
+  for (size_t i = 0; i < keptIndices.size(); i++) movieRanks[keptIndices[i]] = keptRanks[i];
+
+  const int64_t numActors = names.size(), numMovies = keptMovies.size();
+  vector<int32_t> actorByRank(numActors + 1), movieByRank(numMovies + 1);
+  for (int64_t i = 0; i < numActors; i++) actorByRank[actorRanks[i]] = i;
+  for (int64_t i = 0; i < numMovies; i++) movieByRank[keptRanks[i]] = i;
+  progress("ranked names and titles", start);
+
+  // 5. credits by actor rank and by movie rank; the three sorters share what the limit leaves
+  int64_t tableBytes = 0;
+  for (size_t i = 0; i < names.size(); i++) tableBytes += sizeof(string) + names[i].capacity() + 32;
+  for (size_t i = 0; i < keptMovies.size(); i++) tableBytes += 2 * (sizeof(film) + keptMovies[i].title.capacity() + 32);
+  tableBytes += (numActors + numMovies) * 48;
+  const int64_t sortBytes = max((int64_t) 0, options.memoryBytes - options.memoryBytes / 3 - tableBytes) / 2;
+  externalSorter byActor(runPrefix + "actors-", sortBytes, threads);
+  externalSorter byMovie(runPrefix + "movies-", sortBytes, threads);
+  {
+    batchedAdder actorPairs(byActor), moviePairs(byMovie);
+    size_t actor = 0;
+    credits.forEachUnique([&](const uint64_t key) {
+      while (actorNconsts[actor] != key >> 32) actor++;
+      const uint32_t movieRank = movieRanks[(uint32_t) key];
+      actorPairs.add(pairKey(actorRanks[actor], movieRank));
+      moviePairs.add(pairKey(movieRank, actorRanks[actor]));
+    });
+  }
+  const int creditRuns = credits.getRunCount();
+  progress("sorted credits by rank", start);
+
+  bool wide = false;
+  vector<int64_t> actorBytes(numActors + 1, 0), movieBytes(numMovies + 1, 0);
+  vector<int64_t> actorOffsets, movieOffsets;
+  int64_t actorFileBytes, movieFileBytes;
+  while (true) {
+    for (int64_t rank = 1; rank <= numActors; rank++) {
+      const int32_t i = actorByRank[rank];
+      actorBytes[rank] = imdbWriter::actorRecordBytes(names[i].size(), creditCounts[i], wide);
+    }
+    for (int64_t rank = 1; rank <= numMovies; rank++) {
+      const int32_t i = movieByRank[rank];
+      movieBytes[rank] = imdbWriter::movieRecordBytes(keptMovies[i].title.size(), castCounts[keptIndices[i]], wide);
+    }
+    actorFileBytes = imdbWriter::layoutRecords(actorBytes, actorOffsets, wide);
+    movieFileBytes = imdbWriter::layoutRecords(movieBytes, movieOffsets, wide);
+    if (wide || (imdbWriter::fitsNarrowOffsets(actorFileBytes) && imdbWriter::fitsNarrowOffsets(movieFileBytes))) break;
+    wide = true;
+  }
+
+  bool actorsWritten = false, moviesWritten = false;
+  thread actorWriter([&]() {
+    actorsWritten = writeDataFile(options.dataDirectory + "/actors.data", byActor, actorOffsets, movieOffsets, wide,
+                                  [&](imdbWriter& writer, const uint32_t rank, const vector<int64_t>& offsets) {
+                                    writer.writeActorRecord(names[actorByRank[rank]], offsets);
+                                  });
+  });
+  moviesWritten = writeDataFile(options.dataDirectory + "/movies.data", byMovie, movieOffsets, actorOffsets, wide,
+                                [&](imdbWriter& writer, const uint32_t rank, const vector<int64_t>& offsets) {
+                                  writer.writeMovieRecord(keptMovies[movieByRank[rank]], offsets);
+                                });
+  actorWriter.join();
+  if (!actorsWritten || !moviesWritten) {
+    cerr << "Couldn't write the data files to " << options.dataDirectory << endl;
+    return 1;
+  }
+  progress("wrote actors.data and movies.data", start);
+
+  int64_t numCredits = 0;
+  for (size_t i = 0; i < creditCounts.size(); i++) numCredits += creditCounts[i];
+  cout << "titles read:     " << titlesSeen << " (" << movies.size() << " of the requested types)" << endl;
+  cout << "movies:          " << numMovies << " (" << renamedMovies << " renamed to stay unique)" << endl;
+  cout << "actors:          " << numActors << " (" << renamedActors << " renamed to stay unique, "
+       << unnamed << " without a name)" << endl;
+  cout << "credits:         " << numCredits << endl;
+  cout << "offsets:         " << (wide ? "8 bytes" : "4 bytes") << endl;
+  cout << fixed << setprecision(2);
+  cout << "actors.data:     " << actorFileBytes / 1048576.0 << " MiB" << endl;
+  cout << "movies.data:     " << movieFileBytes / 1048576.0 << " MiB" << endl;
+  cout << "threads:         " << threads << endl;
+  cout << "sort runs:       " << creditRuns + byActor.getRunCount() + byMovie.getRunCount()
+       << (creditRuns + byActor.getRunCount() + byMovie.getRunCount() == 0 ? " (all in memory)" : " (spilled to disk)")
+       << endl;
+  cout << "peak memory:     " << peakResidentMiB() << " MiB (limit " << options.memoryBytes / 1048576.0 << " MiB)" << endl;
+  cout << "elapsed:         " << now() - start << "s" << endl;
+  if (peakResidentMiB() > options.memoryBytes / 1048576.0) {
+    cerr << "Note: names, titles and per-record tables alone take about " << tableBytes / 1048576.0
+         << " MiB; the limit can only hold the sort buffers down to " << 3 * kMinSortBytes / 1048576 << " MiB" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,209 @@
+using namespace std;
+#include <string.h>
+#include <coroutine>
+#include <exception>
+#include "imdb.h"
+
+/*
+ * *********************************************************************************************
+ * Interleaved lookups
+ *
+ * The binary searches of getActorIds/getMovieIds, as coroutines.  Every
+ * probe costs two dependent loads (the offset slot, then the record it
+ * points at), and each is prefetched and followed by a suspension, so the
+ * scheduler can start the loads of the other searches in flight before
+ * coming back to this one.  This is AMAC, with the compiler keeping each
+ * search's state rather than a hand-written state machine.
+ * *********************************************************************************************
+ */
+
+namespace {
+
+/**
+ * Class: lookup
+ * -------------
+ * A suspended binary search; its result is the id found, or 0.  It starts
+ * suspended, so nothing is touched until the scheduler first resumes it.
+ */
+class lookup {
+ public:
+    struct promise_type {
+        int id = 0;
+        lookup get_return_object() { return lookup(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_always final_suspend() noexcept { return {}; }
+        void return_value(const int found) { id = found; }
+        void unhandled_exception() { terminate(); }
+
+        // frames are recycled, since a batch starts one per name
+        static void *operator new(const size_t bytes);
+        static void operator delete(void *frame, const size_t bytes);
+    };
+
+    explicit lookup(coroutine_handle<promise_type> handle) : handle(handle) {}
+    lookup(const lookup&) = delete;
+    lookup& operator=(const lookup&) = delete;
+    coroutine_handle<promise_type> release() { coroutine_handle<promise_type> owned = handle; handle = nullptr; return owned; }
+    ~lookup() { if (handle) handle.destroy(); }
+
+ private:
+    coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Class: spareFrames
+ * ------------------
+ * Finished coroutine frames, kept by each thread for its next lookups.
+ * Actor and movie searches have frames of different sizes, so each is
+ * kept with its size.
+ */
+class spareFrames {
+ public:
+    ~spareFrames() { for (size_t i = 0; i < frames.size(); i++) ::operator delete(frames[i].second); }
+
+    void *take(const size_t bytes)
+    {
+        for (size_t i = frames.size(); i-- > 0; ) {
+            if (frames[i].first != bytes) continue;
+            void *frame = frames[i].second;
+            frames[i] = frames.back();
+            frames.pop_back();
+            return frame;
+        }
+        return ::operator new(bytes);
+    }
+
+    void give(void *frame, const size_t bytes)
+    {
+        if (frames.size() < kMaxFrames) frames.push_back(make_pair(bytes, frame));
+        else ::operator delete(frame);
+    }
+
+ private:
+    static const size_t kMaxFrames = 64;
+    vector<pair<size_t, void *> > frames;
+};
+
+thread_local spareFrames threadFrames;
+
+void *lookup::promise_type::operator new(const size_t bytes)
+{
+    return threadFrames.take(bytes);
+}
+
+void lookup::promise_type::operator delete(void *frame, const size_t bytes)
+{
+    threadFrames.give(frame, bytes);
+}
+
+// film::year's encoding in the movie file
+const int kBaseYear = 1900;
+
+template <typename T>
+lookup findActor(const T *offsets, const int count, const char *records, const string& player)
+{
+    int lower = 0, upper = count + 1; // exclusive bounds
+    while (upper - lower > 1) {
+        const int middle = lower + (upper - lower) / 2;
+        __builtin_prefetch(offsets + middle);
+        co_await suspend_always();
+        const char *name = records + offsets[middle];
+        __builtin_prefetch(name);
+        co_await suspend_always();
+        const int order = strcmp(name, player.c_str());
+        if (order == 0) co_return middle;
+        if (order < 0) lower = middle;
+        else upper = middle;
+    }
+    co_return 0;
+}
+
+template <typename T>
+lookup findMovie(const T *offsets, const int count, const char *records, const film& movie)
+{
+    int lower = 0, upper = count + 1;
+    while (upper - lower > 1) {
+        const int middle = lower + (upper - lower) / 2;
+        __builtin_prefetch(offsets + middle);
+        co_await suspend_always();
+        const char *title = records + offsets[middle];
+        __builtin_prefetch(title);
+        co_await suspend_always();
+        int order = strcmp(title, movie.title.c_str());
+        if (order == 0) order = kBaseYear + static_cast<int8_t>(title[strlen(title) + 1]) - movie.year;
+        if (order == 0) co_return middle;
+        if (order < 0) lower = middle;
+        else upper = middle;
+    }
+    co_return 0;
+}
+
+/**
+ * Function: interleave
+ * --------------------
+ * Runs start(key) for every key, at most inFlight at a time, resuming the
+ * live searches round robin and starting the next key in each slot as its
+ * search finishes.
+ */
+template <typename Key, typename Start>
+void interleave(const vector<Key>& keys, vector<int>& ids, const int inFlight, Start start)
+{
+    ids.assign(keys.size(), 0);
+    vector<coroutine_handle<lookup::promise_type> > slots;
+    vector<size_t> keyInSlot;
+    size_t next = 0;
+    for (; next < keys.size() && (int) slots.size() < inFlight; next++) {
+        slots.push_back(start(keys[next]).release());
+        keyInSlot.push_back(next);
+    }
+
+    size_t live = slots.size();
+    while (live > 0) {
+        for (size_t s = 0; s < slots.size(); s++) {
+            if (!slots[s]) continue;
+            slots[s].resume();
+            if (!slots[s].done()) continue;
+            ids[keyInSlot[s]] = slots[s].promise().id;
+            slots[s].destroy();
+            if (next < keys.size()) {
+                slots[s] = start(keys[next]).release();
+                keyInSlot[s] = next++;
+            } else {
+                slots[s] = nullptr;
+                live--;
+            }
+        }
+    }
+}
+
+}
+
+void imdb::getActorIds(const vector<string>& players, vector<int>& actorIds, const int inFlight) const
+{
+    const recordTable table = af_getRecordTable();
+    interleave(players, actorIds, max(inFlight, 1), [&table](const string& player) {
+        return table.wide ? findActor(static_cast<const WideOffsetInt*>(table.offsets), table.count, table.records, player)
+                          : findActor(static_cast<const OffsetInt*>(table.offsets), table.count, table.records, player);
+    });
+    if (!hasDelta) return;
+    for (size_t i = 0; i < players.size(); i++) {
+        if (actorIds[i] != 0) continue;
+        map<string, int>::const_iterator found = delta.playerIds.find(players[i]);
+        if (found != delta.playerIds.end()) actorIds[i] = found->second;
+    }
+}
+
+void imdb::getMovieIds(const vector<film>& movies, vector<int>& movieIds, const int inFlight) const
+{
+    const recordTable table = mf_getRecordTable();
+    interleave(movies, movieIds, max(inFlight, 1), [&table](const film& movie) {
+        return table.wide ? findMovie(static_cast<const WideOffsetInt*>(table.offsets), table.count, table.records, movie)
+                          : findMovie(static_cast<const OffsetInt*>(table.offsets), table.count, table.records, movie);
+    });
+    if (!hasDelta) return;
+    for (size_t i = 0; i < movies.size(); i++) {
+        if (movieIds[i] != 0) continue;
+        map<film, int>::const_iterator found = delta.filmIds.find(movies[i]);
+        if (found != delta.filmIds.end()) movieIds[i] = found->second;
+    }
+}
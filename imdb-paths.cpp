@@ -0,0 +1,100 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <unistd.h>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "graph-search.h"
+#include "path-writer.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+const int kMaxDepth = 6;
+
+/**
+ * Function: answerQueries
+ * -----------------------
+ * Reads source and target names, a tab between them, one pair per line,
+ * and writes each pair's shortest path.  A name the database doesn't know
+ * gets id 0 and no path.
+ *
+ * @return the number of queries answered
+ */
+template <typename Graph>
+size_t answerQueries(const Graph& graph, const imdb& db, pathWriter& writer)
+{
+  graphSearch<Graph> search(graph);
+  vector<int> hops;
+  string line;
+  size_t queries = 0;
+  while (getline(cin, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+    const size_t tab = line.find('\t');
+    if (tab == string::npos) continue;
+    const int source = db.getActorId(line.substr(0, tab)), target = db.getActorId(line.substr(tab + 1));
+    const bool found = source != 0 && target != 0 && search.shortestPath(source, target, kMaxDepth, hops);
+    writer.write(db, source, target, found, hops);
+    queries++;
+  }
+  return queries;
+}
+
+}
+
+/**
+ * Answers shortest path queries in bulk for other programs: pairs of
+ * names come in on standard input, a tab between them, and one JSON
+ * Lines record or TSV row per pair goes out on standard output (see
+ * pathWriter), buffered and written a megabyte at a time.  --compact
+ * searches graph.vbyte instead of the data files.  A summary goes to
+ * standard error.
+ *
+ * Usage: imdb-paths [--format jsonl|tsv] [--compact] <data-files-path> < pairs
+ */
+
+int main(int argc, char *argv[])
+{
+  string format = "jsonl", directory;
+  bool understood = true, compact = false;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--format" && i + 1 < argc) format = argv[++i];
+    else if (arg == "--compact") compact = true;
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || (format != "jsonl" && format != "tsv")) {
+    cerr << "Usage: imdb-paths [--format jsonl|tsv] [--compact] <data-files-path> < pairs" << endl;
+    return 1;
+  }
+
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  compactGraph graph(directory);
+  if (compact && !graph.good()) {
+    cerr << "No up-to-date compressed graph in " << directory << "; run graph-compress first." << endl;
+    return 1;
+  }
+
+  ios::sync_with_stdio(false);
+  pathWriter writer(STDOUT_FILENO, format == "tsv" ? pathWriter::kTsv : pathWriter::kJsonLines);
+  writer.writeHeader();
+  const double start = now();
+  const size_t queries = compact ? answerQueries(graph, db, writer) : answerQueries(db, db, writer);
+  writer.flush();
+  const double elapsed = now() - start;
+  if (!writer.good()) {
+    cerr << "Couldn't write the results." << endl;
+    return 1;
+  }
+  cerr << queries << " queries in " << fixed << setprecision(3) << elapsed << " s; " << writer.getBytesWritten()
+       << " bytes in " << writer.getWriteCount() << " writes" << endl;
+  return 0;
+}
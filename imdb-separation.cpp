@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <cstdlib>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "hyper-anf.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+const int kMaxDistance = 64;
+
+void printRound(int distance, double pairs, double seconds)
+{
+  cout << setw(8) << distance << setw(20) << setprecision(0) << pairs
+       << setw(12) << setprecision(3) << seconds << endl;
+}
+
+}
+
+/**
+ * Estimates how far apart the actors are, all pairs at once, with HyperANF
+ * (see hyperAnf): the number of pairs within each distance, then the mean
+ * separation and effective (90th percentile) diameter of the pairs that are
+ * connected at all.  Reads graph.vbyte if there is one, else the data files.
+ * More registers buy accuracy with memory: 2^log2 bytes three times over
+ * per actor.
+ *
+ * Usage: imdb-separation [--registers log2] [--threads n] <data-files-path>
+ */
+
+int main(int argc, char *argv[])
+{
+  int log2Registers = 6, threads = max(1u, thread::hardware_concurrency());
+  string directory;
+  bool understood = true;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--registers" && i + 1 < argc) log2Registers = atoi(argv[++i]);
+    else if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || log2Registers < 4 || log2Registers > 12 || threads <= 0) {
+    cerr << "Usage: imdb-separation [--registers log2] [--threads n] <data-files-path>" << endl;
+    return 1;
+  }
+
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+
+  double start = now();
+  compactGraph graph(directory);
+  hyperAnf *anf = graph.good() ? new hyperAnf(graph, log2Registers) : new hyperAnf(db, log2Registers);
+  cout << "read " << (graph.good() ? "graph.vbyte" : "the data files") << " in " << fixed << setprecision(3)
+       << now() - start << " s; " << (1 << log2Registers) << " registers per counter, " << threads << " threads" << endl;
+  cout << "distance        pairs within     seconds" << endl;
+
+  start = now();
+  anf->run(threads, kMaxDistance, printRound);
+  const double elapsed = now() - start;
+
+  cout << "mean separation     " << setprecision(3) << anf->getMeanSeparation() << endl;
+  cout << "effective diameter  " << anf->getEffectiveDiameter() << endl;
+  cout << "connected pairs     " << setprecision(0) << anf->getConnectedPairs() << endl;
+  cout << "total seconds       " << setprecision(3) << elapsed << endl;
+  delete anf;
+  return 0;
+}
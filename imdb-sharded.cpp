@@ -0,0 +1,171 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "imdb.h"
+#include "graph-shard.h"
+#include "sharded-search.h"
+#include "graph-search.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+const int kMaxDepth = 6;
+
+size_t fileBytes(const string& fileName)
+{
+  struct stat stats;
+  return stat(fileName.c_str(), &stats) == 0 ? stats.st_size : 0;
+}
+
+/**
+ * Function: isPath
+ * ----------------
+ * Checks hops (movie, actor, ..., target) hop by hop against the data
+ * files: every movie has to be in the credits of the actors on either side.
+ */
+bool isPath(const imdb& db, const int source, const int target, const vector<int>& hops)
+{
+  if (hops.size() % 2 != 0 || (!hops.empty() && hops.back() != target)) return false;
+  vector<int> credits;
+  int actor = source;
+  for (size_t i = 0; i < hops.size(); i += 2) {
+    db.getCreditIds(actor, credits);
+    if (find(credits.begin(), credits.end(), hops[i]) == credits.end()) return false;
+    actor = hops[i + 1];
+    db.getCreditIds(actor, credits);
+    if (find(credits.begin(), credits.end(), hops[i]) == credits.end()) return false;
+  }
+  return actor == target;
+}
+
+}
+
+/**
+ * Runs shortest path searches across shard worker processes (see
+ * shardedSearch), checking every answer against graphSearch over the data
+ * files, and reports what crossed between the workers at each level.
+ * The shard files are built next to the data files the first time, and
+ * rebuilt whenever the data files or credits.delta have changed since.
+ *
+ * Usage: imdb-sharded [--shards n] [--pairs n] [--seed n] <data-files-path>
+ */
+
+int main(int argc, char *argv[])
+{
+  int shardCount = 4, pairCount = 200;
+  uint64_t seed = 1;
+  string directory;
+  bool understood = true;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--shards" && i + 1 < argc) shardCount = atoi(argv[++i]);
+    else if (arg == "--pairs" && i + 1 < argc) pairCount = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || shardCount <= 0 || shardCount > 256 || pairCount <= 0) {
+    cerr << "Usage: imdb-sharded [--shards n] [--pairs n] [--seed n] <data-files-path>" << endl;
+    return 1;
+  }
+
+  cout << fixed;
+  if (!graphShard::isCurrent(directory, shardCount)) {
+    // scoped, so the workers forked below don't inherit the mapped data files
+    imdb db(directory);
+    if (!db.good()) {
+      cerr << "Data directory not found! Aborting..." << endl;
+      return 1;
+    }
+    const double start = now();
+    if (!graphShard::build(db, directory, shardCount)) {
+      cerr << "Couldn't write the shard files to " << directory << "." << endl;
+      return 1;
+    }
+    cout << "built " << shardCount << " shards in " << setprecision(3) << now() - start << " s" << endl;
+  }
+
+  shardedSearch sharded(directory, shardCount);
+  if (!sharded.good()) {
+    cerr << "Couldn't start a worker on every shard! Aborting..." << endl;
+    return 1;
+  }
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  if (sharded.getActorCount() != db.getActorCount() || sharded.getMovieCount() != db.getMovieCount()) {
+    cerr << "The data files changed under the shards! Aborting..." << endl;
+    return 1;
+  }
+
+  size_t shardTotal = 0;
+  for (int shard = 0; shard < shardCount; shard++) shardTotal += sharded.getShardBytes(shard);
+  const size_t dataTotal = fileBytes(directory + "/actors.data") + fileBytes(directory + "/movies.data");
+  cout << shardCount << " shards of " << setprecision(1) << shardTotal / (1024.0 * 1024.0) / shardCount
+       << " MiB on average (the data files are " << dataTotal / (1024.0 * 1024.0) << " MiB)" << endl;
+
+  // every query's steps, summed by level and step
+  const vector<pair<int, int> > pairs = pickPairs(db, pairCount, seed);
+  vector<shardedSearch::stepReport> totals;
+  vector<int> queries;
+  graphSearch<imdb> reference(db);
+  vector<int> hops, expected;
+  int found = 0, mismatches = 0;
+  double shardedSeconds = 0;
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const double start = now();
+    const bool connected = sharded.shortestPath(pairs[i].first, pairs[i].second, kMaxDepth, hops);
+    shardedSeconds += now() - start;
+    if (!sharded.good()) {
+      cerr << "A worker stopped answering! Aborting..." << endl;
+      return 1;
+    }
+    const bool expectedConnected = reference.shortestPath(pairs[i].first, pairs[i].second, kMaxDepth, expected);
+    if (connected) found++;
+    if (connected != expectedConnected || hops.size() != expected.size() ||
+        (connected && !isPath(db, pairs[i].first, pairs[i].second, hops))) mismatches++;
+
+    const vector<shardedSearch::stepReport>& steps = sharded.getSteps();
+    for (size_t s = 0; s < steps.size(); s++) {
+      if (s == totals.size()) {
+        totals.push_back(steps[s]);
+        totals.back().expanded = totals.back().localPairs = totals.back().remotePairs = totals.back().bytes = 0;
+        totals.back().seconds = 0;
+        queries.push_back(0);
+      }
+      totals[s].expanded += steps[s].expanded;
+      totals[s].localPairs += steps[s].localPairs;
+      totals[s].remotePairs += steps[s].remotePairs;
+      totals[s].bytes += steps[s].bytes;
+      totals[s].seconds += steps[s].seconds;
+      queries[s]++;
+    }
+  }
+
+  cout << "averages over the queries reaching each step:" << endl;
+  cout << "   level    step   queries    expanded  local pairs remote pairs        KiB        ms" << endl;
+  int64_t remoteTotal = 0, bytesTotal = 0;
+  for (size_t s = 0; s < totals.size(); s++) {
+    const double n = queries[s];
+    cout << setw(8) << totals[s].level << setw(8) << (totals[s].cast ? "cast" : "credits") << setw(10) << queries[s]
+         << setprecision(0) << setw(12) << totals[s].expanded / n << setw(13) << totals[s].localPairs / n
+         << setw(13) << totals[s].remotePairs / n << setprecision(1) << setw(11) << totals[s].bytes / n / 1024.0
+         << setprecision(3) << setw(10) << 1000 * totals[s].seconds / n << endl;
+    remoteTotal += totals[s].remotePairs;
+    bytesTotal += totals[s].bytes;
+  }
+  cout << pairs.size() << " queries, " << found << " connected, in " << setprecision(3) << shardedSeconds << " s ("
+       << setprecision(1) << pairs.size() / shardedSeconds << " per second); " << setprecision(0)
+       << (double) remoteTotal / pairs.size() << " pairs and " << setprecision(1) << bytesTotal / 1024.0 / pairs.size()
+       << " KiB crossed per query" << endl;
+  cout << mismatches << " disagreed with graphSearch over the data files" << endl;
+  return mismatches == 0 ? 0 : 1;
+}
@@ -1,9 +1,8 @@
 #include <iostream>
 #include <iomanip> // for setw formatter
-#include <map>
-#include <set>
 #include <string>
 #include "imdb.h"
+#include "name-index.h"
 using namespace std;
 
 namespace {
@@ -75,43 +74,29 @@ void listMovies(const string& player, const vector<film>& credits)
 /**
  * Function: listCostars
  * ---------------------
- * Builds up the list of costars and then prints all these
- * costars in a format similar to that used by listMovies.
- * The STL set is used to collect actor/actress names without
- * storing duplicates.
+ * Counts the costars and then prints these costars
+ * in a format similar to that used by listMovies.
+ * The counting is done by imdb::getCostars on ids, so
+ * only the names actually printed are ever looked up.
  *
  * @param player the actor/actress of interest.
- * @param credits the list of movies that the specified actor/actress has appeared in.
- *                (No integrity checks are done, so it's the client's responsibility to make sure
- *                 the specified actor/actress really has appeared in these movies.)
- * @param db the imdb housing the specified plater, list of movies, etc.  This is passed in
- *           so that each member of each cast of each movie can be added to the specified player's
- *           set of costars.
+ * @param db the imdb housing the specified player.
  */
 
-void listCostars(const string &player, const vector<film>& credits, const imdb& db)
+void listCostars(const string &player, const imdb& db)
 {
   const unsigned int kNumCostarsToPrint = 10;
-  map<string, set<film> > costars;
-  for (int i = 0; i < (int) credits.size(); i++) {
-    const film& movie = credits[i];
-    vector<string> cast;
-    db.getCast(movie, cast);
-    for (int j = 0; j < (int) cast.size(); j++) {
-      const string& costar = cast[j];
-      if (costar != player) costars[costar].insert(movie);
-    }
-  }
+  vector<imdb::costar> costars;
+  db.getCostars(db.getActorId(player), costars);
   
   cout << player << " has worked with " << (int) costars.size() << " other people." << endl;
   cout << "Those other people are:" << endl;
   
   unsigned int numCostars = 0;
-  map<string, set<film> >::const_iterator curr;
+  vector<imdb::costar>::const_iterator curr;
   for (curr = costars.begin(); curr != costars.end() && numCostars < kNumCostarsToPrint; ++curr) {
-    const string& costar = curr->first;
-    cout << setw(5) << ++numCostars << ".) " << costar;
-    if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
+    cout << setw(5) << ++numCostars << ".) " << db.getActorName(curr->actorId);
+    if (curr->sharedFilms > 1) cout << " (in " << curr->sharedFilms << " different films)";
     cout << endl;
   }
 
@@ -119,9 +104,8 @@ void listCostars(const string &player, const vector<film>& credits, const imdb&
     if (costars.size() > 2 * kNumCostarsToPrint) printFill();
     while (numCostars < costars.size() - kNumCostarsToPrint) { numCostars++; ++curr; }
     for (; curr != costars.end(); ++curr) {
-      const string& costar = curr->first;
-      cout << setw(5) << ++numCostars << ".) " << costar;
-      if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
+      cout << setw(5) << ++numCostars << ".) " << db.getActorName(curr->actorId);
+      if (curr->sharedFilms > 1) cout << " (in " << curr->sharedFilms << " different films)";
       cout << endl;
     }
   }
@@ -148,21 +132,31 @@ void listCostars(const string &player, const vector<film>& credits, const imdb&
  * @param db the imdb being queried.  The assumption is that
  *           the imdb is legitimate and has already passed its own
  *           good test.
+ * @param names the name index used to suggest who the user might
+ *              have meant when the player can't be found.
  */
 
 void listAllMoviesAndCostars(const string& player,
-				    const imdb& db)
+				    const imdb& db, const nameIndex& names)
 {
   vector<film> credits;
   if (!db.getCredits(player, credits) || credits.size() == 0) {
     cout << "We're sorry, but " << player 
 	 << " doesn't appear to be in our database." << endl;
-    cout << "Perhaps someone else?" << endl;
+    vector<suggestion> matches;
+    names.complete(player, 5, matches, nameIndex::kActorName);
+    if (matches.empty()) names.suggest(player, 5, matches, nameIndex::kActorName);
+    if (matches.empty()) {
+      cout << "Perhaps someone else?" << endl;
+    } else {
+      cout << "Perhaps one of these?" << endl;
+      for (int i = 0; i < (int) matches.size(); i++) cout << "    " << matches[i].name << endl;
+    }
     return;
   }
   
   listMovies(player, credits);
-  listCostars(player, credits, db);
+  listCostars(player, db);
 }
 
 /**
@@ -179,16 +173,17 @@ void listAllMoviesAndCostars(const string& player,
  * 
  * @param db a const reference to the imdb that should
  *           queried.
+ * @param names the name index over the same imdb.
  */
 
-void queryForActors(const imdb& db)
+void queryForActors(const imdb& db, const nameIndex& names)
 {
   while (true) {
     cout << "Please enter the name of an actor or actress (or [enter] to quit): ";
     string response;
     getline(cin, response);
     if (cin.fail() || response == "") return;
-    listAllMoviesAndCostars(response, db);
+    listAllMoviesAndCostars(response, db, names);
   }
 }
 
@@ -215,7 +210,8 @@ int main(int argc, char *argv[])
     cerr << "Data directory not found! Aborting..." << endl; 
     return 1; 
   }
-  queryForActors(db);
+  nameIndex names(argv[1], db);
+  queryForActors(db, names);
   
   return 0;
 }
@@ -0,0 +1,633 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <stdint.h>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "graph-shard.h"
+#include "sharded-search.h"
+#include "graph-search.h"
+#include "all-shortest-paths.h"
+#include "weighted-search.h"
+#include "search-filter.h"
+#include "path-cache.h"
+#include "name-search.h"
+#include "query-arena.h"
+#include "path.h"
+#include "bench-utils.h"
+using namespace std;
+
+namespace {
+
+const int kMaxDepth = 6;
+
+/**
+ * Function: readPairs
+ * -------------------
+ * Pairs up the names in a file, one per line (as in input.txt): every
+ * name with every later one, until there are count pairs.  Names the
+ * database doesn't know are left out.
+ *
+ * @return false if the file can't be read
+ */
+bool readPairs(const imdb& db, const string& fileName, const int count, vector<pair<string, string> >& pairs)
+{
+  ifstream in(fileName.c_str());
+  if (!in) return false;
+  vector<string> names;
+  string line;
+  while (getline(in, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+    if (db.getActorId(line) != 0 && find(names.begin(), names.end(), line) == names.end()) names.push_back(line);
+  }
+  for (size_t i = 0; i < names.size(); i++) {
+    for (size_t j = i + 1; j < names.size() && (int) pairs.size() < count; j++) {
+      pairs.push_back(make_pair(names[i], names[j]));
+    }
+  }
+  return true;
+}
+
+/**
+ * Struct: oracleRules
+ * -------------------
+ * What a query asks for, in the terms of the imdb's string interface: the
+ * price of going through a film, which films and players may be used, and
+ * the most a path may cost (the depth, when every film costs 1).
+ */
+struct oracleRules {
+  function<unsigned(const film&)> cost;
+  function<bool(const film&)> allowsFilm;
+  function<bool(const string&)> allowsPlayer;
+  uint64_t maxCost;
+};
+
+/**
+ * Function: oraclePath
+ * --------------------
+ * The answer every engine is held to, written here from scratch so that
+ * it shares no code with any of them: Dijkstra's algorithm, by name, over
+ * getCredits and getCast, with standard maps and a priority queue and
+ * nothing cached from one query to the next.  When every film costs 1 it
+ * is a plain breadth first search.  A film is expanded the first time one
+ * of its cast is settled, since none of the rest can be closer.
+ *
+ * @return a cheapest path the rules allow, or an empty one
+ */
+path oraclePath(const imdb& db, const string& source, const string& target, const oracleRules& rules)
+{
+  if (!rules.allowsPlayer(source) || !rules.allowsPlayer(target)) return path("");
+  typedef pair<uint64_t, string> entry;
+  priority_queue<entry, vector<entry>, greater<entry> > frontier;
+  map<string, uint64_t> distance;
+  map<string, pair<film, string> > via;     // the film and player each player was reached through
+  set<film> expanded;
+  vector<film> credits;
+  vector<string> cast;
+
+  distance[source] = 0;
+  frontier.push(entry(0, source));
+  while (!frontier.empty()) {
+    const entry next = frontier.top();
+    frontier.pop();
+    if (next.first != distance[next.second]) continue;  // reached more cheaply since
+    if (next.second == target) {
+      vector<string> players(1, target);
+      while (players.back() != source) players.push_back(via[players.back()].second);
+      path p(source);
+      for (size_t i = players.size() - 1; i-- > 0;) p.addConnection(via[players[i]].first, players[i]);
+      return p;
+    }
+    credits.clear();
+    db.getCredits(next.second, credits);
+    for (size_t f = 0; f < credits.size(); f++) {
+      if (!rules.allowsFilm(credits[f]) || !expanded.insert(credits[f]).second) continue;
+      const uint64_t reached = next.first + rules.cost(credits[f]);
+      if (reached > rules.maxCost) continue;
+      cast.clear();
+      db.getCast(credits[f], cast);
+      for (size_t c = 0; c < cast.size(); c++) {
+        if (!rules.allowsPlayer(cast[c])) continue;
+        map<string, uint64_t>::iterator known = distance.find(cast[c]);
+        if (known != distance.end() && known->second <= reached) continue;
+        distance[cast[c]] = reached;
+        via[cast[c]] = make_pair(credits[f], next.second);
+        frontier.push(entry(reached, cast[c]));
+      }
+    }
+  }
+  return path("");
+}
+
+/**
+ * Function: isValidPath
+ * ---------------------
+ * Checks a path link by link against the original string interface:
+ * it has to run from source to target, only through films and players
+ * the rules allow, and both players of every link have to be in that
+ * link's movie's cast.
+ */
+bool isValidPath(const imdb& db, const path& p, const string& source, const string& target, const oracleRules& rules)
+{
+  if (p.getPlayer(0) != source || p.getLastPlayer() != target || !rules.allowsPlayer(source)) return false;
+  vector<string> cast;
+  for (int i = 0; i < p.getLength(); i++) {
+    if (!rules.allowsFilm(p.getMovie(i)) || !rules.allowsPlayer(p.getPlayer(i + 1))) return false;
+    cast.clear();
+    if (!db.getCast(p.getMovie(i), cast)) return false;
+    if (find(cast.begin(), cast.end(), p.getPlayer(i)) == cast.end()) return false;
+    if (find(cast.begin(), cast.end(), p.getPlayer(i + 1)) == cast.end()) return false;
+  }
+  return true;
+}
+
+/**
+ * Function: pathCost
+ * ------------------
+ * @return what the rules say a path costs, or -1 for an empty one
+ */
+int64_t pathCost(const path& p, const oracleRules& rules)
+{
+  if (p.getLength() == 0) return -1;
+  int64_t total = 0;
+  for (int i = 0; i < p.getLength(); i++) total += rules.cost(p.getMovie(i));
+  return total;
+}
+
+// prices every movie at 1, so weightedSearch finds shortest paths
+struct unitCost {
+  unsigned operator()(const int) const { return 1; }
+};
+
+/**
+ * Struct: engine
+ * --------------
+ * One search over one storage backend.  run answers a query by name,
+ * leaving the path (empty if there is none) in p.  An engine that isn't
+ * timed is still checked, but its time means nothing (a cache that was
+ * filled with the answers beforehand, say).
+ */
+struct engine {
+  string name, backend;
+  function<void(const string& source, const string& target, path& p)> run;
+  bool timed;
+};
+
+struct engineReport {
+  int found, disagreed, invalid;
+  double seconds;
+};
+
+/**
+ * Function: runEngine
+ * -------------------
+ * Answers every pair with an engine, timing only the searches, then
+ * compares what each answer costs under the rules with the reference
+ * costs (-1 where there is no path) and checks every path it found.  With
+ * no reference costs yet, the engine is the reference: its costs are
+ * taken, and the players on its paths added to players.
+ */
+engineReport runEngine(const engine& e, const imdb& db, const vector<pair<string, string> >& pairs,
+                       const oracleRules& rules, vector<int64_t>& costs, set<string>& players)
+{
+  engineReport report = engineReport();
+  vector<path> answers(pairs.size(), path(""));
+  const double start = now();
+  for (size_t i = 0; i < pairs.size(); i++) e.run(pairs[i].first, pairs[i].second, answers[i]);
+  report.seconds = now() - start;
+
+  const bool reference = costs.empty();
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const int64_t cost = pathCost(answers[i], rules);
+    if (reference) {
+      costs.push_back(cost);
+      for (int j = 1; j < answers[i].getLength(); j++) players.insert(answers[i].getPlayer(j));
+      players.insert(pairs[i].first);
+      players.insert(pairs[i].second);
+    }
+    if (cost > 0) report.found++;
+    if (cost != costs[i]) report.disagreed++;
+    if (cost > 0 && !isValidPath(db, answers[i], pairs[i].first, pairs[i].second, rules)) report.invalid++;
+  }
+  return report;
+}
+
+/**
+ * Function: runEngines
+ * --------------------
+ * Runs every engine under the same rules, the first being the reference,
+ * and prints a table of how each did, its speed relative to the reference.
+ *
+ * @return the number of disagreements and invalid paths
+ */
+int runEngines(const vector<engine>& engines, const imdb& db, const vector<pair<string, string> >& pairs,
+               const oracleRules& rules, set<string>& players)
+{
+  vector<int64_t> costs;
+  int failures = 0;
+  double referenceSeconds = 0;
+  cout << fixed << "engine     backend          found  disagreed  invalid     seconds  speedup" << endl;
+  for (size_t i = 0; i < engines.size(); i++) {
+    const engineReport report = runEngine(engines[i], db, pairs, rules, costs, players);
+    if (i == 0) referenceSeconds = report.seconds;
+    failures += report.disagreed + report.invalid;
+    cout << left << setw(11) << engines[i].name << setw(15) << engines[i].backend << right << setw(7) << report.found
+         << setw(11) << report.disagreed << setw(9) << report.invalid;
+    if (engines[i].timed) {
+      cout << setprecision(3) << setw(12) << report.seconds
+           << setprecision(1) << setw(8) << referenceSeconds / max(report.seconds, 1e-9) << "x" << endl;
+    } else {
+      cout << setw(12) << "-" << setw(9) << "-" << endl;
+    }
+  }
+  return failures;
+}
+
+/**
+ * Struct: storageReport
+ * ---------------------
+ * How many lists a backend was asked for, and how many differed from the
+ * file mapped imdb's.
+ */
+struct storageReport {
+  string backend;
+  int lists, mismatches;
+};
+
+/**
+ * Function: checkStorage
+ * ----------------------
+ * Compares every backend's credits of the given actors, and casts of those
+ * credits, with the file mapped imdb's: by name for the in-memory imdb's
+ * string interface, by id for everything else.  The batched name lookups
+ * are checked against the one at a time ones on the same names and films.
+ */
+vector<storageReport> checkStorage(const imdb& db, const imdb& loaded, const compactGraph *graph,
+                                   const vector<graphShard *>& shards, const set<string>& players)
+{
+  storageReport names = { "in-memory (names)", 0, 0 }, ids = { "in-memory (ids)", 0, 0 };
+  storageReport compact = { "graph.vbyte", 0, 0 }, sharded = { "shard files", 0, 0 };
+  storageReport lookups = { "batched lookups", 0, 0 };
+  vector<string> playerNames(players.begin(), players.end());
+  vector<film> films;
+  vector<int> expected, actual;
+  vector<film> credits, loadedCredits;
+  vector<string> cast, loadedCast;
+
+  for (size_t i = 0; i < playerNames.size(); i++) {
+    db.getCredits(playerNames[i], credits);
+    loaded.getCredits(playerNames[i], loadedCredits);
+    names.lists++;
+    if (credits != loadedCredits) names.mismatches++;
+    films.insert(films.end(), credits.begin(), credits.end());
+
+    const int actor = db.getActorId(playerNames[i]);
+    db.getCreditIds(actor, expected);
+    loaded.getCreditIds(actor, actual);
+    ids.lists++;
+    if (actual != expected) ids.mismatches++;
+    if (graph != NULL) {
+      graph->getCreditIds(actor, actual);
+      compact.lists++;
+      if (actual != expected) compact.mismatches++;
+    }
+    if (!shards.empty()) {
+      shards[graphShard::ownerOf(actor, shards.size())]->getCreditIds(actor, actual);
+      sharded.lists++;
+      if (actual != expected) sharded.mismatches++;
+    }
+  }
+
+  sort(films.begin(), films.end());
+  films.erase(unique(films.begin(), films.end()), films.end());
+  for (size_t i = 0; i < films.size(); i++) {
+    db.getCast(films[i], cast);
+    loaded.getCast(films[i], loadedCast);
+    names.lists++;
+    if (cast != loadedCast) names.mismatches++;
+
+    const int movie = db.getMovieId(films[i]);
+    db.getCastIds(movie, expected);
+    loaded.getCastIds(movie, actual);
+    ids.lists++;
+    if (actual != expected) ids.mismatches++;
+    if (graph != NULL) {
+      graph->getCastIds(movie, actual);
+      compact.lists++;
+      if (actual != expected) compact.mismatches++;
+    }
+    if (!shards.empty()) {
+      shards[graphShard::ownerOf(movie, shards.size())]->getCastIds(movie, actual);
+      sharded.lists++;
+      if (actual != expected) sharded.mismatches++;
+    }
+  }
+
+  // a name nobody has, to check misses come back as 0 too
+  playerNames.push_back(playerNames.empty() ? "" : playerNames[0] + " (no such person)");
+  db.getActorIds(playerNames, actual);
+  for (size_t i = 0; i < playerNames.size(); i++) {
+    lookups.lists++;
+    if (actual[i] != db.getActorId(playerNames[i])) lookups.mismatches++;
+  }
+  db.getMovieIds(films, actual);
+  for (size_t i = 0; i < films.size(); i++) {
+    lookups.lists++;
+    if (actual[i] != db.getMovieId(films[i])) lookups.mismatches++;
+  }
+
+  vector<storageReport> reports;
+  reports.push_back(names);
+  reports.push_back(ids);
+  if (graph != NULL) reports.push_back(compact);
+  if (!shards.empty()) reports.push_back(sharded);
+  reports.push_back(lookups);
+  return reports;
+}
+
+}
+
+/**
+ * Checks the faster search engines and storage backends against an
+ * independent oracle before they are trusted.  Pairs of actors, picked at
+ * random (--seed) or taken from a file of names such as input.txt
+ * (--names), are searched by every engine available:
+ *
+ *     oracle     oraclePath, the reference: Dijkstra by name over getCredits
+ *                and getCast, written here and sharing no code with the rest
+ *     names      generateShortestPath
+ *     ids        graphSearch over the file mapped imdb
+ *     in-memory  graphSearch over the imdb loaded into memory
+ *     compact    graphSearch over graph.vbyte, if there is one
+ *     all-paths  the first of allShortestPaths' paths
+ *     weighted   weightedSearch with every movie costing 1
+ *     cached     a pathCache filled with the reverse of every query first,
+ *                so every answer is a reversed cached path (not timed)
+ *     sharded    shardedSearch over --shards n shard files (built if missing or stale)
+ *
+ * The pairs are then searched again under a searchFilter, by graphSearch
+ * and allShortestPaths, through only the newer half of the movies and
+ * around the movies and actors of the first pair's path; and by
+ * weightedSearch, for the cheapest paths under recentFilmCost.  The
+ * oracle answers both under the same rules.
+ *
+ * Every engine has to agree with the oracle on what each path costs (its
+ * length, unless the movies are priced) or on there being none, and every
+ * path has to keep to the rules and be valid link by link by getCast.
+ * The credits and casts the paths are made of are compared across the
+ * backends too.  Generated data (imdb-generate) works the same as real
+ * data.  The exit status is 0 only if everything agreed.
+ *
+ * Usage: imdb-verify [--pairs n] [--seed n] [--names file] [--shards n] <data-files-path>
+ */
+
+int main(int argc, char *argv[])
+{
+  int pairCount = 100, shardCount = 0;
+  uint64_t seed = 1;
+  string directory, namesFile;
+  bool understood = true;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--pairs" && i + 1 < argc) pairCount = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if (arg == "--names" && i + 1 < argc) namesFile = argv[++i];
+    else if (arg == "--shards" && i + 1 < argc) shardCount = atoi(argv[++i]);
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || pairCount <= 0 || shardCount < 0 || shardCount > 256) {
+    cerr << "Usage: imdb-verify [--pairs n] [--seed n] [--names file] [--shards n] <data-files-path>" << endl;
+    return 1;
+  }
+
+  // the shard workers are forked before anything big is mapped or loaded
+  shardedSearch *sharded = NULL;
+  if (shardCount > 0) {
+    if (!graphShard::isCurrent(directory, shardCount)) {
+      imdb db(directory);
+      if (!db.good() || !graphShard::build(db, directory, shardCount)) {
+        cerr << "Couldn't write the shard files to " << directory << "." << endl;
+        return 1;
+      }
+    }
+    sharded = new shardedSearch(directory, shardCount);
+    if (!sharded->good()) {
+      cerr << "Couldn't start a worker on every shard! Aborting..." << endl;
+      return 1;
+    }
+  }
+
+  imdb db(directory);
+  imdb loaded(directory, imdb::kInMemory);
+  if (!db.good() || !loaded.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  if (sharded != NULL &&
+      (sharded->getActorCount() != db.getActorCount() || sharded->getMovieCount() != db.getMovieCount())) {
+    cerr << "The data files changed under the shards! Aborting..." << endl;
+    return 1;
+  }
+  compactGraph compact(directory);
+  const compactGraph *graph = compact.good() ? &compact : NULL;
+  vector<graphShard *> shards;
+  for (int shard = 0; shard < shardCount; shard++) {
+    shards.push_back(new graphShard(directory, shard, shardCount));
+    if (!shards.back()->good()) {
+      cerr << "The data files changed under the shards! Aborting..." << endl;
+      return 1;
+    }
+  }
+
+  vector<pair<string, string> > pairs;
+  if (namesFile.empty()) {
+    const vector<pair<int, int> > picked = pickPairs(db, pairCount, seed);
+    for (size_t i = 0; i < picked.size(); i++) {
+      pairs.push_back(make_pair(db.getActorName(picked[i].first), db.getActorName(picked[i].second)));
+    }
+  } else if (!readPairs(db, namesFile, pairCount, pairs)) {
+    cerr << "Couldn't read " << namesFile << "." << endl;
+    return 1;
+  }
+
+  cout << pairs.size() << " pairs " << (namesFile.empty() ? "picked at random" : "of names from " + namesFile)
+       << ", " << db.getActorCount() << " actors and " << db.getMovieCount() << " movies" << endl;
+  if (pairs.empty()) return 0;
+
+  // the constrained searches use the newer half of the movies, and keep off the first pair's path
+  int newest = 0;
+  vector<int> allYears;
+  for (int movie = 1; movie <= db.getMovieCount(); movie++) allYears.push_back(db.getMovieYear(movie));
+  nth_element(allYears.begin(), allYears.begin() + allYears.size() / 2, allYears.end());
+  const int firstYear = allYears[allYears.size() / 2];
+  for (size_t i = 0; i < allYears.size(); i++) newest = max(newest, allYears[i]);
+
+  const oracleRules shortest = {
+    [](const film&) { return 1u; }, [](const film&) { return true; }, [](const string&) { return true; }, kMaxDepth
+  };
+  const path firstPath = oraclePath(db, pairs[0].first, pairs[0].second, shortest);
+  set<film> avoidedFilms;
+  set<string> avoidedPlayers;
+  for (int i = 0; i < firstPath.getLength(); i++) avoidedFilms.insert(firstPath.getMovie(i));
+  for (int i = 1; i < firstPath.getLength(); i++) avoidedPlayers.insert(firstPath.getPlayer(i));
+  const oracleRules constrained = {
+    [](const film&) { return 1u; },
+    [&](const film& movie) { return movie.year >= firstYear && movie.year <= newest && avoidedFilms.count(movie) == 0; },
+    [&](const string& player) { return avoidedPlayers.count(player) == 0; },
+    kMaxDepth
+  };
+  const oracleRules cheapest = {
+    [&](const film& movie) { return unsigned(1 + newest - movie.year); },
+    [](const film&) { return true; }, [](const string&) { return true; }, UINT64_MAX
+  };
+
+  const movieYears years(db);
+  searchFilter filter(years, db.getActorCount());
+  filter.setYearRange(firstYear, newest);
+  for (set<film>::const_iterator f = avoidedFilms.begin(); f != avoidedFilms.end(); ++f) {
+    filter.excludeMovie(db.getMovieId(*f));
+  }
+  for (set<string>::const_iterator a = avoidedPlayers.begin(); a != avoidedPlayers.end(); ++a) {
+    filter.excludeActor(db.getActorId(*a));
+  }
+  const recentFilmCost recent(years);
+
+  queryArena arena;
+  const queryOptions unlimited;
+  graphSearch<imdb> idSearch(db), loadedSearch(loaded);
+  graphSearch<compactGraph> *compactSearch = graph != NULL ? new graphSearch<compactGraph>(compact) : NULL;
+  allShortestPaths<imdb> allPaths(db);
+  weightedSearch<imdb> weighted(db), loadedWeighted(loaded);
+  weightedSearch<compactGraph> *compactWeighted = graph != NULL ? new weightedSearch<compactGraph>(compact) : NULL;
+  pathCache cache(size_t(64) << 20);
+  vector<int> hops;
+  uint64_t total;
+
+  vector<engine> engines;
+  engines.push_back({ "oracle", "file mapped", [&](const string& source, const string& target, path& p) {
+    p = oraclePath(db, source, target, shortest);
+  }, true });
+  engines.push_back({ "names", "file mapped", [&](const string& source, const string& target, path& p) {
+    queryStatus status;
+    p = generateShortestPath(db, source, target, unlimited, status, arena);
+    arena.reset();
+  }, true });
+  engines.push_back({ "ids", "file mapped", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    p = idSearch.shortestPath(sourceId, db.getActorId(target), kMaxDepth, hops) ? makePath(db, sourceId, hops) : path("");
+  }, true });
+  engines.push_back({ "in-memory", "in-memory", [&](const string& source, const string& target, path& p) {
+    const int sourceId = loaded.getActorId(source);
+    p = loadedSearch.shortestPath(sourceId, loaded.getActorId(target), kMaxDepth, hops) ? makePath(loaded, sourceId, hops)
+                                                                                       : path("");
+  }, true });
+  if (compactSearch != NULL) {
+    engines.push_back({ "compact", "graph.vbyte", [&](const string& source, const string& target, path& p) {
+      const int sourceId = db.getActorId(source);
+      p = compactSearch->shortestPath(sourceId, db.getActorId(target), kMaxDepth, hops) ? makePath(db, sourceId, hops)
+                                                                                         : path("");
+    }, true });
+  }
+  engines.push_back({ "all-paths", "file mapped", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    p = allPaths.build(sourceId, db.getActorId(target), kMaxDepth) && allPaths.nextPath(hops) ? makePath(db, sourceId, hops)
+                                                                                              : path("");
+  }, true });
+  engines.push_back({ "weighted", "file mapped", [&](const string& source, const string& target, path& p) {
+    // weightedSearch has no depth limit, so paths longer than the others may go count as none
+    const int sourceId = db.getActorId(source);
+    const bool found = weighted.cheapestPath(sourceId, db.getActorId(target), unitCost(), hops, total);
+    p = found && total <= (uint64_t) kMaxDepth ? makePath(db, sourceId, hops) : path("");
+  }, true });
+  engines.push_back({ "cached", "path cache", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    bool found;
+    if (!cache.lookup(sourceId, db.getActorId(target), found, hops)) found = false;
+    p = found ? makePath(db, sourceId, hops) : path("");
+  }, false });
+  if (sharded != NULL) {
+    engines.push_back({ "sharded", "shard files", [&](const string& source, const string& target, path& p) {
+      const int sourceId = db.getActorId(source);
+      p = sharded->shortestPath(sourceId, db.getActorId(target), kMaxDepth, hops) ? makePath(db, sourceId, hops) : path("");
+    }, true });
+  }
+
+  vector<engine> constrainedEngines;
+  constrainedEngines.push_back({ "oracle", "file mapped", [&](const string& source, const string& target, path& p) {
+    p = oraclePath(db, source, target, constrained);
+  }, true });
+  constrainedEngines.push_back({ "ids", "file mapped", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    p = idSearch.shortestPath(sourceId, db.getActorId(target), kMaxDepth, hops, filter) ? makePath(db, sourceId, hops)
+                                                                                         : path("");
+  }, true });
+  constrainedEngines.push_back({ "all-paths", "file mapped", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    p = allPaths.build(sourceId, db.getActorId(target), kMaxDepth, filter) && allPaths.nextPath(hops)
+        ? makePath(db, sourceId, hops) : path("");
+  }, true });
+
+  vector<engine> cheapestEngines;
+  cheapestEngines.push_back({ "oracle", "file mapped", [&](const string& source, const string& target, path& p) {
+    p = oraclePath(db, source, target, cheapest);
+  }, true });
+  cheapestEngines.push_back({ "weighted", "file mapped", [&](const string& source, const string& target, path& p) {
+    const int sourceId = db.getActorId(source);
+    p = weighted.cheapestPath(sourceId, db.getActorId(target), recent, hops, total) ? makePath(db, sourceId, hops)
+                                                                                     : path("");
+  }, true });
+  cheapestEngines.push_back({ "weighted", "in-memory", [&](const string& source, const string& target, path& p) {
+    const int sourceId = loaded.getActorId(source);
+    p = loadedWeighted.cheapestPath(sourceId, loaded.getActorId(target), recent, hops, total)
+        ? makePath(loaded, sourceId, hops) : path("");
+  }, true });
+  if (compactWeighted != NULL) {
+    cheapestEngines.push_back({ "weighted", "graph.vbyte", [&](const string& source, const string& target, path& p) {
+      const int sourceId = db.getActorId(source);
+      p = compactWeighted->cheapestPath(sourceId, db.getActorId(target), recent, hops, total)
+          ? makePath(db, sourceId, hops) : path("");
+    }, true });
+  }
+
+  // the cache holds every query the other way round, as found by graphSearch
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const int sourceId = db.getActorId(pairs[i].first), targetId = db.getActorId(pairs[i].second);
+    cache.insert(targetId, sourceId, idSearch.shortestPath(targetId, sourceId, kMaxDepth, hops), hops);
+  }
+
+  // the players on the oracle's paths, whose credits and casts are compared across the backends
+  set<string> players;
+  int failures = 0;
+  cout << endl << "shortest paths of up to " << kMaxDepth << " links:" << endl;
+  failures += runEngines(engines, db, pairs, shortest, players);
+  cout << endl << "the same through movies from " << firstYear << " to " << newest << " only, and none of the "
+       << avoidedFilms.size() << " movies or " << avoidedPlayers.size() << " actors on the first pair's path:" << endl;
+  failures += runEngines(constrainedEngines, db, pairs, constrained, players);
+  cout << endl << "cheapest paths, a movie costing one more than its age:" << endl;
+  failures += runEngines(cheapestEngines, db, pairs, cheapest, players);
+
+  cout << endl << "the credits of " << players.size() << " actors on those paths, and the casts of those credits:" << endl;
+  cout << "backend                  lists  mismatches" << endl;
+  const vector<storageReport> storage = checkStorage(db, loaded, graph, shards, players);
+  for (size_t i = 0; i < storage.size(); i++) {
+    failures += storage[i].mismatches;
+    cout << left << setw(21) << storage[i].backend << right << setw(9) << storage[i].lists
+         << setw(12) << storage[i].mismatches << endl;
+  }
+
+  cout << endl << (failures == 0 ? "everything agreed" : "DISAGREEMENTS FOUND") << endl;
+  for (size_t i = 0; i < shards.size(); i++) delete shards[i];
+  delete compactSearch;
+  delete compactWeighted;
+  delete sharded;
+  return failures == 0 ? 0 : 1;
+}
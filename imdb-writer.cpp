@@ -0,0 +1,180 @@
+using namespace std;
+#include <string.h>
+#include "imdb-writer.h"
+#include "imdb.h"
+
+namespace {
+
+// large enough that record-sized fwrites rarely reach the kernel
+const size_t kBufferBytes = 1 << 20;
+
+int offsetWidth(const bool wideOffsets)
+{
+    return wideOffsets ? sizeof(int64_t) : sizeof(int32_t);
+}
+
+int64_t paddingFor(const int64_t bytes, const int width)
+{
+    return (width - bytes % width) % width;
+}
+
+/**
+ * Function: recordHeaderBytes
+ * ---------------------------
+ * Size of the text (plus year byte, for movies) padded to even, plus the short.
+ */
+int64_t recordHeaderBytes(const size_t textLength, const bool hasYear)
+{
+    const int64_t textBytes = textLength + 1 + (hasYear ? 1 : 0);
+    return textBytes + paddingFor(textBytes, 2) + sizeof(int16_t);
+}
+
+}
+
+imdbWriter::imdbWriter(const string& fileName, const vector<int64_t>& recordOffsets, const bool wideOffsets) :
+    file(NULL), buffer(kBufferBytes), recordOffsets(recordOffsets), wideOffsets(wideOffsets),
+    failed(false), bytesWritten(0), nextRecord(1)
+{
+    file = fopen(fileName.c_str(), "wb");
+    if (file == NULL) {
+        failed = true;
+        return;
+    }
+    setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+
+    const int64_t numRecords = recordOffsets.empty() ? 0 : recordOffsets.size() - 1;
+    if (wideOffsets) {
+        const int32_t marker[2] = { imdb::kWideOffsetsMarker, 0 };
+        writeBytes(marker, sizeof(marker));
+    }
+    writeOffset(numRecords);
+    for (int64_t i = 1; i <= numRecords; ++i) writeOffset(recordOffsets[i]);
+}
+
+bool imdbWriter::good() const
+{
+    return !failed;
+}
+
+void imdbWriter::writeActorRecord(const string& name, const vector<int64_t>& offsets)
+{
+    writeRecord(name, false, 0, offsets);
+}
+
+void imdbWriter::writeMovieRecord(const film& movie, const vector<int64_t>& offsets)
+{
+    // the year is stored as a signed byte relative to 1900
+    if (movie.year - 1900 < -128 || movie.year - 1900 > 127) failed = true;
+    writeRecord(movie.title, true, movie.year, offsets);
+}
+
+void imdbWriter::writeRecord(const string& text, const bool hasYear, const int year, const vector<int64_t>& offsets)
+{
+    if (failed) return;
+    if (nextRecord >= recordOffsets.size() || bytesWritten != recordOffsets[nextRecord]) {
+        failed = true;
+        return;
+    }
+    nextRecord++;
+
+    static const char zeros[8] = { 0 };
+    writeBytes(text.c_str(), text.size() + 1);
+    int64_t written = text.size() + 1;
+    if (hasYear) {
+        const int8_t yearDelta = year - 1900;
+        writeBytes(&yearDelta, 1);
+        written++;
+    }
+    writeBytes(zeros, paddingFor(written, 2));
+
+    // nothing reads the count back (record sizes come from the offset table),
+    // so it simply saturates for the rare record with more than 32767 offsets
+    const int16_t count = offsets.size() > 32767 ? 32767 : offsets.size();
+    writeBytes(&count, sizeof(count));
+    writeBytes(zeros, paddingFor(recordHeaderBytes(text.size(), hasYear), offsetWidth(wideOffsets)));
+
+    for (size_t i = 0; i < offsets.size(); ++i) writeOffset(offsets[i]);
+}
+
+bool imdbWriter::close()
+{
+    if (file == NULL) return false;
+    if (nextRecord != recordOffsets.size()) failed = true; // some records never written
+    if (fclose(file) != 0) failed = true;
+    file = NULL;
+    return !failed;
+}
+
+imdbWriter::~imdbWriter()
+{
+    if (file != NULL) fclose(file);
+}
+
+void imdbWriter::writeBytes(const void *bytes, const size_t length)
+{
+    if (length == 0) return;
+    if (fwrite(bytes, 1, length, file) != length) failed = true;
+    bytesWritten += length;
+}
+
+void imdbWriter::writeOffset(const int64_t offset)
+{
+    if (wideOffsets) {
+        writeBytes(&offset, sizeof(int64_t));
+    } else {
+        const int32_t narrow = offset;
+        writeBytes(&narrow, sizeof(int32_t));
+    }
+}
+
+/*
+ * *********************************************************************************************
+ * Layout
+ * *********************************************************************************************
+ */
+
+int64_t imdbWriter::actorRecordBytes(const size_t nameLength, const int64_t numOffsets, const bool wideOffsets)
+{
+    const int64_t headerBytes = recordHeaderBytes(nameLength, false);
+    const int width = offsetWidth(wideOffsets);
+    return headerBytes + paddingFor(headerBytes, width) + numOffsets * width;
+}
+
+int64_t imdbWriter::movieRecordBytes(const size_t titleLength, const int64_t numOffsets, const bool wideOffsets)
+{
+    const int64_t headerBytes = recordHeaderBytes(titleLength, true);
+    const int width = offsetWidth(wideOffsets);
+    return headerBytes + paddingFor(headerBytes, width) + numOffsets * width;
+}
+
+int64_t imdbWriter::layoutRecords(const vector<int64_t>& recordBytes, vector<int64_t>& recordOffsets,
+                                  const bool wideOffsets)
+{
+    const int64_t numRecords = recordBytes.empty() ? 0 : recordBytes.size() - 1;
+    const int width = offsetWidth(wideOffsets);
+    int64_t offset = (wideOffsets ? 2 * sizeof(int32_t) : 0) + (numRecords + 1) * width;
+
+    recordOffsets.assign(numRecords + 1, 0);
+    for (int64_t i = 1; i <= numRecords; ++i) {
+        recordOffsets[i] = offset;
+        offset += recordBytes[i];
+    }
+    return offset;
+}
+
+bool imdbWriter::fitsNarrowOffsets(const int64_t fileBytes)
+{
+    return fileBytes <= INT32_MAX;
+}
+
+string imdbWriter::romanNumeral(int n)
+{
+    static const int values[] = { 1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1 };
+    static const char *const numerals[] = { "M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I" };
+    string roman;
+    for (int i = 0; n > 0; ) {
+        if (n >= values[i]) { roman += numerals[i]; n -= values[i]; }
+        else i++;
+    }
+    return roman;
+}
@@ -0,0 +1,134 @@
+#ifndef __imdb_writer__
+#define __imdb_writer__
+
+#include "imdb-utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: imdbWriter
+ * -----------------
+ * Writes one of the two files an imdb maps (actors.data or movies.data),
+ * record by record, following exactly the layout imdb reads back:
+ *
+ *     count, then the table of record offsets (4 bytes each, or a
+ *     kWideOffsetsMarker header and 8 bytes each for files over 2 GiB)
+ *
+ *     actor record: name\0 [\0 to even], short credit count, [\0\0 to align],
+ *                   the offsets of the actor's movies in movies.data
+ *     movie record: title\0, year - 1900 in one byte, [\0 to even],
+ *                   short cast size, [\0\0 to align],
+ *                   the offsets of the cast's records in actors.data
+ *
+ * Because each file stores offsets into the other, a writer needs every
+ * record offset before it writes the first record: size the records with
+ * actorRecordBytes/movieRecordBytes, lay them out with layoutRecords, then
+ * write the records in order.  Each record is checked against its planned
+ * offset as it is written.
+ */
+
+class imdbWriter {
+
+ public:
+
+  /**
+   * Constructor: imdbWriter
+   * -----------------------
+   * Creates (or truncates) the file and writes its header.
+   *
+   * @param fileName the file to write, typically <directory>/actors.data or movies.data
+   * @param recordOffsets the offset of each record, from layoutRecords; index 0 is unused.
+   *                      The writer keeps a reference, so it must outlive the writer.
+   * @param wideOffsets true to use 8-byte counts and offsets (see imdb::kWideOffsetsMarker)
+   */
+  imdbWriter(const string& fileName, const vector<int64_t>& recordOffsets, const bool wideOffsets);
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if every write so far succeeded and landed where it was planned.
+   */
+  bool good() const;
+
+  /**
+   * Methods: writeActorRecord
+   *          writeMovieRecord
+   * -------------------------
+   * Appends the next record.  Records must be written in the order of the
+   * offset table, i.e. sorted by name (actors) or by film::operator< (movies).
+   *
+   * @param offsets the offsets of the records the record refers to in the other file
+   */
+  void writeActorRecord(const string& name, const vector<int64_t>& offsets);
+  void writeMovieRecord(const film& movie, const vector<int64_t>& offsets);
+
+  /**
+   * Method: close
+   * -------------
+   * Flushes and closes the file.
+   *
+   * @return true if and only if the whole file was written as planned
+   */
+  bool close();
+
+  ~imdbWriter();
+
+  /**
+   * Static Methods: actorRecordBytes
+   *                 movieRecordBytes
+   * --------------------------------
+   * @return the size of a record with a name/title of the given length
+   *         and the given number of offsets
+   */
+  static int64_t actorRecordBytes(const size_t nameLength, const int64_t numOffsets, const bool wideOffsets);
+  static int64_t movieRecordBytes(const size_t titleLength, const int64_t numOffsets, const bool wideOffsets);
+
+  /**
+   * Static Method: layoutRecords
+   * ----------------------------
+   * Turns record sizes into record offsets, placing the first record just
+   * past the header and offset table.
+   *
+   * @param recordBytes the size of each record; index 0 is unused
+   * @param recordOffsets resized and filled with the offset of each record
+   * @return the size of the whole file
+   */
+  static int64_t layoutRecords(const vector<int64_t>& recordBytes, vector<int64_t>& recordOffsets,
+                               const bool wideOffsets);
+
+  /**
+   * Static Method: fitsNarrowOffsets
+   * --------------------------------
+   * @return true if a file of the given size can use the original 4-byte offsets
+   */
+  static bool fitsNarrowOffsets(const int64_t fileBytes);
+
+  /**
+   * Static Method: romanNumeral
+   * ---------------------------
+   * @return n in Roman numerals, as in the "(II)" that tells apart
+   *         players with the same name
+   */
+  static string romanNumeral(int n);
+
+ private:
+  FILE *file;
+  vector<char> buffer;
+  const vector<int64_t>& recordOffsets;
+  bool wideOffsets;
+  bool failed;
+  int64_t bytesWritten;
+  size_t nextRecord;
+
+  void writeBytes(const void *bytes, const size_t length);
+  void writeOffset(const int64_t offset);
+  void writeRecord(const string& text, const bool hasYear, const int year, const vector<int64_t>& offsets);
+
+  imdbWriter(const imdbWriter& original);
+  imdbWriter& operator=(const imdbWriter& rhs);
+};
+
+#endif
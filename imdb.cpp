@@ -2,40 +2,227 @@ using namespace std;
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/file.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include "imdb.h"
+#include "imdb-delta.h"
+#include "sorted-intersect.h"
 #include <list>
 #include <algorithm>
+#include <string.h>
 #include <time.h>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <fstream>
+#include <stdio.h>
+#include <stdint.h>
+
+namespace {
+
+// filmographies shorter than this are counted on the calling thread
+const size_t kCostarCreditsPerThread = 256;
+const unsigned kMaxCostarThreads = 8;
+
+// how much of a record prefetchCredits/prefetchCast bring in: the name and
+// the first few dozen offsets, which is all of most records
+const int kPrefetchBytes = 256;
+const int kCacheLineBytes = 64;
+
+void prefetchBytes(const char *start, const int bytes)
+{
+    for (int i = 0; i < bytes; i += kCacheLineBytes) __builtin_prefetch(start + i);
+}
+
+bool sharesMoreFilms(const imdb::costar& lhs, const imdb::costar& rhs)
+{
+    return lhs.sharedFilms > rhs.sharedFilms || (lhs.sharedFilms == rhs.sharedFilms && lhs.actorId < rhs.actorId);
+}
+
+// adds the counts of one id-ordered costar list into another
+void mergeCostars(vector<imdb::costar>& into, const vector<imdb::costar>& from)
+{
+    vector<imdb::costar> merged;
+    merged.reserve(into.size() + from.size());
+    size_t i = 0, j = 0;
+    while (i < into.size() || j < from.size()) {
+        if (j == from.size() || (i < into.size() && into[i].actorId < from[j].actorId)) merged.push_back(into[i++]);
+        else if (i == into.size() || from[j].actorId < into[i].actorId) merged.push_back(from[j++]);
+        else {
+            merged.push_back(into[i++]);
+            merged.back().sharedFilms += from[j++].sharedFilms;
+        }
+    }
+    into.swap(merged);
+}
+
+const size_t kHugePageBytes = 2 << 20;
+
+// loaded files are read in slices of at least this, by at most kMaxLoadThreads threads
+const size_t kLoadSliceBytes = 8 << 20;
+const unsigned kMaxLoadThreads = 8;
+
+/**
+ * Anonymous, writable memory for bytes (a multiple of kHugePageBytes): on
+ * explicit huge pages if enough are reserved, and otherwise aligned to them
+ * and marked for transparent ones, which the kernel supplies as the memory
+ * is first touched (if it has them to give).  NULL if there's no memory.
+ */
+void *allocateHugePages(const size_t bytes)
+{
+    void *memory = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) return memory;
+
+    char *raw = static_cast<char*>(mmap(0, bytes + kHugePageBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED) return NULL;
+    char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + kHugePageBytes - 1) & ~(kHugePageBytes - 1));
+    if (aligned != raw) munmap(raw, aligned - raw);
+    munmap(aligned + bytes, raw + kHugePageBytes - aligned);
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+    return aligned;
+}
+
+// reads bytes of fd from offset into memory, retrying short reads
+bool readFully(const int fd, char *memory, const size_t offset, const size_t bytes)
+{
+    for (size_t done = 0; done < bytes;) {
+        const ssize_t got = pread(fd, memory + done, bytes - done, offset + done);
+        if (got <= 0) return false;
+        done += got;
+    }
+    return true;
+}
+
+// reads the first bytes of fd into memory, with one thread per slice
+bool readInParallel(const int fd, char *memory, const size_t bytes)
+{
+    const unsigned threads = max(1u, min(min(thread::hardware_concurrency(), kMaxLoadThreads),
+                                         (unsigned) (bytes / kLoadSliceBytes)));
+    // slices end on huge page boundaries, so no two threads fault in the same page
+    const size_t slice = (bytes / threads + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+    atomic<bool> failed(false);
+    vector<thread> readers;
+    for (unsigned t = 1; t < threads && t * slice < bytes; t++) {
+        readers.push_back(thread([=, &failed]() {
+            if (!readFully(fd, memory + t * slice, t * slice, min(slice, bytes - t * slice))) failed = true;
+        }));
+    }
+    if (!readFully(fd, memory, 0, min(slice, bytes))) failed = true;
+    for (size_t i = 0; i < readers.size(); i++) readers[i].join();
+    return !failed;
+}
+
+/**
+ * How much of the memory in [begin, end) sits on 2 MiB pages, going by
+ * /proc/self/smaps: all of an explicit huge page mapping, and a mapping's
+ * AnonHugePages (at most its overlap with the range) otherwise.
+ */
+size_t hugePageBytesIn(const uintptr_t begin, const uintptr_t end)
+{
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    size_t total = 0, overlap = 0;
+    while (getline(smaps, line)) {
+        unsigned long first, last, kiloBytes;
+        char unit[8];
+        if (sscanf(line.c_str(), "%lx-%lx ", &first, &last) == 2 && line.find(':') > line.find(' ')) {
+            overlap = first < end && begin < last ? min<uintptr_t>(last, end) - max<uintptr_t>(first, begin) : 0;
+        } else if (overlap > 0 && sscanf(line.c_str(), "KernelPageSize: %lu %7s", &kiloBytes, unit) == 2) {
+            if (kiloBytes * 1024 == kHugePageBytes) total += overlap, overlap = 0;
+        } else if (overlap > 0 && sscanf(line.c_str(), "AnonHugePages: %lu %7s", &kiloBytes, unit) == 2) {
+            total += min<size_t>(kiloBytes * 1024, overlap);
+        }
+    }
+    return total;
+}
+
+// fileName's size and modification time (in nanoseconds), or zeros if there's no such file
+void statFile(const string& fileName, int64_t& bytes, int64_t& modified)
+{
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) != 0) {
+        bytes = modified = 0;
+        return;
+    }
+    bytes = stats.st_size;
+    modified = (int64_t) stats.st_mtim.tv_sec * 1000000000 + stats.st_mtim.tv_nsec;
+}
+
+}
 
 const char *const imdb::kActorFileName = "actors.data";
 const char *const imdb::kMovieFileName = "movies.data";
 
-imdb::imdb(const string& directory)
+imdb::imdb(const string& directory, const backing how)
 {
     const string actorFileName = directory + "/" + kActorFileName;
     const string movieFileName = directory + "/" + kMovieFileName;
 
-    actorFile = acquireFileMap(actorFileName, actorInfo);
-    movieFile = acquireFileMap(movieFileName, movieInfo);
+    // imdb-compact replaces both files and trims the delta under an exclusive lock on the
+    // directory, so opening them under a shared one never pairs an old file with a new one
+    const int directoryFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directoryFd != -1) flock(directoryFd, LOCK_SH);
+
+    opened = readFingerprint(directory);
+    if (how == kInMemory) {
+        actorFile = loadFile(actorFileName, actorInfo);
+        movieFile = loadFile(movieFileName, movieInfo);
+    } else {
+        actorFile = acquireFileMap(actorFileName, actorInfo);
+        movieFile = acquireFileMap(movieFileName, movieInfo);
+    }
+
+    hasDelta = false;
+    if (good()) loadDelta(directory);
+    if (directoryFd != -1) close(directoryFd);
 }
 
 bool imdb::good() const
 {
-    return !( (actorInfo.fd == -1) || 
-            (movieInfo.fd == -1) ); 
+    return !( (actorInfo.fd == -1) ||
+            (movieInfo.fd == -1) ) &&
+            actorInfo.wideOffsets == movieInfo.wideOffsets; // the files reference each other
+}
+
+// you should be implementing these two methods right here...
+bool imdb::getCredits(const string& player, vector<film>& films) const
+{
+    if (hasDelta) {
+        // the delta may add or remove credits (or the actor), so go through the merged ids
+        const int actorId = getActorId(player);
+        if (actorId == 0) return false;
+        vector<int> movieIds;
+        getCreditIds(actorId, movieIds);
+        for (size_t i = 0; i < movieIds.size(); ++i) films.push_back(getFilm(movieIds[i]));
+        return !movieIds.empty();
+    }
+    return isWide() ? getCreditsAs<WideOffsetInt>(player, films) : getCreditsAs<OffsetInt>(player, films);
+}
+
+bool imdb::getCast(const film& movie, vector<string>& players) const
+{
+    if (hasDelta) {
+        const int movieId = getMovieId(movie);
+        if (movieId == 0) return false;
+        vector<int> actorIds;
+        getCastIds(movieId, actorIds);
+        for (size_t i = 0; i < actorIds.size(); ++i) players.push_back(getActorName(actorIds[i]));
+        return !actorIds.empty();
+    }
+    return isWide() ? getCastAs<WideOffsetInt>(movie, players) : getCastAs<OffsetInt>(movie, players);
 }
 
-// you should be implementing these two methods right here... 
-bool imdb::getCredits(const string& player, vector<film>& films) const 
-{ 
-    vector<OffsetInt> movieOffsets = this->af_getMovieOffsets<OffsetInt>(player);
+template <typename T>
+bool imdb::getCreditsAs(const string& player, vector<film>& films) const
+{
+    vector<T> movieOffsets = this->af_getMovieOffsets<T>(player);
 
     if (!movieOffsets.empty())
     {
         // fill films vector with the movies
-    	for (vector<OffsetInt>::iterator i = movieOffsets.begin(); i != movieOffsets.end(); ++i)
+    	for (typename vector<T>::iterator i = movieOffsets.begin(); i != movieOffsets.end(); ++i)
     	{
     		films.push_back(mf_getFilmByOffset(*i));
     	}
@@ -44,14 +231,16 @@ bool imdb::getCredits(const string& player, vector<film>& films) const
         return false;
     }
 }
-bool imdb::getCast(const film& movie, vector<string>& players) const 
-{ 
-	vector<OffsetInt> actorOffsets = this->mf_getActorOffsets<OffsetInt>(movie);
+
+template <typename T>
+bool imdb::getCastAs(const film& movie, vector<string>& players) const
+{
+	vector<T> actorOffsets = this->mf_getActorOffsets<T>(movie);
 
 	if (!actorOffsets.empty())
 	{
 		// fill players vector with actors
-		for (vector<OffsetInt>::iterator i = actorOffsets.begin(); i != actorOffsets.end(); ++i)
+		for (typename vector<T>::iterator i = actorOffsets.begin(); i != actorOffsets.end(); ++i)
 		{
 			players.push_back(af_getActorNameByOffset(*i));
 		}
@@ -62,13 +251,384 @@ bool imdb::getCast(const film& movie, vector<string>& players) const
 }
 
 string imdb::getRandPlayer() {
-    srand(time(NULL));
-    int total = af_getTotalActors();
-    int ith = rand() % total + 1;
-    int offset = af_getithActorOffset(ith);
-    for (clock_t t = time(NULL) + 1; time(NULL) < t;){}
-    
-    return af_getActorNameByOffset(offset);
+    // each thread draws from its own generator, seeded once, rather than reseeding rand's shared one
+    thread_local mt19937 generator(random_device{}());
+    uniform_int_distribution<int> ith(1, getActorCount());
+    return getActorName(ith(generator));
+}
+
+int imdb::getActorCount() const
+{
+    return hasDelta ? delta.baseActors + delta.players.size() : getFileActorCount();
+}
+
+int imdb::getMovieCount() const
+{
+    return hasDelta ? delta.baseMovies + delta.films.size() : getFileMovieCount();
+}
+
+int imdb::getFileActorCount() const
+{
+    return isWide() ? af_getTotalActors<WideOffsetInt>() : af_getTotalActors<OffsetInt>();
+}
+
+int imdb::getFileMovieCount() const
+{
+    return isWide() ? mf_getTotalMovies<WideOffsetInt>() : mf_getTotalMovies<OffsetInt>();
+}
+
+const imdb::fingerprint& imdb::getFingerprint() const
+{
+    return opened;
+}
+
+imdb::fingerprint imdb::readFingerprint(const string& directory)
+{
+    fingerprint current;
+    statFile(directory + "/" + kActorFileName, current.actorBytes, current.actorModified);
+    statFile(directory + "/" + kMovieFileName, current.movieBytes, current.movieModified);
+    statFile(directory + "/" + imdbDelta::kDeltaFileName, current.deltaBytes, current.deltaModified);
+    return current;
+}
+
+int imdb::getActorId(const string& player) const
+{
+    const int actorId = isWide() ? af_findActor<WideOffsetInt>(player) : af_findActor<OffsetInt>(player);
+    if (actorId != 0 || !hasDelta) return actorId;
+    map<string, int>::const_iterator found = delta.playerIds.find(player);
+    return found == delta.playerIds.end() ? 0 : found->second;
+}
+
+string imdb::getActorName(const int actorId) const
+{
+    if (hasDelta && actorId > delta.baseActors) return delta.players[actorId - delta.baseActors - 1];
+    return af_getActorNameByOffset(isWide() ? af_getithActorOffset<WideOffsetInt>(actorId)
+                                            : af_getithActorOffset<OffsetInt>(actorId));
+}
+
+int imdb::getMovieId(const film& movie) const
+{
+    const int movieId = isWide() ? mf_findMovie<WideOffsetInt>(movie) : mf_findMovie<OffsetInt>(movie);
+    if (movieId != 0 || !hasDelta) return movieId;
+    map<film, int>::const_iterator found = delta.filmIds.find(movie);
+    return found == delta.filmIds.end() ? 0 : found->second;
+}
+
+film imdb::getFilm(const int movieId) const
+{
+    if (hasDelta && movieId > delta.baseMovies) return delta.films[movieId - delta.baseMovies - 1];
+    return mf_getFilmByOffset(isWide() ? mf_getithMovieOffset<WideOffsetInt>(movieId)
+                                       : mf_getithMovieOffset<OffsetInt>(movieId));
+}
+
+int imdb::getMovieYear(const int movieId) const
+{
+    if (hasDelta && movieId > delta.baseMovies) return delta.films[movieId - delta.baseMovies - 1].year;
+    return mf_getMovieYearByOffset(isWide() ? mf_getithMovieOffset<WideOffsetInt>(movieId)
+                                            : mf_getithMovieOffset<OffsetInt>(movieId));
+}
+
+string_view imdb::getActorNameView(const int actorId) const
+{
+    if (hasDelta && actorId > delta.baseActors) return delta.players[actorId - delta.baseActors - 1];
+    const ByteOffset offset = isWide() ? af_getithActorOffset<WideOffsetInt>(actorId)
+                                       : af_getithActorOffset<OffsetInt>(actorId);
+    return reinterpret_cast<const char*>(applyByteOffset<int32_t>(af_getActorFilePtrAsType<int32_t>(), offset));
+}
+
+string_view imdb::getMovieTitleView(const int movieId) const
+{
+    if (hasDelta && movieId > delta.baseMovies) return delta.films[movieId - delta.baseMovies - 1].title;
+    const ByteOffset offset = isWide() ? mf_getithMovieOffset<WideOffsetInt>(movieId)
+                                       : mf_getithMovieOffset<OffsetInt>(movieId);
+    return reinterpret_cast<const char*>(applyByteOffset<int32_t>(mf_getMovieFilePtrAsType<int32_t>(), offset));
+}
+
+void imdb::getCreditIds(const int actorId, vector<int>& movieIds) const
+{
+    if (hasDelta && actorId > delta.baseActors) movieIds.clear();
+    else if (isWide()) getCreditIdsAs<WideOffsetInt>(actorId, movieIds);
+    else getCreditIdsAs<OffsetInt>(actorId, movieIds);
+    if (hasDelta) overlayIds(actorId, delta.addedCredits, delta.removedCredits, movieIds);
+}
+
+void imdb::getCastIds(const int movieId, vector<int>& actorIds) const
+{
+    if (hasDelta && movieId > delta.baseMovies) actorIds.clear();
+    else if (isWide()) getCastIdsAs<WideOffsetInt>(movieId, actorIds);
+    else getCastIdsAs<OffsetInt>(movieId, actorIds);
+    if (hasDelta) overlayIds(movieId, delta.addedCast, delta.removedCast, actorIds);
+}
+
+void imdb::prefetchCreditIndex(const int actorId) const
+{
+    if (hasDelta && actorId > delta.baseActors) return;
+    if (isWide()) af_prefetchRecord<WideOffsetInt>(actorId, true);
+    else af_prefetchRecord<OffsetInt>(actorId, true);
+}
+
+void imdb::prefetchCredits(const int actorId) const
+{
+    if (hasDelta && actorId > delta.baseActors) return;
+    if (isWide()) af_prefetchRecord<WideOffsetInt>(actorId, false);
+    else af_prefetchRecord<OffsetInt>(actorId, false);
+}
+
+void imdb::prefetchCastIndex(const int movieId) const
+{
+    if (hasDelta && movieId > delta.baseMovies) return;
+    if (isWide()) mf_prefetchRecord<WideOffsetInt>(movieId, true);
+    else mf_prefetchRecord<OffsetInt>(movieId, true);
+}
+
+void imdb::prefetchCast(const int movieId) const
+{
+    if (hasDelta && movieId > delta.baseMovies) return;
+    if (isWide()) mf_prefetchRecord<WideOffsetInt>(movieId, false);
+    else mf_prefetchRecord<OffsetInt>(movieId, false);
+}
+
+void imdb::getCommonMovieIds(const int actorA, const int actorB, vector<int>& movieIds) const
+{
+    if (!hasDelta) {
+        if (isWide()) getCommonMovieIdsAs<WideOffsetInt>(actorA, actorB, movieIds);
+        else getCommonMovieIdsAs<OffsetInt>(actorA, actorB, movieIds);
+        return;
+    }
+
+    // the delta's ids don't follow the file order, so intersect (sorted) ids instead
+    vector<int> creditsA, creditsB;
+    getCreditIds(actorA, creditsA);
+    getCreditIds(actorB, creditsB);
+    sort(creditsA.begin(), creditsA.end());
+    sort(creditsB.begin(), creditsB.end());
+    movieIds.resize(min(creditsA.size(), creditsB.size()));
+    if (movieIds.empty()) return;
+    movieIds.resize(intersectSorted(&creditsA[0], creditsA.size(), &creditsB[0], creditsB.size(), &movieIds[0]));
+}
+
+template <typename T>
+void imdb::getCommonMovieIdsAs(const int actorA, const int actorB, vector<int>& movieIds) const
+{
+    const T *beginA, *endA, *beginB, *endB;
+    af_getMovieOffsetRange<T>(actorA, beginA, endA);
+    af_getMovieOffsetRange<T>(actorB, beginB, endB);
+    movieIds.clear();
+    if (beginA == endA || beginB == endB) return;
+
+    // records are laid out in id order, so offsets sort like ids; files needn't list them sorted, though
+    vector<T> sortedA, sortedB;
+    if (!is_sorted(beginA, endA)) {
+        sortedA.assign(beginA, endA);
+        sort(sortedA.begin(), sortedA.end());
+        beginA = &sortedA[0];
+        endA = beginA + sortedA.size();
+    }
+    if (!is_sorted(beginB, endB)) {
+        sortedB.assign(beginB, endB);
+        sort(sortedB.begin(), sortedB.end());
+        beginB = &sortedB[0];
+        endB = beginB + sortedB.size();
+    }
+
+    vector<T> shared(min(endA - beginA, endB - beginB));
+    shared.resize(intersectSorted(beginA, endA - beginA, beginB, endB - beginB, &shared[0]));
+    for (size_t i = 0; i < shared.size(); i++) movieIds.push_back(mf_getMovieIdByOffset<T>(shared[i]));
+}
+
+bool imdb::getCommonFilms(const string& playerA, const string& playerB, vector<film>& films) const
+{
+    films.clear();
+    const int actorA = getActorId(playerA), actorB = getActorId(playerB);
+    if (actorA == 0 || actorB == 0) return false;
+    vector<int> movieIds;
+    getCommonMovieIds(actorA, actorB, movieIds);
+    for (size_t i = 0; i < movieIds.size(); i++) films.push_back(getFilm(movieIds[i]));
+    return true;
+}
+
+void imdb::getCostars(const int actorId, vector<costar>& costars, const int limit) const
+{
+    vector<int> credits;
+    getCreditIds(actorId, credits);
+
+    const size_t threads = min<size_t>(min(kMaxCostarThreads, max(1u, thread::hardware_concurrency())),
+                                       credits.size() / kCostarCreditsPerThread + 1);
+    if (threads == 1) {
+        countCostars(actorId, credits, 0, credits.size(), costars);
+    } else {
+        vector<vector<costar> > counted(threads);
+        vector<thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.push_back(thread(&imdb::countCostars, this, actorId, cref(credits),
+                                     credits.size() * t / threads, credits.size() * (t + 1) / threads, ref(counted[t])));
+        }
+        for (size_t t = 0; t < threads; t++) workers[t].join();
+        costars.swap(counted[0]);
+        for (size_t t = 1; t < threads; t++) mergeCostars(costars, counted[t]);
+    }
+
+    if (limit > 0 && (size_t) limit < costars.size()) {
+        partial_sort(costars.begin(), costars.begin() + limit, costars.end(), sharesMoreFilms);
+        costars.resize(limit);
+    } else if (limit > 0) {
+        sort(costars.begin(), costars.end(), sharesMoreFilms);
+    }
+}
+
+void imdb::countCostars(const int actorId, const vector<int>& credits, const size_t begin, const size_t end,
+                        vector<costar>& costars) const
+{
+    vector<int> cast, pooled;
+    for (size_t f = begin; f < end; f++) {
+        getCastIds(credits[f], cast);
+        pooled.insert(pooled.end(), cast.begin(), cast.end());
+    }
+    sort(pooled.begin(), pooled.end());
+
+    costars.clear();
+    for (size_t i = 0; i < pooled.size();) {
+        size_t run = i + 1;
+        while (run < pooled.size() && pooled[run] == pooled[i]) run++;
+        if (pooled[i] != actorId) {
+            const costar found = { pooled[i], int(run - i) };
+            costars.push_back(found);
+        }
+        i = run;
+    }
+}
+
+template <typename T>
+void imdb::getCreditIdsAs(const int actorId, vector<int>& movieIds) const
+{
+    const T *begin, *end;
+    af_getMovieOffsetRange<T>(actorId, begin, end);
+    movieIds.clear();
+    for (const T *i = begin; i != end; ++i) movieIds.push_back(mf_getMovieIdByOffset<T>(*i));
+}
+
+template <typename T>
+void imdb::getCastIdsAs(const int movieId, vector<int>& actorIds) const
+{
+    const T *begin, *end;
+    mf_getActorOffsetRange<T>(movieId, begin, end);
+    actorIds.clear();
+    for (const T *i = begin; i != end; ++i) actorIds.push_back(af_getActorIdByOffset<T>(*i));
+}
+
+bool imdb::hasWideOffsets() const
+{
+    return isWide();
+}
+
+void imdb::prefault() const
+{
+    prefaultFileMap(actorInfo);
+    prefaultFileMap(movieInfo);
+}
+
+size_t imdb::getDataBytes() const
+{
+    return actorInfo.fileSize + movieInfo.fileSize;
+}
+
+size_t imdb::getHugePageBytes() const
+{
+    size_t bytes = 0;
+    const fileInfo *infos[] = { &actorInfo, &movieInfo };
+    for (int i = 0; i < 2; i++) {
+        if (!infos[i]->loaded || infos[i]->fileMap == MAP_FAILED) continue;
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(infos[i]->fileMap);
+        bytes += min(hugePageBytesIn(begin, begin + infos[i]->mapSize), infos[i]->fileSize);
+    }
+    return bytes;
+}
+
+int imdb::getDeltaEditCount() const
+{
+    return hasDelta ? delta.editCount : 0;
+}
+
+/*
+ * *********************************************************************************************
+ * Delta overlay
+ * *********************************************************************************************
+ */
+
+void imdb::loadDelta(const string& directory)
+{
+    vector<imdbDelta::edit> edits;
+    if (!imdbDelta::read(directory, edits)) {
+        cerr << "Warning: skipping unreadable lines of " << directory << "/" << imdbDelta::kDeltaFileName << endl;
+    }
+    if (edits.empty()) return;
+
+    // hasDelta is still false, so the lookups below only see the data files
+    delta.baseActors = getFileActorCount();
+    delta.baseMovies = getFileMovieCount();
+
+    // the last edit of each credit wins
+    map<pair<int, int>, bool> credits;
+    for (size_t i = 0; i < edits.size(); ++i) {
+        const imdbDelta::edit& e = edits[i];
+        int actorId = getActorId(e.player);
+        if (actorId == 0) {
+            map<string, int>::const_iterator found = delta.playerIds.find(e.player);
+            if (found != delta.playerIds.end()) actorId = found->second;
+            else if (e.isAddition) {
+                delta.players.push_back(e.player);
+                actorId = delta.playerIds[e.player] = delta.baseActors + delta.players.size();
+            }
+        }
+        int movieId = getMovieId(e.movie);
+        if (movieId == 0) {
+            map<film, int>::const_iterator found = delta.filmIds.find(e.movie);
+            if (found != delta.filmIds.end()) movieId = found->second;
+            else if (e.isAddition) {
+                delta.films.push_back(e.movie);
+                movieId = delta.filmIds[e.movie] = delta.baseMovies + delta.films.size();
+            }
+        }
+        if (actorId != 0 && movieId != 0) credits[make_pair(actorId, movieId)] = e.isAddition;
+    }
+
+    // keep only what differs from the files; credits are grouped by actor, so each
+    // actor's credits are read from the files once
+    delta.editCount = 0;
+    vector<int> baseCredits;
+    int baseCreditsOf = 0;
+    for (map<pair<int, int>, bool>::const_iterator i = credits.begin(); i != credits.end(); ++i) {
+        const int actorId = i->first.first, movieId = i->first.second;
+        if (actorId != baseCreditsOf) {
+            baseCredits.clear();
+            if (actorId <= delta.baseActors) getCreditIds(actorId, baseCredits);
+            baseCreditsOf = actorId;
+        }
+        const bool inFiles = find(baseCredits.begin(), baseCredits.end(), movieId) != baseCredits.end();
+        if (i->second == inFiles) continue;
+        map<int, vector<int> >& credited = i->second ? delta.addedCredits : delta.removedCredits;
+        map<int, vector<int> >& cast = i->second ? delta.addedCast : delta.removedCast;
+        credited[actorId].push_back(movieId);
+        cast[movieId].push_back(actorId);
+        delta.editCount++;
+    }
+    // walking credits in (actor, movie) order leaves every removed list sorted, as overlayIds needs
+    hasDelta = true;
+}
+
+void imdb::overlayIds(const int id, const map<int, vector<int> >& added,
+                      const map<int, vector<int> >& removed, vector<int>& ids)
+{
+    map<int, vector<int> >::const_iterator gone = removed.find(id);
+    if (gone != removed.end()) {
+        vector<int>::iterator kept = ids.begin();
+        for (vector<int>::const_iterator i = ids.begin(); i != ids.end(); ++i) {
+            if (!binary_search(gone->second.begin(), gone->second.end(), *i)) *kept++ = *i;
+        }
+        ids.erase(kept, ids.end());
+    }
+    map<int, vector<int> >::const_iterator extra = added.find(id);
+    if (extra != added.end()) ids.insert(ids.end(), extra->second.begin(), extra->second.end());
 }
 
 imdb::~imdb()
@@ -78,22 +638,68 @@ imdb::~imdb()
 }
 
 // ignore everything below... it's all UNIXy stuff in place to make a file look like
-// an array of bytes in RAM.. 
+// an array of bytes in RAM..
 const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info)
 {
     struct stat stats;
     stat(fileName.c_str(), &stats);
     info.fileSize = stats.st_size;
     info.fd = open(fileName.c_str(), O_RDONLY);
-    return info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+    info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+
+    // files with 8-byte offsets announce themselves up front; the original
+    // format starts with the (never negative) record count instead
+    info.mapSize = info.fileSize;
+    info.loaded = false;
+    info.wideOffsets = info.fd != -1 && info.fileMap != MAP_FAILED && info.fileSize >= sizeof(int32_t) &&
+                       *static_cast<const int32_t*>(info.fileMap) == kWideOffsetsMarker;
+    return info.fileMap;
+}
+
+const void *imdb::loadFile(const string& fileName, struct fileInfo& info)
+{
+    info.fileMap = MAP_FAILED;
+    info.fileSize = info.mapSize = 0;
+    info.loaded = true;
+    info.wideOffsets = false;
+    info.fd = open(fileName.c_str(), O_RDONLY);
+    struct stat stats;
+    if (info.fd == -1 || fstat(info.fd, &stats) != 0 || stats.st_size == 0) {
+        if (info.fd != -1) close(info.fd);
+        info.fd = -1;
+        return info.fileMap;
+    }
+    info.fileSize = stats.st_size;
+    info.mapSize = (info.fileSize + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+
+    char *memory = static_cast<char*>(allocateHugePages(info.mapSize));
+    if (memory == NULL || !readInParallel(info.fd, memory, info.fileSize)) {
+        if (memory != NULL) munmap(memory, info.mapSize);
+        close(info.fd);
+        info.fd = -1;
+        return info.fileMap;
+    }
+    mprotect(memory, info.mapSize, PROT_READ);
+    info.fileMap = memory;
+    info.wideOffsets = info.fileSize >= sizeof(int32_t) && *reinterpret_cast<const int32_t*>(memory) == kWideOffsetsMarker;
+    return info.fileMap;
 }
 
 void imdb::releaseFileMap(struct fileInfo& info)
 {
-    if (info.fileMap != NULL) munmap((char *) info.fileMap, info.fileSize);
+    if (info.fileMap != NULL && info.fileMap != MAP_FAILED) munmap((char *) info.fileMap, info.mapSize);
     if (info.fd != -1) close(info.fd);
 }
 
+void imdb::prefaultFileMap(const struct fileInfo& info)
+{
+    if (info.fd == -1 || info.fileMap == MAP_FAILED) return;
+    madvise((void *) info.fileMap, info.fileSize, MADV_WILLNEED);
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    const volatile char *bytes = static_cast<const char*>(info.fileMap);
+    for (size_t offset = 0; offset < info.fileSize; offset += pageSize) (void) bytes[offset];
+}
+
 /*
  * *********************************************************************************************
  * Actor File specific functions
@@ -103,39 +709,62 @@ template <typename T>
 vector<T> imdb::af_getMovieOffsets(const string& player) const
 {
     vector<T> movieOffsets;
-    const int ithActor = this->af_findActor(player);
+    const int ithActor = this->af_findActor<T>(player);
 
     if (ithActor > 0) {
-        const int recordOffset = af_getithActorOffset(ithActor);
-        const int nextRecordOffset = af_getithActorOffset(ithActor + 1);
-
-        // Determine where the movie offsets start
-        const int nameLength = af_getActorNameByOffset(recordOffset).length();
-        const int nameShortBytes = nameLength*sizeof(char) + 1 + (nameLength % 2 == 0 ? 1 : 0) + 2; // \0 + extra padding if needed + 2 byte short
-        const int byteOffset  = recordOffset + nameShortBytes + (nameShortBytes % 4 != 0 ? 2 : 0); // start record, name, short, padding
-
-        const T* actorf_int = af_getActorFilePtrAsType<T>();
-        movieOffsets = vector<T>(applyByteOffset<T>(actorf_int, byteOffset),
-        						 applyByteOffset<T>(actorf_int, nextRecordOffset));
+        const T *begin, *end;
+        af_getMovieOffsetRange<T>(ithActor, begin, end);
+        movieOffsets = vector<T>(begin, end);
     }
 
     return movieOffsets;
 }
 
+template <typename T>
+void imdb::af_getMovieOffsetRange(const int ithActor, const T*& begin, const T*& end) const
+{
+    const ByteOffset recordOffset = af_getithActorOffset<T>(ithActor);
+    const ByteOffset nextRecordOffset = af_getithActorEndOffset<T>(ithActor);
+
+    // Determine where the movie offsets start
+    const int nameLength = strlen(applyByteOffset<char>(af_getActorFilePtrAsType<char>(), recordOffset));
+    const int nameShortBytes = nameLength*sizeof(char) + 1 + (nameLength % 2 == 0 ? 1 : 0) + 2; // \0 + extra padding if needed + 2 byte short
+    const ByteOffset byteOffset = recordOffset + nameShortBytes + paddingFor<T>(nameShortBytes); // start record, name, short, padding
+
+    const T* actorf_int = af_getActorFilePtrAsType<T>();
+    begin = applyByteOffset<T>(actorf_int, byteOffset);
+    end = applyByteOffset<T>(actorf_int, nextRecordOffset);
+}
+
+template <typename T>
+void imdb::af_prefetchRecord(const int ithActor, const bool indexOnly) const
+{
+    if (ithActor < 1 || ithActor > af_getTotalActors<T>()) return;
+    const T* slot = af_getOffsetTable<T>() + ithActor;
+    if (indexOnly) {
+        __builtin_prefetch(slot);
+        __builtin_prefetch(slot + 1); // the next record's offset is where this one ends
+        return;
+    }
+    prefetchBytes(applyByteOffset<char>(af_getActorFilePtrAsType<char>(), slot[0]),
+                  min<ByteOffset>(af_getithActorEndOffset<T>(ithActor) - slot[0], kPrefetchBytes));
+}
+
+template <typename T>
 int imdb::af_findActor(const string& player) const
 {
     int ithActor = 1;
     string actorName;
 
-    // bounds for binary search
-    int upper_bound = af_getTotalActors();
+    // bounds for binary search (exclusive, so the last actor can be reached)
+    int upper_bound = af_getTotalActors<T>() + 1;
     int lower_bound = 0;
 
     bool found = false;
     int move = 1; //init w/ anything non-zero
     while (found == false and move != 0)
     {
-        int actorByteOffset = af_getithActorOffset(ithActor);
+        ByteOffset actorByteOffset = af_getithActorOffset<T>(ithActor);
         actorName = af_getActorNameByOffset(actorByteOffset);
         if(actorName == player) {
         	found = true;
@@ -152,25 +781,47 @@ int imdb::af_findActor(const string& player) const
     return (found) ? ithActor : 0;
 }
 
-int imdb::af_getTotalActors() const
+template <typename T>
+const T* imdb::af_getOffsetTable() const
 {
-    const int32_t* actorf_int = af_getActorFilePtrAsType<int32_t>();
-    return actorf_int[0];
+    // wide files spend their first 8 bytes on the marker, so the count sits in the second slot
+    return af_getActorFilePtrAsType<T>() + (sizeof(T) == sizeof(WideOffsetInt) ? 1 : 0);
+}
 
+template <typename T>
+int imdb::af_getTotalActors() const
+{
+    return af_getOffsetTable<T>()[0];
 }
 
-int imdb::af_getithActorOffset(const int ithActor) const
+template <typename T>
+imdb::ByteOffset imdb::af_getithActorOffset(const int ithActor) const
 {
-	if (1 <= ithActor && ithActor <= af_getTotalActors()) {
-		const int32_t* actorf_int = af_getActorFilePtrAsType<int32_t>();
-		return actorf_int[ithActor];
+	if (1 <= ithActor && ithActor <= af_getTotalActors<T>()) {
+		return af_getOffsetTable<T>()[ithActor];
 	} else {
 		cerr << "Warning:af_getithActorOffset: attempting to access an actor that is out of range";
 		return 0;
 	}
 }
 
-string imdb::af_getActorNameByOffset(const int actorByteOffset) const
+template <typename T>
+imdb::ByteOffset imdb::af_getithActorEndOffset(const int ithActor) const
+{
+    // the last record runs to the end of the file
+    if (ithActor == af_getTotalActors<T>()) return actorInfo.fileSize;
+    return af_getithActorOffset<T>(ithActor + 1);
+}
+
+template <typename T>
+int imdb::af_getActorIdByOffset(const ByteOffset actorByteOffset) const
+{
+    // the offset table is sorted because the records are laid out in order
+    const T* table = af_getOffsetTable<T>();
+    return lower_bound(table + 1, table + af_getTotalActors<T>() + 1, (T) actorByteOffset) - table;
+}
+
+string imdb::af_getActorNameByOffset(const ByteOffset actorByteOffset) const
 {
     const int32_t* actorf_int = af_getActorFilePtrAsType<int32_t>();
     return string(reinterpret_cast<const char*>(applyByteOffset<int32_t>(actorf_int, actorByteOffset)));
@@ -193,40 +844,63 @@ template <typename T>
 vector<T> imdb::mf_getActorOffsets(const film& movie) const
 {
     vector<T> actorOffsets;
-    const int ithMovie = this->mf_findMovie(movie);
+    const int ithMovie = this->mf_findMovie<T>(movie);
 
     if (ithMovie > 0) {
-        const int recordOffset = mf_getithMovieOffset(ithMovie);
-        const int nextRecordOffset = mf_getithMovieOffset(ithMovie + 1);
-
-        // Determine where the actor offsets start
-        const int titleLength = mf_getMovieTitleByOffset(recordOffset).length();
-        const int titleYearBytes = titleLength*sizeof(char) + 1 + 1; // \0 and 1 byte for year
-        const int titleYearShortBytes  = titleYearBytes + (titleYearBytes % 2 != 0 ? 1 : 0) + 2; // title/Year, padding, short,
-        const int byteOffset = recordOffset + titleYearShortBytes + (titleYearShortBytes % 4 != 0 ? 2 : 0); // start, title/year/short, padding
-
-        const T* movief_int = mf_getMovieFilePtrAsType<T>();
-        actorOffsets = vector<T>(applyByteOffset<T>(movief_int, byteOffset),
-        						 applyByteOffset<T>(movief_int, nextRecordOffset));
+        const T *begin, *end;
+        mf_getActorOffsetRange<T>(ithMovie, begin, end);
+        actorOffsets = vector<T>(begin, end);
     }
 
     return actorOffsets;
 }
 
+template <typename T>
+void imdb::mf_getActorOffsetRange(const int ithMovie, const T*& begin, const T*& end) const
+{
+    const ByteOffset recordOffset = mf_getithMovieOffset<T>(ithMovie);
+    const ByteOffset nextRecordOffset = mf_getithMovieEndOffset<T>(ithMovie);
+
+    // Determine where the actor offsets start
+    const int titleLength = strlen(applyByteOffset<char>(mf_getMovieFilePtrAsType<char>(), recordOffset));
+    const int titleYearBytes = titleLength*sizeof(char) + 1 + 1; // \0 and 1 byte for year
+    const int titleYearShortBytes  = titleYearBytes + (titleYearBytes % 2 != 0 ? 1 : 0) + 2; // title/Year, padding, short,
+    const ByteOffset byteOffset = recordOffset + titleYearShortBytes + paddingFor<T>(titleYearShortBytes); // start, title/year/short, padding
+
+    const T* movief_int = mf_getMovieFilePtrAsType<T>();
+    begin = applyByteOffset<T>(movief_int, byteOffset);
+    end = applyByteOffset<T>(movief_int, nextRecordOffset);
+}
+
+template <typename T>
+void imdb::mf_prefetchRecord(const int ithMovie, const bool indexOnly) const
+{
+    if (ithMovie < 1 || ithMovie > mf_getTotalMovies<T>()) return;
+    const T* slot = mf_getOffsetTable<T>() + ithMovie;
+    if (indexOnly) {
+        __builtin_prefetch(slot);
+        __builtin_prefetch(slot + 1);
+        return;
+    }
+    prefetchBytes(applyByteOffset<char>(mf_getMovieFilePtrAsType<char>(), slot[0]),
+                  min<ByteOffset>(mf_getithMovieEndOffset<T>(ithMovie) - slot[0], kPrefetchBytes));
+}
+
+template <typename T>
 int imdb::mf_findMovie(const film& movie) const
 {
     int ithMovie = 1; // start with first movie
     film currFilm;
 
-    // bounds for binary search
-    int upper_bound = mf_getTotalMovies();
+    // bounds for binary search (exclusive, so the last movie can be reached)
+    int upper_bound = mf_getTotalMovies<T>() + 1;
     int lower_bound = 0;
 
     bool found = false;
     int move = 1; //init w/ anything non-zero
     while (found == false and move != 0)
     {
-        int actorByteOffset = mf_getithMovieOffset(ithMovie);
+        ByteOffset actorByteOffset = mf_getithMovieOffset<T>(ithMovie);
         currFilm = mf_getFilmByOffset(actorByteOffset);
         if(currFilm == movie) {
         	found = true;
@@ -250,25 +924,25 @@ const T* imdb::mf_getMovieFilePtrAsType() const
     return movief_ptr;
 }
 
-string imdb::mf_getMovieTitleByOffset (const int offset) const
+string imdb::mf_getMovieTitleByOffset (const ByteOffset offset) const
 {
     const int32_t* movief_int = mf_getMovieFilePtrAsType<int32_t>();
     return string(reinterpret_cast<const char*>(applyByteOffset<int32_t>(movief_int, offset)));
 }
 
-int imdb::mf_getMovieYearByOffset (const int offset) const
+int imdb::mf_getMovieYearByOffset (const ByteOffset offset) const
 {
 	// Determine where the actor offsets start
-	const int titleLength = mf_getMovieTitleByOffset(offset).length();
+	const int titleLength = strlen(applyByteOffset<char>(mf_getMovieFilePtrAsType<char>(), offset));
     const int8_t* movief_int8 = mf_getMovieFilePtrAsType<int8_t>();
-    int titleBytes = offset + titleLength*sizeof(char) + 1; // + 1 more byte to account for \0
+    ByteOffset titleBytes = offset + titleLength*sizeof(char) + 1; // + 1 more byte to account for \0
 
     // Read the year delta
     int8_t yearDelta = *(applyByteOffset<int8_t>(movief_int8, titleBytes));
     return yearDelta + 1900;
 }
 
-film imdb::mf_getFilmByOffset(const int offset) const
+film imdb::mf_getFilmByOffset(const ByteOffset offset) const
 {
 	film f;
 	f.title = mf_getMovieTitleByOffset(offset);
@@ -276,28 +950,84 @@ film imdb::mf_getFilmByOffset(const int offset) const
 	return f;
 }
 
+template <typename T>
+const T* imdb::mf_getOffsetTable() const
+{
+    // wide files spend their first 8 bytes on the marker, so the count sits in the second slot
+    return mf_getMovieFilePtrAsType<T>() + (sizeof(T) == sizeof(WideOffsetInt) ? 1 : 0);
+}
+
+template <typename T>
 int imdb::mf_getTotalMovies() const
 {
-	const int32_t* movief_int = mf_getMovieFilePtrAsType<int32_t>();
-	return movief_int[0];
+	return mf_getOffsetTable<T>()[0];
 }
 
-int imdb::mf_getithMovieOffset(const int ithMovie) const
+template <typename T>
+imdb::ByteOffset imdb::mf_getithMovieOffset(const int ithMovie) const
 {
-	if (1 <= ithMovie && ithMovie <= mf_getTotalMovies()) {
-	    const int32_t* movief_int = mf_getMovieFilePtrAsType<int32_t>();
-	    return movief_int[ithMovie];
+	if (1 <= ithMovie && ithMovie <= mf_getTotalMovies<T>()) {
+	    return mf_getOffsetTable<T>()[ithMovie];
 	} else {
 		cerr << "Warning:mf_getithMovieOffset: attempting to access a movie that is out of range";
 		return 0;
 	}
 }
 
+template <typename T>
+int imdb::mf_getMovieIdByOffset(const ByteOffset movieByteOffset) const
+{
+    // the offset table is sorted because the records are laid out in order
+    const T* table = mf_getOffsetTable<T>();
+    return lower_bound(table + 1, table + mf_getTotalMovies<T>() + 1, (T) movieByteOffset) - table;
+}
+
+template <typename T>
+imdb::ByteOffset imdb::mf_getithMovieEndOffset(const int ithMovie) const
+{
+    // the last record runs to the end of the file
+    if (ithMovie == mf_getTotalMovies<T>()) return movieInfo.fileSize;
+    return mf_getithMovieOffset<T>(ithMovie + 1);
+}
+
 // Helper Functions
 
 template <typename T>
-const T* imdb::applyByteOffset (const T* ptr, const int bytes) const
+const T* imdb::applyByteOffset (const T* ptr, const ByteOffset bytes) const
 {
-    int next = bytes/sizeof(T);
+    ByteOffset next = bytes/sizeof(T);
     return ptr + next;
 }
+
+template <typename T>
+int imdb::paddingFor(const int bytes)
+{
+    return (sizeof(T) - bytes % sizeof(T)) % sizeof(T);
+}
+
+bool imdb::isWide() const
+{
+    return actorInfo.wideOffsets;
+}
+
+imdb::recordTable imdb::af_getRecordTable() const
+{
+    recordTable table;
+    table.wide = isWide();
+    table.offsets = table.wide ? static_cast<const void*>(af_getOffsetTable<WideOffsetInt>())
+                               : static_cast<const void*>(af_getOffsetTable<OffsetInt>());
+    table.count = getFileActorCount();
+    table.records = af_getActorFilePtrAsType<char>();
+    return table;
+}
+
+imdb::recordTable imdb::mf_getRecordTable() const
+{
+    recordTable table;
+    table.wide = isWide();
+    table.offsets = table.wide ? static_cast<const void*>(mf_getOffsetTable<WideOffsetInt>())
+                               : static_cast<const void*>(mf_getOffsetTable<OffsetInt>());
+    table.count = getFileMovieCount();
+    table.records = mf_getMovieFilePtrAsType<char>();
+    return table;
+}
@@ -3,7 +3,9 @@
 
 #include "imdb-utils.h"
 #include <string>
+#include <string_view>
 #include <vector>
+#include <map>
 #include <cstdlib>
 using namespace std;
 
@@ -20,10 +22,28 @@ class imdb {
    * all of the information about the movies and actors relevant to an IMDB
    * application (like six-degrees).
    *
+   * If the directory also holds a credits.delta file (see imdbDelta), its
+   * added and removed credits are layered over the data files, and every
+   * method below answers as if they had been written into them.  The files
+   * and the delta are opened under a shared flock on the directory, which
+   * imdb-compact holds exclusively while it swaps in new ones, so an imdb
+   * always sees one consistent generation of the three.
+   *
+   * By default the data files are mapped, so pages come in from the page
+   * cache on first use, 4 KiB at a time.  kInMemory instead reads them, with
+   * several threads, into anonymous memory backed by 2 MiB pages wherever
+   * the kernel can supply them (explicit huge pages first, then transparent
+   * ones), which saves a random-access search most of its TLB misses at the
+   * cost of a private copy of both files.  Every method works the same over
+   * either backing.
+   *
    * @param directory the name of the directory housing the formatted information backing the imdb.
+   * @param how kFileMapped or kInMemory
    */
 
-  imdb(const string& directory);
+  enum backing { kFileMapped, kInMemory };
+
+  imdb(const string& directory, const backing how = kFileMapped);
 
   /**
    * Predicate Method: good
@@ -78,10 +98,288 @@ class imdb {
   /**
    * Method: getRandPlayer
    * -----------------
-   * Return the name of a random player in the database
+   * Return the name of a random player in the database.  Each thread
+   * draws from its own generator, so calls never touch rand's global
+   * state and can run concurrently.
+   */
+
+  string getRandPlayer();
+
+  /*
+   * *********************************************************************************************
+   * Record level access
+   *
+   * Actors and movies are identified by their (1-based) position in the sorted
+   * actor/movie files, which is the same number af_findActor/mf_findMovie hand back.
+   * Actors and movies that only credits.delta knows about follow on after the
+   * last one in the files, in the order the delta introduces them.
+   * 0 is never a valid id.
+   * *********************************************************************************************
+   */
+
+  /**
+   * Method: getActorCount
+   * ---------------
+   * @return total number of actors in the database
    */
+  int getActorCount() const;
 
-  string getRandPlayer(); 
+  /**
+   * Method: getMovieCount
+   * ---------------
+   * @return total number of movies in the database
+   */
+  int getMovieCount() const;
+
+  /**
+   * Method: getActorId
+   * ---------------
+   * @param player name of the actor
+   * @return the actor's id, or 0 if the actor isn't in the database
+   */
+  int getActorId(const string& player) const;
+
+  /**
+   * Method: getActorName
+   * ---------------
+   * @param actorId an id in the range [1, getActorCount()]
+   * @return the actor's name
+   */
+  string getActorName(const int actorId) const;
+
+  /**
+   * Method: getMovieId
+   * ---------------
+   * @param movie film struct
+   * @return the movie's id, or 0 if the movie isn't in the database
+   */
+  int getMovieId(const film& movie) const;
+
+  /**
+   * Methods: getActorIds
+   *          getMovieIds
+   * ---------------
+   * getActorId/getMovieId for many names at once.  Each binary search runs
+   * as a coroutine that prefetches the offset slot or record it is about to
+   * compare against and then suspends; inFlight of them are interleaved
+   * round robin, so one thread keeps that many memory accesses in flight
+   * instead of waiting out each one in turn.  Defined in
+   * imdb-interleaved.cpp, the one file built as C++20.
+   *
+   * @param actorIds, movieIds set to one id per name, 0 where it isn't in the database
+   * @param inFlight how many searches to interleave (1 runs them one by one)
+   */
+  void getActorIds(const vector<string>& players, vector<int>& actorIds, const int inFlight = 16) const;
+  void getMovieIds(const vector<film>& movies, vector<int>& movieIds, const int inFlight = 16) const;
+
+  /**
+   * Method: getFilm
+   * ---------------
+   * @param movieId an id in the range [1, getMovieCount()]
+   * @return the movie as a film struct
+   */
+  film getFilm(const int movieId) const;
+
+  /**
+   * Method: getMovieYear
+   * ---------------
+   * Reads just the year of a movie, without building its title.
+   *
+   * @param movieId an id in the range [1, getMovieCount()]
+   * @return the year the movie was released
+   */
+  int getMovieYear(const int movieId) const;
+
+  /**
+   * Methods: getActorNameView
+   *          getMovieTitleView
+   * ---------------
+   * getActorName and getFilm's title without copying them out: the views
+   * point into the data files (or the delta), so nothing is allocated and
+   * they stay valid for as long as the imdb does.
+   *
+   * @param actorId, movieId ids in the range [1, getActorCount()]/[1, getMovieCount()]
+   */
+  string_view getActorNameView(const int actorId) const;
+  string_view getMovieTitleView(const int movieId) const;
+
+  /**
+   * Method: getCreditIds
+   * ---------------
+   * The id-level equivalent of getCredits.
+   *
+   * @param actorId an id in the range [1, getActorCount()]
+   * @param movieIds cleared and filled with the ids of the actor's movies
+   */
+  void getCreditIds(const int actorId, vector<int>& movieIds) const;
+
+  /**
+   * Method: getCastIds
+   * ---------------
+   * The id-level equivalent of getCast.
+   *
+   * @param movieId an id in the range [1, getMovieCount()]
+   * @param actorIds cleared and filled with the ids of the movie's cast
+   */
+  void getCastIds(const int movieId, vector<int>& actorIds) const;
+
+  /**
+   * Methods: prefetchCreditIndex
+   *          prefetchCredits
+   *          prefetchCastIndex
+   *          prefetchCast
+   * ---------------
+   * Hints that getCreditIds/getCastIds will soon be called for an id, so
+   * its record can be on its way from memory while other work is done.
+   * The Index forms only touch the id's slot in the offset table.  The
+   * others read that slot and prefetch the start of the record itself, so
+   * they should follow the index prefetch by a while rather than replace
+   * it, or they just wait on the miss the index prefetch would have hidden.
+   * Neither reads anything else, and neither is needed for correctness.
+   *
+   * @param actorId, movieId ids in the range [1, getActorCount()]/[1, getMovieCount()]
+   */
+  void prefetchCreditIndex(const int actorId) const;
+  void prefetchCredits(const int actorId) const;
+  void prefetchCastIndex(const int movieId) const;
+  void prefetchCast(const int movieId) const;
+
+  /**
+   * Method: getCommonMovieIds
+   * ---------------
+   * The movies two actors were both in.  The two actors' offset lists are
+   * intersected where they lie in the actor file (see intersectSorted), and
+   * only the offsets they share are turned into ids.
+   *
+   * @param actorA, actorB ids in the range [1, getActorCount()]
+   * @param movieIds cleared and filled with the ids of the shared movies, in id order
+   */
+  void getCommonMovieIds(const int actorA, const int actorB, vector<int>& movieIds) const;
+
+  /**
+   * Method: getCommonFilms
+   * ---------------
+   * getCommonMovieIds by name.
+   *
+   * @return true if and only if both players are in the database
+   */
+  bool getCommonFilms(const string& playerA, const string& playerB, vector<film>& films) const;
+
+  /**
+   * Struct: costar
+   * ---------------
+   * Someone an actor has worked with, and in how many films.
+   */
+  struct costar {
+    int actorId;
+    int sharedFilms;
+  };
+
+  /**
+   * Method: getCostars
+   * ---------------
+   * Everyone who shares at least one film with an actor, counted on ids alone:
+   * the casts of the actor's films are pooled, sorted and counted in runs, with
+   * long filmographies split across threads.  No names are built, so callers
+   * should only look up the names of the costars they actually print.
+   *
+   * @param actorId an id in the range [1, getActorCount()]
+   * @param costars cleared and filled with the actor's costars (never the actor)
+   * @param limit 0 for all of them, in id (and so, for actors in the data files,
+   *              name) order; otherwise just the limit costars sharing the most
+   *              films, most first, ties in id order
+   */
+  void getCostars(const int actorId, vector<costar>& costars, const int limit = 0) const;
+
+  /**
+   * Method: hasWideOffsets
+   * ---------------
+   * @return true if the data files store their offsets in 8 bytes (see kWideOffsetsMarker)
+   */
+  bool hasWideOffsets() const;
+
+  /**
+   * Constant: kWideOffsetsMarker
+   * ---------------
+   * The original files store every count and offset in 4 bytes, which caps each file
+   * at 2 GiB.  Bigger datasets use 8-byte counts and offsets instead, and say so by
+   * starting the file with this (negative, so never a valid count) int32, followed
+   * by 4 bytes of padding, the 8-byte record count and the 8-byte offset table.
+   * Records then pad to 8 rather than 4 bytes before their offset arrays.  Both
+   * files of an imdb must use the same width.
+   */
+  static const int32_t kWideOffsetsMarker = -8;
+
+  /**
+   * Method: prefault
+   * ---------------
+   * Reads every page of both data files, so lookups that follow never wait on
+   * the disk.  Meant for warming a freshly mapped imdb before it serves queries.
+   */
+  void prefault() const;
+
+  /**
+   * Methods: getDataBytes
+   *          getHugePageBytes
+   * ---------------
+   * @return the bytes of memory holding the two data files, and how many of
+   *         them are on 2 MiB pages right now (never any for kFileMapped;
+   *         for kInMemory, as many as the kernel managed to supply)
+   */
+  size_t getDataBytes() const;
+  size_t getHugePageBytes() const;
+
+  /**
+   * Method: getDeltaEditCount
+   * ---------------
+   * @return the number of credits credits.delta adds or removes relative to the
+   *         data files (0 when there is no delta, or it changes nothing)
+   */
+  int getDeltaEditCount() const;
+
+  /**
+   * Methods: getFileActorCount
+   *          getFileMovieCount
+   * ---------------
+   * @return the number of actors/movies in the data files themselves, leaving out
+   *         any that only credits.delta has (whose ids come after these)
+   */
+  int getFileActorCount() const;
+  int getFileMovieCount() const;
+
+  /**
+   * Struct: fingerprint
+   * ---------------
+   * The sizes and modification times (in nanoseconds) of actors.data,
+   * movies.data and credits.delta, zeros standing in for a missing delta.
+   * Files built from an imdb (graph.vbyte, the name index, ranking.data,
+   * the shard files) record the fingerprint they were built from and are
+   * stale as soon as the directory's no longer matches it: rewritten data
+   * files, and a delta appended to, applied or compacted away, all change it.
+   */
+  struct fingerprint {
+    int64_t actorBytes, actorModified;
+    int64_t movieBytes, movieModified;
+    int64_t deltaBytes, deltaModified;
+
+    bool operator==(const fingerprint& rhs) const {
+      return actorBytes == rhs.actorBytes && actorModified == rhs.actorModified &&
+             movieBytes == rhs.movieBytes && movieModified == rhs.movieModified &&
+             deltaBytes == rhs.deltaBytes && deltaModified == rhs.deltaModified;
+    }
+    bool operator!=(const fingerprint& rhs) const { return !(*this == rhs); }
+  };
+
+  /**
+   * Methods: getFingerprint
+   *          readFingerprint
+   * ---------------
+   * @return the fingerprint of the files this imdb opened (taken just before
+   *         it opened them, so a file replaced in between reads as stale
+   *         rather than current), or of the files in directory right now
+   */
+  const fingerprint& getFingerprint() const;
+  static fingerprint readFingerprint(const string& directory);
 
   /**
    * Destructor: ~imdb
@@ -97,7 +395,8 @@ class imdb {
   static const char *const kMovieFileName;
   const void *actorFile;
   const void *movieFile;
-  
+  fingerprint opened;
+
 
   // everything below here is complicated and needn't be touched.
   // you're free to investigate, but you're on your own.
@@ -105,10 +404,54 @@ class imdb {
     int fd;
     size_t fileSize;
     const void *fileMap;
+    size_t mapSize;    // fileSize, or for loaded files the whole number of huge pages holding it
+    bool loaded;       // read into anonymous memory rather than mapped
+    bool wideOffsets;
   } actorInfo, movieInfo;
   
   static const void *acquireFileMap(const string& fileName, struct fileInfo& info);
+  static const void *loadFile(const string& fileName, struct fileInfo& info);
   static void releaseFileMap(struct fileInfo& info);
+  static void prefaultFileMap(const struct fileInfo& info);
+
+  // credits.delta, resolved against the data files.  Ids past baseActors/baseMovies
+  // belong to actors/movies only the delta has; added and removed lists are keyed
+  // by actor (credits) and by movie (cast); the removed ones are sorted.
+  struct deltaOverlay {
+    int baseActors, baseMovies;
+    vector<string> players;
+    vector<film> films;
+    map<string, int> playerIds;
+    map<film, int> filmIds;
+    map<int, vector<int> > addedCredits, removedCredits;
+    map<int, vector<int> > addedCast, removedCast;
+    int editCount;
+  } delta;
+  bool hasDelta;
+
+  /**
+   * Method: loadDelta
+   * ---------------
+   * Reads directory/credits.delta, if any, and works out what it changes
+   * relative to the data files.  Called once the files are mapped.
+   */
+  void loadDelta(const string& directory);
+
+  /**
+   * Method: overlayIds
+   * ---------------
+   * Removes the ids the delta removed from a base list and appends the ones it added
+   */
+  static void overlayIds(const int id, const map<int, vector<int> >& added,
+                         const map<int, vector<int> >& removed, vector<int>& ids);
+
+  /**
+   * Method: countCostars
+   * ---------------
+   * getCostars for the credits in [begin, end), by id
+   */
+  void countCostars(const int actorId, const vector<int>& credits, const size_t begin, const size_t end,
+                    vector<costar>& costars) const;
 
   // marked as private so imdbs can't be copy constructed or reassigned.
   // if we were to allow this, we'd alias open files and accidentally close
@@ -120,8 +463,47 @@ class imdb {
 
   // Common Types
 
-  // Offsets are stored using 4 bytes
+  // Offsets are stored using 4 bytes (or 8, in files starting with kWideOffsetsMarker).
+  // Everything that reads an offset from a file is templated on the stored
+  // type, and each public method picks the width once, so the 4-byte path
+  // compiles to exactly what it did before wide files existed.
   typedef int32_t OffsetInt;
+  typedef int64_t WideOffsetInt;
+
+  // A byte offset into either file, whatever width it was stored with
+  typedef int64_t ByteOffset;
+
+  /**
+   * Method: isWide
+   * ---------------
+   * @return true if the files use WideOffsetInt rather than OffsetInt
+   */
+  bool isWide() const;
+
+  // one file's offset table and records, for code outside imdb.cpp that
+  // walks the records itself (the interleaved lookups); offsets[i] is the
+  // ith record's offset, of type WideOffsetInt if wide and OffsetInt if not
+  struct recordTable {
+    const void *offsets;
+    bool wide;
+    int count;
+    const char *records;
+  };
+
+  recordTable af_getRecordTable() const;
+  recordTable mf_getRecordTable() const;
+
+  // width specific bodies of the public methods of the same name
+  template <typename T>
+  bool getCreditsAs(const string& player, vector<film>& films) const;
+  template <typename T>
+  bool getCastAs(const film& movie, vector<string>& players) const;
+  template <typename T>
+  void getCreditIdsAs(const int actorId, vector<int>& movieIds) const;
+  template <typename T>
+  void getCastIdsAs(const int movieId, vector<int>& actorIds) const;
+  template <typename T>
+  void getCommonMovieIdsAs(const int actorA, const int actorB, vector<int>& movieIds) const;
 
   /*
    * *********************************************************************************************
@@ -151,6 +533,26 @@ class imdb {
   template <typename T>
   vector<T> af_getMovieOffsets(const string& player) const;
 
+  /**
+   * Method: af_getMovieOffsetRange
+   * ---------------
+   * Locates the movie offsets stored in the ith actor's record, in place
+   *
+   * @param ithActor
+   * @param begin set to the first offset
+   * @param end set one past the last offset
+   */
+  template <typename T>
+  void af_getMovieOffsetRange(const int ithActor, const T*& begin, const T*& end) const;
+
+  /**
+   * Method: af_prefetchRecord
+   * ---------------
+   * prefetchCreditIndex (indexOnly) or prefetchCredits for the ith actor
+   */
+  template <typename T>
+  void af_prefetchRecord(const int ithActor, const bool indexOnly) const;
+
   /**
    * Method: af_findActor
    * ---------------
@@ -160,6 +562,7 @@ class imdb {
    * @return 0 if not found,
    * 		 else a index to the actor file representing the ith actor
    */
+  template <typename T>
   int af_findActor(const string& player) const;
 
   /**
@@ -169,8 +572,20 @@ class imdb {
    *
    * @return total number of actors
    */
+  template <typename T>
   int af_getTotalActors() const;
 
+  /**
+   * Method: af_getOffsetTable
+   * ---------------
+   * Return the actor file's table of T-sized record offsets, arranged so that
+   * element 0 is the number of actors and element i the offset of the ith actor
+   *
+   * @return a T* pointer
+   */
+  template <typename T>
+  const T* af_getOffsetTable() const;
+
   /**
    * Method: af_getithActorOffset
    * ---------------
@@ -179,7 +594,31 @@ class imdb {
    * @param ithActor
    * @return offset to actor record
    */
-  int af_getithActorOffset(const int ithActor) const;
+  template <typename T>
+  ByteOffset af_getithActorOffset(const int ithActor) const;
+
+  /**
+   * Method: af_getithActorEndOffset
+   * ---------------
+   * Given the ith actor, return the offset one past the end of the actor record
+   * (the start of the next record, or the file size for the last actor)
+   *
+   * @param ithActor
+   * @return offset to the end of the actor record
+   */
+  template <typename T>
+  ByteOffset af_getithActorEndOffset(const int ithActor) const;
+
+  /**
+   * Method: af_getActorIdByOffset
+   * ---------------
+   * Binary search of the offset table for the actor record at the given byte offset
+   *
+   * @param actorByteOffset
+   * @return the ith actor
+   */
+  template <typename T>
+  int af_getActorIdByOffset(const ByteOffset actorByteOffset) const;
 
   /**
    * Method: af_getActorNameByOffset
@@ -189,7 +628,7 @@ class imdb {
    * @param actorByteOffset
    * @return actor name
    */
-  string af_getActorNameByOffset(const int actorByteOffset) const;
+  string af_getActorNameByOffset(const ByteOffset actorByteOffset) const;
 
   /*
    * *********************************************************************************************
@@ -219,6 +658,26 @@ class imdb {
   template <typename T>
   vector<T> mf_getActorOffsets(const film& movie) const;
 
+  /**
+   * Method: mf_getActorOffsetRange
+   * ---------------
+   * Locates the actor offsets stored in the ith movie's record, in place
+   *
+   * @param ithMovie
+   * @param begin set to the first offset
+   * @param end set one past the last offset
+   */
+  template <typename T>
+  void mf_getActorOffsetRange(const int ithMovie, const T*& begin, const T*& end) const;
+
+  /**
+   * Method: mf_prefetchRecord
+   * ---------------
+   * prefetchCastIndex (indexOnly) or prefetchCast for the ith movie
+   */
+  template <typename T>
+  void mf_prefetchRecord(const int ithMovie, const bool indexOnly) const;
+
   /**
    * Method: mf_findMovie
    * ---------------
@@ -227,6 +686,7 @@ class imdb {
    * @param movie a film struct
    * @return 0 if not found, else an int representing the ithMovie in the file
    */
+  template <typename T>
   int mf_findMovie(const film& movie) const;
 
   /**
@@ -237,7 +697,7 @@ class imdb {
    * @param offset
    * @return movie title
    */
-  string mf_getMovieTitleByOffset (const int offset) const;
+  string mf_getMovieTitleByOffset (const ByteOffset offset) const;
 
   /**
    * Method: mf_getMovieYearByOffset
@@ -247,7 +707,7 @@ class imdb {
    * @param offset
    * @return movie year
    */
-  int mf_getMovieYearByOffset (const int offset) const;
+  int mf_getMovieYearByOffset (const ByteOffset offset) const;
 
   /**
    * Method: mf_getFilmByOffset
@@ -257,7 +717,7 @@ class imdb {
    * @param offset
    * @return film struct
    */
-  film mf_getFilmByOffset(const int offset) const;
+  film mf_getFilmByOffset(const ByteOffset offset) const;
 
   /**
    * Method: mf_getTotalMovies
@@ -266,8 +726,20 @@ class imdb {
    *
    * @return total number of movies
    */
+  template <typename T>
   int mf_getTotalMovies() const;
 
+  /**
+   * Method: mf_getOffsetTable
+   * ---------------
+   * Return the movie file's table of T-sized record offsets, arranged so that
+   * element 0 is the number of movies and element i the offset of the ith movie
+   *
+   * @return a T* pointer
+   */
+  template <typename T>
+  const T* mf_getOffsetTable() const;
+
   /**
    * Method: mf_getithMovieOffset
    * ---------------
@@ -277,7 +749,31 @@ class imdb {
    * @param ithMovie
    * @return the offset to the ithMovie
    */
-  int mf_getithMovieOffset(const int ithMovie) const;
+  template <typename T>
+  ByteOffset mf_getithMovieOffset(const int ithMovie) const;
+
+  /**
+   * Method: mf_getithMovieEndOffset
+   * ---------------
+   * Given the ith movie, return the offset one past the end of the movie record
+   * (the start of the next record, or the file size for the last movie)
+   *
+   * @param ithMovie
+   * @return offset to the end of the movie record
+   */
+  template <typename T>
+  ByteOffset mf_getithMovieEndOffset(const int ithMovie) const;
+
+  /**
+   * Method: mf_getMovieIdByOffset
+   * ---------------
+   * Binary search of the offset table for the movie record at the given byte offset
+   *
+   * @param movieByteOffset
+   * @return the ith movie
+   */
+  template <typename T>
+  int mf_getMovieIdByOffset(const ByteOffset movieByteOffset) const;
 
   // Helper functions
 
@@ -292,7 +788,19 @@ class imdb {
    * @return pointer with offset applied
    */
   template <typename T>
-  const T* applyByteOffset (const T* ptr, const int bytes) const;
+  const T* applyByteOffset (const T* ptr, const ByteOffset bytes) const;
+
+  /**
+   * Method: paddingFor
+   * ---------------
+   * Records pad their header (name/title, year, short) so the offset array
+   * that follows is aligned for offsets of type T
+   *
+   * @param bytes the size of the record header
+   * @return the number of padding bytes that follow it
+   */
+  template <typename T>
+  static int paddingFor(const int bytes);
 
 };
 
@@ -0,0 +1,376 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fstream>
+#include <algorithm>
+#include "name-index.h"
+#include "replacement-file.h"
+
+const char *const nameIndex::kIndexFileName = "names.index";
+
+namespace {
+
+const int32_t kMagic = 0x5844494e; // "NIDX"
+const int32_t kVersion = 2;
+
+// trigram similarity below which a fuzzy match isn't worth suggesting
+const double kMinSimilarity = 0.3;
+
+// bounds the verification work for very short or very common queries
+const size_t kMaxCandidates = 20000;
+
+/**
+ * Function: foldedCompare
+ * -----------------------
+ * strcmp, ignoring ASCII case.
+ */
+int foldedCompare(const char *a, const char *b)
+{
+    const unsigned char *ua = reinterpret_cast<const unsigned char*>(a);
+    const unsigned char *ub = reinterpret_cast<const unsigned char*>(b);
+    while (*ua != '\0' && tolower(*ua) == tolower(*ub)) { ++ua; ++ub; }
+    return tolower(*ua) - tolower(*ub);
+}
+
+/**
+ * Function: hasFoldedPrefix
+ * -------------------------
+ * True if name starts with prefix, ignoring ASCII case.
+ */
+bool hasFoldedPrefix(const char *name, const string& prefix)
+{
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (name[i] == '\0' ||
+            tolower((unsigned char) name[i]) != tolower((unsigned char) prefix[i])) return false;
+    }
+    return true;
+}
+
+}
+
+nameIndex::nameIndex(const string& directory, const imdb& db) : fd(-1), fileSize(0), fileMap(NULL)
+{
+    const string fileName = directory + "/" + kIndexFileName;
+    if (!map(fileName, db) && build(db, fileName)) map(fileName, db);
+}
+
+bool nameIndex::good() const
+{
+    return fileMap != NULL;
+}
+
+nameIndex::~nameIndex()
+{
+    unmap();
+}
+
+/*
+ * *********************************************************************************************
+ * Lookups
+ * *********************************************************************************************
+ */
+
+void nameIndex::complete(const string& prefix, int limit, vector<suggestion>& matches, nameKind kind) const
+{
+    matches.clear();
+    if (!good() || prefix.empty()) return;
+
+    // binary search for the first name not less than the prefix
+    const entry *entries = getEntries();
+    int lower = 0, upper = getHeader()->numEntries;
+    while (lower < upper) {
+        int mid = lower + (upper - lower) / 2;
+        if (foldedCompare(getName(entries[mid]), prefix.c_str()) < 0) lower = mid + 1;
+        else upper = mid;
+    }
+
+    for (int i = lower; i < getHeader()->numEntries && (int) matches.size() < limit; ++i) {
+        if (!hasFoldedPrefix(getName(entries[i]), prefix)) break;
+        if (!isKind(entries[i], kind)) continue;
+        matches.push_back(makeSuggestion(entries[i], 1.0));
+    }
+}
+
+void nameIndex::suggest(const string& query, int limit, vector<suggestion>& matches, nameKind kind) const
+{
+    matches.clear();
+    if (!good() || query.empty()) return;
+
+    vector<uint32_t> queryTrigrams;
+    trigramsOf(query, queryTrigrams);
+
+    // find the posting list of each query trigram (trigrams nobody has get an empty list)
+    const trigramEntry *table = getTrigrams();
+    const trigramEntry *tableEnd = table + getHeader()->numTrigrams;
+    vector<pair<int32_t, int64_t> > lists; // (count, first)
+    for (size_t i = 0; i < queryTrigrams.size(); ++i) {
+        int lower = 0, upper = tableEnd - table;
+        while (lower < upper) {
+            int mid = lower + (upper - lower) / 2;
+            if (table[mid].trigram < queryTrigrams[i]) lower = mid + 1;
+            else upper = mid;
+        }
+        const trigramEntry *t = table + lower;
+        if (t != tableEnd && t->trigram == queryTrigrams[i]) lists.push_back(make_pair(t->count, t->first));
+        else lists.push_back(make_pair(0, 0));
+    }
+    sort(lists.begin(), lists.end());
+
+    // Anything similar enough shares at least minShared of the query's trigrams, so
+    // it must appear in one of the (total - minShared + 1) rarest lists.  Only those
+    // are scanned for candidates, which keeps common trigrams like " jo" off the hot path.
+    const int total = queryTrigrams.size();
+    int minShared = (int) (kMinSimilarity * total);
+    if (minShared < kMinSimilarity * total) minShared++;
+    if (minShared < 1) minShared = 1;
+    vector<int32_t> candidates;
+    const int32_t *postings = getPostings();
+    for (int i = 0; i <= total - minShared && candidates.size() < kMaxCandidates; ++i) {
+        candidates.insert(candidates.end(), postings + lists[i].second,
+                          postings + lists[i].second + lists[i].first);
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // verify: score every candidate against the whole query
+    const entry *entries = getEntries();
+    vector<pair<double, int32_t> > scored;
+    vector<uint32_t> nameTrigrams;
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        if (!isKind(entries[candidates[c]], kind)) continue;
+        trigramsOf(getName(entries[candidates[c]]), nameTrigrams);
+        int shared = 0;
+        vector<uint32_t>::const_iterator q = queryTrigrams.begin(), n = nameTrigrams.begin();
+        while (q != queryTrigrams.end() && n != nameTrigrams.end()) {
+            if (*q < *n) ++q;
+            else if (*n < *q) ++n;
+            else { ++shared; ++q; ++n; }
+        }
+        double similarity = (double) shared / (total + nameTrigrams.size() - shared);
+        if (similarity >= kMinSimilarity) scored.push_back(make_pair(-similarity, candidates[c]));
+    }
+
+    int count = min((int) scored.size(), limit);
+    partial_sort(scored.begin(), scored.begin() + count, scored.end());
+    for (int i = 0; i < count; ++i) {
+        matches.push_back(makeSuggestion(entries[scored[i].second], -scored[i].first));
+    }
+}
+
+/*
+ * *********************************************************************************************
+ * Building
+ * *********************************************************************************************
+ */
+
+namespace {
+
+struct namedRecord {
+    string name;
+    int32_t id;
+
+    bool operator<(const namedRecord& rhs) const {
+        int cmp = foldedCompare(name.c_str(), rhs.name.c_str());
+        return cmp < 0 || (cmp == 0 && (name < rhs.name || (name == rhs.name && id < rhs.id)));
+    }
+};
+
+}
+
+bool nameIndex::build(const imdb& db, const string& fileName)
+{
+    // collect and sort every actor name and movie title
+    vector<namedRecord> records;
+    records.reserve(db.getActorCount() + db.getMovieCount());
+    for (int i = 1; i <= db.getActorCount(); ++i) {
+        namedRecord r = { db.getActorName(i), i };
+        records.push_back(r);
+    }
+    for (int i = 1; i <= db.getMovieCount(); ++i) {
+        namedRecord r = { db.getFilm(i).title, -i };
+        records.push_back(r);
+    }
+    sort(records.begin(), records.end());
+
+    // lay out the entries and names
+    vector<entry> entries(records.size());
+    vector<char> names;
+    vector<pair<uint32_t, int32_t> > pairs; // (trigram, entry)
+    vector<uint32_t> trigrams;
+    for (size_t i = 0; i < records.size(); ++i) {
+        entries[i].nameOffset = names.size();
+        entries[i].id = records[i].id;
+        entries[i].padding = 0;
+        names.insert(names.end(), records[i].name.begin(), records[i].name.end());
+        names.push_back('\0');
+
+        trigramsOf(records[i].name, trigrams);
+        for (size_t t = 0; t < trigrams.size(); ++t) pairs.push_back(make_pair(trigrams[t], (int32_t) i));
+    }
+    while (names.size() % 4 != 0) names.push_back('\0');
+    sort(pairs.begin(), pairs.end());
+
+    // group the (trigram, entry) pairs into the trigram table and the postings
+    vector<trigramEntry> table;
+    vector<int32_t> postings(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (table.empty() || table.back().trigram != pairs[i].first) {
+            trigramEntry t = { pairs[i].first, 0, (int64_t) i };
+            table.push_back(t);
+        }
+        table.back().count++;
+        postings[i] = pairs[i].second;
+    }
+
+    header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.numActors = db.getActorCount();
+    h.numMovies = db.getMovieCount();
+    h.source = db.getFingerprint();
+    h.numEntries = entries.size();
+    h.numTrigrams = table.size();
+    h.entriesOffset = sizeof(header);
+    h.trigramsOffset = h.entriesOffset + entries.size()*sizeof(entry);
+    h.postingsOffset = h.trigramsOffset + table.size()*sizeof(trigramEntry);
+    h.namesOffset = h.postingsOffset + postings.size()*sizeof(int32_t);
+
+    // write to the side and rename, so a concurrent reader never maps half an index
+    replacementFile file(fileName);
+    if (!file.good()) return false;
+    ofstream& out = file.stream();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    writeBlock(out, entries);
+    writeBlock(out, table);
+    writeBlock(out, postings);
+    writeBlock(out, names);
+    return file.commit();
+}
+
+/**
+ * Trigrams are taken over the lower-cased name padded with two leading blanks
+ * and one trailing blank, so the start of a name weighs more than its middle.
+ * The result is sorted and free of duplicates.
+ */
+void nameIndex::trigramsOf(const string& name, vector<uint32_t>& trigrams)
+{
+    trigrams.clear();
+    string padded = "  ";
+    for (size_t i = 0; i < name.size(); ++i) padded += (char) tolower((unsigned char) name[i]);
+    padded += " ";
+    for (size_t i = 0; i + 2 < padded.size(); ++i) {
+        trigrams.push_back(((uint32_t) (unsigned char) padded[i] << 16) |
+                           ((uint32_t) (unsigned char) padded[i + 1] << 8) |
+                            (uint32_t) (unsigned char) padded[i + 2]);
+    }
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+/*
+ * *********************************************************************************************
+ * File mapping and layout
+ * *********************************************************************************************
+ */
+
+bool nameIndex::map(const string& fileName, const imdb& db)
+{
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) != 0 || (size_t) stats.st_size < sizeof(header)) return false;
+    fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    fileSize = stats.st_size;
+    void *mapped = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        unmap();
+        return false;
+    }
+    fileMap = mapped;
+
+    // a stale index (built over different data files, or another delta) is as good as none
+    const header *h = getHeader();
+    if (h->magic != kMagic || h->version != kVersion || h->source != db.getFingerprint() ||
+        h->numActors != db.getActorCount() || h->numMovies != db.getMovieCount() || !hasValidLayout()) {
+        unmap();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The sections have to follow one another as build lays them out, each as
+ * long as the header's counts say, and the names have to end inside the
+ * file, so nothing read through the header can run off the mapping.
+ */
+bool nameIndex::hasValidLayout() const
+{
+    const header *h = getHeader();
+    if (h->numEntries != (int64_t) h->numActors + h->numMovies || h->numTrigrams < 0) return false;
+    if (h->entriesOffset != (int64_t) sizeof(header) ||
+        h->trigramsOffset != h->entriesOffset + (int64_t) h->numEntries * (int64_t) sizeof(entry) ||
+        h->postingsOffset != h->trigramsOffset + (int64_t) h->numTrigrams * (int64_t) sizeof(trigramEntry)) {
+        return false;
+    }
+    if (h->namesOffset < h->postingsOffset || (h->namesOffset - h->postingsOffset) % sizeof(int32_t) != 0 ||
+        (uint64_t) h->namesOffset > fileSize) {
+        return false;
+    }
+    // every name is terminated, so the last byte of the file is a '\0' whenever there are names
+    return h->numEntries == 0 || ((uint64_t) h->namesOffset < fileSize &&
+                                  static_cast<const char*>(fileMap)[fileSize - 1] == '\0');
+}
+
+void nameIndex::unmap()
+{
+    if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+    if (fd != -1) close(fd);
+    fileMap = NULL;
+    fd = -1;
+}
+
+const nameIndex::header *nameIndex::getHeader() const
+{
+    return static_cast<const header*>(fileMap);
+}
+
+const nameIndex::entry *nameIndex::getEntries() const
+{
+    return reinterpret_cast<const entry*>(static_cast<const char*>(fileMap) + getHeader()->entriesOffset);
+}
+
+const nameIndex::trigramEntry *nameIndex::getTrigrams() const
+{
+    return reinterpret_cast<const trigramEntry*>(static_cast<const char*>(fileMap) + getHeader()->trigramsOffset);
+}
+
+const int32_t *nameIndex::getPostings() const
+{
+    return reinterpret_cast<const int32_t*>(static_cast<const char*>(fileMap) + getHeader()->postingsOffset);
+}
+
+const char *nameIndex::getName(const entry& e) const
+{
+    return static_cast<const char*>(fileMap) + getHeader()->namesOffset + e.nameOffset;
+}
+
+bool nameIndex::isKind(const entry& e, nameKind kind)
+{
+    return kind == kAnyName || (kind == kActorName) == (e.id > 0);
+}
+
+suggestion nameIndex::makeSuggestion(const entry& e, double score) const
+{
+    suggestion s;
+    s.isActor = e.id > 0;
+    s.id = s.isActor ? e.id : -e.id;
+    s.name = getName(e);
+    s.score = score;
+    return s;
+}
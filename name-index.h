@@ -0,0 +1,170 @@
+#ifndef __name_index__
+#define __name_index__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Convenience struct: suggestion
+ * ------------------------------
+ * One match handed back by a nameIndex lookup.  Actors and movies share the
+ * index, so isActor says which of imdb::getActorName/imdb::getFilm the id is for.
+ * score is 1.0 for prefix completions and the trigram similarity (0, 1) for
+ * fuzzy matches.
+ */
+
+struct suggestion {
+  bool isActor;
+  int id;
+  string name;
+  double score;
+};
+
+/**
+ * Class: nameIndex
+ * ----------------
+ * A search index over every actor name and movie title in an imdb, supporting
+ * case-insensitive prefix completion and typo-tolerant (trigram) matching.
+ *
+ * The index is built once from the imdb and written next to the data files
+ * as names.index.  Like actors.data/movies.data it is a relocatable image of
+ * ints and C-strings, so later runs simply mmap it.  Offsets into the file
+ * are 8 bytes, so the index has no size limit of its own:
+ *
+ *     header                magic, version, counts, section offsets, and the
+ *                           fingerprint of the data files it was built from
+ *     entries[numEntries]   { nameOffset, id } sorted by case-folded name;
+ *                           id > 0 is an actor id, id < 0 is -(movie id)
+ *     trigrams[numTrigrams] { trigram, posting count, first posting } sorted by trigram
+ *     postings[]            entry indices, ascending within each trigram
+ *     names                 the original C-strings
+ */
+
+class nameIndex {
+
+ public:
+
+  // restricts a lookup to actor names, movie titles, or both
+  enum nameKind { kAnyName, kActorName, kMovieName };
+
+  /**
+   * Constructor: nameIndex
+   * ----------------------
+   * Maps directory/names.index, building it from the imdb first if it is
+   * missing or stale: built from other data files than the imdb's, or
+   * before a change to its credits.delta (see imdb::fingerprint).
+   *
+   * @param directory the directory housing the imdb data files
+   * @param db the (good) imdb layered over those files
+   */
+  nameIndex(const string& directory, const imdb& db);
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if the index could be built (or found) and mapped.  A
+   * read-only data directory with no prebuilt index is the usual reason
+   * this returns false.
+   */
+  bool good() const;
+
+  /**
+   * Method: complete
+   * ----------------
+   * Case-insensitive prefix completion.
+   *
+   * @param prefix what the user has typed so far
+   * @param limit the maximum number of suggestions to return
+   * @param matches cleared and filled with up to limit suggestions, in name order
+   * @param kind which names to consider
+   */
+  void complete(const string& prefix, int limit, vector<suggestion>& matches,
+                nameKind kind = kAnyName) const;
+
+  /**
+   * Method: suggest
+   * ---------------
+   * Typo-tolerant lookup: returns the names sharing the most trigrams with
+   * the query (pg_trgm style similarity), best first.
+   *
+   * @param query the (possibly misspelled) name
+   * @param limit the maximum number of suggestions to return
+   * @param matches cleared and filled with up to limit suggestions
+   * @param kind which names to consider
+   */
+  void suggest(const string& query, int limit, vector<suggestion>& matches,
+               nameKind kind = kAnyName) const;
+
+  /**
+   * Static Method: build
+   * --------------------
+   * Writes a fresh index for the imdb into the specified file.
+   *
+   * @return true if and only if the file was written successfully
+   */
+  static bool build(const imdb& db, const string& fileName);
+
+  /**
+   * Destructor: ~nameIndex
+   * ----------------------
+   * Unmaps the index.
+   */
+  ~nameIndex();
+
+  // the index file's name within the data directory (names.index)
+  static const char *const kIndexFileName;
+
+ private:
+  struct header {
+    int32_t magic;
+    int32_t version;
+    int32_t numActors;    // counts of the imdb the index was built from
+    int32_t numMovies;
+    int32_t numEntries;
+    int32_t numTrigrams;
+    int64_t entriesOffset;
+    int64_t trigramsOffset;
+    int64_t postingsOffset;
+    int64_t namesOffset;
+    imdb::fingerprint source;
+  };
+
+  struct entry {
+    int64_t nameOffset;
+    int32_t id;
+    int32_t padding;
+  };
+
+  struct trigramEntry {
+    uint32_t trigram;
+    int32_t count;
+    int64_t first;
+  };
+
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  bool map(const string& fileName, const imdb& db);
+  bool hasValidLayout() const;
+  void unmap();
+
+  const header *getHeader() const;
+  const entry *getEntries() const;
+  const trigramEntry *getTrigrams() const;
+  const int32_t *getPostings() const;
+  const char *getName(const entry& e) const;
+  suggestion makeSuggestion(const entry& e, double score) const;
+  static bool isKind(const entry& e, nameKind kind);
+
+  static void trigramsOf(const string& name, vector<uint32_t>& trigrams);
+
+  // not copyable, for the same reasons as imdb
+  nameIndex(const nameIndex& original);
+  nameIndex& operator=(const nameIndex& rhs);
+};
+
+#endif
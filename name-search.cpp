@@ -0,0 +1,224 @@
+using namespace std;
+#include <list>
+#include <set>
+#include <vector>
+#include <iostream>
+#include "name-search.h"
+
+namespace {
+
+const int MAX_DEPTH = 6;
+
+// nodes expanded between checks of the query options
+const int kNodesPerCheck = 64;
+
+/**
+ * *****************************************************************
+ * struct: trail
+ * One step of a partial path: the path it extends, and the film and
+ * player it extends it by.  The first step of every path has no film.
+ * The names are views straight into the imdb, never copies.
+ * *****************************************************************
+ */
+struct trail {
+    const trail *previous;
+    string_view title;
+    int year;
+    int playerId;
+    string_view player;
+};
+
+// common types
+typedef imdb                                             DB;
+typedef const trail *                                    NODE;
+typedef list<NODE, arenaAllocator<NODE> >                QUEUE;
+typedef vector<int>                                      IDS;
+
+/**
+ * *****************************************************************
+ * class: visitRecord
+ * A set of visited films and players, keyed by their ids
+ * *****************************************************************
+ */
+class visitRecord {
+    public:
+    visitRecord (queryArena& arena) :
+        players(less<int>(), arenaAllocator<int>(arena)),
+        films(less<int>(), arenaAllocator<int>(arena)) {}
+
+    // true if the player hadn't been visited before
+    bool recordPlayer (const int playerId)
+    {
+        return players.insert(playerId).second;
+    }
+
+    // true if the film hadn't been visited before
+    bool recordFilm (const int movieId)
+    {
+        return films.insert(movieId).second;
+    }
+
+    private:
+    set<int, less<int>, arenaAllocator<int> > players;
+    set<int, less<int>, arenaAllocator<int> > films;
+};
+
+NODE newNode(queryArena& arena, NODE previous, const string_view title, const int year, const int playerId,
+             const string_view player)
+{
+    trail *node = static_cast<trail *>(arena.allocate(sizeof(trail), alignof(trail)));
+    node->previous = previous;
+    node->title = title;
+    node->year = year;
+    node->playerId = playerId;
+    node->player = player;
+    return node;
+}
+
+/**
+ * *****************************************************************
+ *  Method: addChildrenNodes
+ *  ------------------
+ *  Replace the current nodes in the queue with their children
+ *
+ *  @param db The database to use
+ *  @param visited A record of visited players and films
+ *  @param searchQueue The queue
+ *  @param options The limits the search runs under
+ *  @param arena Where the children are allocated
+ *  @return kSearching, or why the search has to stop
+ *
+ * *****************************************************************
+ */
+queryStatus addChildrenNodes(const DB& db, visitRecord& visited, QUEUE& searchQueue, const queryOptions& options,
+                             queryArena& arena)
+{
+    // reused from node to node, and filled with ids rather than names, so
+    // expanding a node doesn't build a string or a film for everyone it reaches
+    IDS credits;
+    IDS cast;
+
+    ///////////////////////////////////////////////////////////////
+    // Go through each node in queue
+    int nodesInQueue = searchQueue.size();
+    for (int n = 0; n < nodesInQueue; ++n) {
+        ///////////////////////////////////////////////////////////////
+        // Get movies from player
+        NODE node = searchQueue.front();
+        credits.clear();
+        if (node->playerId != 0) db.getCreditIds(node->playerId, credits);
+        if (credits.size() > 0) {
+            for (IDS::const_iterator f = credits.begin(); f != credits.end(); ++f) {
+                if (visited.recordFilm(*f)) {
+                    const string_view title = db.getMovieTitleView(*f);
+                    const int year = db.getMovieYear(*f);
+                    ///////////////////////////////////////////////////////////////
+                    // Get cast of players from movie
+                    db.getCastIds(*f, cast);
+                    for (IDS::const_iterator p = cast.begin(); p != cast.end(); ++p) {
+                        // Add new node if not visited before
+                        if (visited.recordPlayer(*p)) {
+                            searchQueue.push_back(newNode(arena, node, title, year, *p, db.getActorNameView(*p)));
+                        }
+                    }
+                    ///////////////////////////////////////////////////////////////
+                }
+            }
+        } else {
+            cerr << "addChildrenNodes: Films could not be found for a player" << endl;
+        }
+        searchQueue.pop_front();
+        ///////////////////////////////////////////////////////////////
+        // Every so often, see whether the search may go on
+        if ((n + 1) % kNodesPerCheck == 0) {
+            const queryStatus status = options.check(arena.getBytesInUse());
+            if (status != kSearching) return status;
+        }
+    }
+    ///////////////////////////////////////////////////////////////
+    return kSearching;
+}
+
+bool isNodeTarget (const string& target, NODE node)
+{
+    return (string_view(target) == node->player);
+}
+
+/**
+ * Builds the path a node is the last step of.
+ */
+path makePath(NODE node)
+{
+    vector<NODE> steps;
+    for (; node != NULL; node = node->previous) steps.push_back(node);
+    path p = path(string(steps.back()->player));
+    for (size_t i = steps.size() - 1; i-- > 0;) {
+        film movie;
+        movie.title = string(steps[i]->title);
+        movie.year = steps[i]->year;
+        p.addConnection(movie, string(steps[i]->player));
+    }
+    return p;
+}
+
+/**
+ * *****************************************************************
+ *  Method: Breadth First Search
+ *  ------------------
+ *  search for target
+ *
+ *  @param db The database to use
+ *  @param depth Current depth a record of visited players and films
+ *  @param target The player to search for
+ *  @param visited A class containing information on visited players and films
+ *  @param searchQueue The current level of nodes
+ *  @param options The limits the search runs under
+ *  @param status Set to how the search ended
+ *  @param arena Where the search allocates
+ *
+ * *****************************************************************
+ */
+path BFS(const DB&     db,
+         const int&    depth,
+         const string& target,
+         visitRecord&  visited,
+         QUEUE&        searchQueue,
+         const queryOptions& options,
+         queryStatus&  status,
+         queryArena&   arena)
+{
+    // Check for target
+    for (QUEUE::iterator n = searchQueue.begin(); n != searchQueue.end(); ++n) {
+        if (isNodeTarget(target, *n)) {
+            status = kPathFound;
+            return makePath(*n);
+        }
+    }
+
+	if (depth < 1) {
+        // return an empty path
+        status = kNoPath;
+        return path("");
+    }
+
+    // search deeper
+    status = addChildrenNodes(db, visited, searchQueue, options, arena);
+    if (status != kSearching) return path("");
+    return BFS(db, depth - 1, target, visited, searchQueue, options, status, arena);
+}
+
+}
+
+path generateShortestPath(const DB& db, const string& source, const string& target,
+                          const queryOptions& options, queryStatus& status, queryArena& arena)
+{
+    visitRecord visited(arena); // a set of visited actors
+
+    // a source that isn't in the database still starts a path, which just goes nowhere
+    const int sourceId = db.getActorId(source);
+    if (sourceId != 0) visited.recordPlayer(sourceId);
+    QUEUE searchQueue = QUEUE(arenaAllocator<NODE>(arena));
+    searchQueue.push_back(newNode(arena, NULL, string_view(), 0, sourceId, arena.copy(source)));
+
+    return BFS(db, MAX_DEPTH, target, visited, searchQueue, options, status, arena);
+}
@@ -0,0 +1,37 @@
+#ifndef __name_search__
+#define __name_search__
+
+#include "imdb.h"
+#include "path.h"
+#include "query-options.h"
+#include "query-arena.h"
+#include <string>
+using namespace std;
+
+/**
+ * Function: generateShortestPath
+ * ------------------------------
+ * The original breadth first search, one level of the queue at a time
+ * from the source (graphSearch is the same search, tuned with stamped
+ * visited marks and prefetching, and run on ids alone).  Credits and
+ * casts are read as ids, and the names on the partial paths are views
+ * into the imdb (getActorNameView/getMovieTitleView), so expanding a
+ * player builds no strings.  Everything the search allocates for itself
+ * lives in the arena: its queue, its records of visited players and
+ * films, and the partial paths, each of which is a single link back to
+ * the path it extends rather than a full copy.  Only the path returned is
+ * built on the heap, so the caller can reset the arena as soon as this
+ * returns.
+ *
+ * @param db the database to search
+ * @param source the starting player
+ * @param target the player being searched for
+ * @param options the limits the search runs under
+ * @param status set to how the search ended
+ * @param arena where the search allocates
+ * @return the shortest path from source to target, or an empty one
+ */
+path generateShortestPath(const imdb& db, const string& source, const string& target,
+                          const queryOptions& options, queryStatus& status, queryArena& arena);
+
+#endif
@@ -0,0 +1,123 @@
+using namespace std;
+#include <sched.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "numa-placement.h"
+
+namespace {
+
+const char *const kNodeDirectory = "/sys/devices/system/node";
+
+bool readLine(const string& fileName, string& line)
+{
+    ifstream in(fileName.c_str());
+    return getline(in, line) && !line.empty();
+}
+
+}
+
+numaTopology::numaTopology()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool knowsAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    string online;
+    vector<int> nodes;
+    if (readLine(string(kNodeDirectory) + "/online", online) && parseCpuList(online, nodes)) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            ostringstream fileName;
+            fileName << kNodeDirectory << "/node" << nodes[i] << "/cpulist";
+            string list;
+            vector<int> ids, usable;
+            if (!readLine(fileName.str(), list) || !parseCpuList(list, ids)) continue;
+            for (size_t j = 0; j < ids.size(); j++) {
+                if (!knowsAllowed || (ids[j] < CPU_SETSIZE && CPU_ISSET(ids[j], &allowed))) usable.push_back(ids[j]);
+            }
+            if (!usable.empty()) cpus.push_back(usable);
+        }
+    }
+    if (!cpus.empty()) return;
+
+    // no NUMA information, so one node with whatever we may run on
+    cpus.resize(1);
+    for (int cpu = 0; cpu < CPU_SETSIZE && knowsAllowed; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) cpus[0].push_back(cpu);
+    }
+}
+
+int numaTopology::getNodeCount() const
+{
+    return cpus.size();
+}
+
+const vector<int>& numaTopology::getCpus(const int node) const
+{
+    return cpus[node];
+}
+
+bool numaTopology::pinCurrentThread(const int node) const
+{
+    if (cpus[node].empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus[node].size(); i++) CPU_SET(cpus[node][i], &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/**
+ * Method: parseCpuList
+ * --------------------
+ * Reads sysfs's list format, "0-3,8,10-11", into ids.
+ */
+bool numaTopology::parseCpuList(const string& list, vector<int>& ids)
+{
+    ids.clear();
+    istringstream in(list);
+    string range;
+    while (getline(in, range, ',')) {
+        char *end;
+        const long first = strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        if (end == range.c_str() || (*end != '\0' && *end != '\n') || first < 0 || last < first) return false;
+        for (long id = first; id <= last; id++) ids.push_back(id);
+    }
+    return !ids.empty();
+}
+
+compactGraphReplicas::compactGraphReplicas(const compactGraph& original, const numaTopology& topology) :
+    original(original)
+{
+    if (topology.getNodeCount() == 1) return;
+
+    replicas.resize(topology.getNodeCount(), NULL);
+    vector<thread> builders;
+    for (int node = 0; node < topology.getNodeCount(); node++) {
+        builders.push_back(thread([this, &topology, node]() {
+            topology.pinCurrentThread(node);
+            replicas[node] = compactGraph::replicate(this->original);
+        }));
+    }
+    for (size_t i = 0; i < builders.size(); i++) builders[i].join();
+}
+
+compactGraphReplicas::~compactGraphReplicas()
+{
+    for (size_t i = 0; i < replicas.size(); i++) delete replicas[i];
+}
+
+bool compactGraphReplicas::good() const
+{
+    for (size_t i = 0; i < replicas.size(); i++) {
+        if (!replicas[i]->good()) return false;
+    }
+    return original.good();
+}
+
+const compactGraph& compactGraphReplicas::getLocal(const int node) const
+{
+    return replicas.empty() ? original : *replicas[node];
+}
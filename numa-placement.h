@@ -0,0 +1,90 @@
+#ifndef __numa_placement__
+#define __numa_placement__
+
+#include "compact-graph.h"
+#include <vector>
+using namespace std;
+
+/**
+ * Class: numaTopology
+ * -------------------
+ * The machine's NUMA nodes and the CPUs on each, as Linux reports them
+ * under /sys/devices/system/node.  Only nodes that have CPUs this process
+ * may run on count, so a topology always has at least one node: machines
+ * (or containers) without NUMA, or without sysfs, look like a single node
+ * holding every CPU the process is allowed.
+ */
+
+class numaTopology {
+
+ public:
+  numaTopology();
+
+  int getNodeCount() const;
+
+  /**
+   * Method: getCpus
+   * ---------------
+   * @param node a node in the range [0, getNodeCount())
+   * @return the CPUs on that node this process may run on
+   */
+  const vector<int>& getCpus(const int node) const;
+
+  /**
+   * Method: pinCurrentThread
+   * ------------------------
+   * Restricts the calling thread to the CPUs of one node.  Memory the
+   * thread touches first afterwards is, under Linux's default policy,
+   * allocated on that node.
+   *
+   * @return true if and only if the thread was pinned
+   */
+  bool pinCurrentThread(const int node) const;
+
+ private:
+  vector<vector<int> > cpus;
+
+  static bool parseCpuList(const string& list, vector<int>& ids);
+};
+
+/**
+ * Class: compactGraphReplicas
+ * ---------------------------
+ * One copy of a compactGraph per NUMA node, each built by a thread pinned
+ * to its node so that its pages are local to it.  Workers pinned to a
+ * node then traverse getLocal(node) and never read another node's memory.
+ * On a single node machine there's nothing to gain from a copy, and
+ * getLocal just hands back the original.
+ */
+
+class compactGraphReplicas {
+
+ public:
+
+  /**
+   * Constructor: compactGraphReplicas
+   * ---------------------------------
+   * Copies original onto every node of topology (in parallel, one thread
+   * per node).  Both must outlive the replicas.
+   */
+  compactGraphReplicas(const compactGraph& original, const numaTopology& topology);
+  ~compactGraphReplicas();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if every node got its copy.
+   */
+  bool good() const;
+
+  const compactGraph& getLocal(const int node) const;
+
+ private:
+  const compactGraph& original;
+  vector<compactGraph *> replicas; // empty on a single node
+
+  compactGraphReplicas(const compactGraphReplicas& original);
+  compactGraphReplicas& operator=(const compactGraphReplicas& rhs);
+};
+
+#endif
@@ -0,0 +1,394 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <stdint.h>
+#include "imdb.h"
+#include "compact-graph.h"
+#include "numa-placement.h"
+#include "path-cache.h"
+#include "graph-search.h"
+#include "name-search.h"
+#include "query-arena.h"
+#include "bench-utils.h"
+using namespace std;
+
+/**
+ * Every heap allocation in the process is counted, so the report can say
+ * how many each query made.
+ */
+namespace {
+atomic<size_t> heapAllocations(0);
+}
+
+void *operator new(size_t bytes)
+{
+  heapAllocations.fetch_add(1, memory_order_relaxed);
+  void *memory = malloc(bytes == 0 ? 1 : bytes);
+  if (memory == NULL) throw bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+namespace {
+
+const int kMaxDepth = 6;
+
+struct engineReport {
+  int found;
+  double seconds;
+  vector<double> latencies;
+  size_t heapAllocations, arenaAllocations, arenaPeakBytes;
+};
+
+/**
+ * Function: runIdSearch
+ * ---------------------
+ * Times graphSearch over any adjacency, turning each result into a path as
+ * six-degrees would.
+ */
+template <typename Graph>
+engineReport runIdSearch(const Graph& graph, const imdb& db, const vector<pair<int, int> >& pairs)
+{
+  engineReport report = engineReport();
+  graphSearch<Graph> search(graph);
+  vector<int> hops;
+  const size_t heapBefore = heapAllocations.load();
+  const double start = now();
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const double began = now();
+    if (search.shortestPath(pairs[i].first, pairs[i].second, kMaxDepth, hops)) {
+      report.found++;
+      makePath(db, pairs[i].first, hops);
+    }
+    report.latencies.push_back(now() - began);
+  }
+  report.seconds = now() - start;
+  report.heapAllocations = heapAllocations.load() - heapBefore;
+  return report;
+}
+
+/**
+ * Function: runNameSearch
+ * -----------------------
+ * Times the name-based search, with one arena reused (and reset) across queries.
+ */
+engineReport runNameSearch(const imdb& db, const vector<pair<int, int> >& pairs)
+{
+  engineReport report = engineReport();
+  vector<pair<string, string> > names;
+  for (size_t i = 0; i < pairs.size(); i++) {
+    names.push_back(make_pair(db.getActorName(pairs[i].first), db.getActorName(pairs[i].second)));
+  }
+
+  queryArena arena;
+  const queryOptions unlimited;
+  queryStatus status;
+  const size_t heapBefore = heapAllocations.load();
+  const double start = now();
+  for (size_t i = 0; i < names.size(); i++) {
+    const double began = now();
+    if (generateShortestPath(db, names[i].first, names[i].second, unlimited, status, arena).getLength() > 0) {
+      report.found++;
+    }
+    report.latencies.push_back(now() - began);
+    report.arenaAllocations += arena.getAllocationCount();
+    report.arenaPeakBytes = max(report.arenaPeakBytes, arena.getBytesInUse());
+    arena.reset();
+  }
+  report.seconds = now() - start;
+  report.heapAllocations = heapAllocations.load() - heapBefore;
+  return report;
+}
+
+/**
+ * Function: runParallelSearch
+ * ---------------------------
+ * Times graphSearch over the compressed graph with several workers taking
+ * pairs from a shared counter.  Workers are pinned round robin to the NUMA
+ * nodes if topology is given, and each traverses its own node's replica if
+ * replicas is given too; otherwise they all traverse graph.
+ */
+engineReport runParallelSearch(const compactGraph& graph, const numaTopology *topology,
+                               const compactGraphReplicas *replicas, const vector<pair<int, int> >& pairs,
+                               const int threads)
+{
+  engineReport report = engineReport();
+  atomic<size_t> nextPair(0);
+  atomic<int> found(0);
+  vector<vector<double> > latencies(threads);
+  vector<thread> workers;
+  const size_t heapBefore = heapAllocations.load();
+  const double start = now();
+  for (int w = 0; w < threads; w++) {
+    workers.push_back(thread([&, w]() {
+      const int node = topology == NULL ? 0 : w % topology->getNodeCount();
+      if (topology != NULL) topology->pinCurrentThread(node);
+      graphSearch<compactGraph> search(replicas == NULL ? graph : replicas->getLocal(node));
+      vector<int> hops;
+      for (size_t i = nextPair++; i < pairs.size(); i = nextPair++) {
+        const double began = now();
+        if (search.shortestPath(pairs[i].first, pairs[i].second, kMaxDepth, hops)) found++;
+        latencies[w].push_back(now() - began);
+      }
+    }));
+  }
+  for (int w = 0; w < threads; w++) {
+    workers[w].join();
+    report.latencies.insert(report.latencies.end(), latencies[w].begin(), latencies[w].end());
+  }
+  report.seconds = now() - start;
+  report.found = found;
+  report.heapAllocations = heapAllocations.load() - heapBefore;
+  return report;
+}
+
+/**
+ * Function: skewQueries
+ * ---------------------
+ * A stream of queries over the pairs as lopsided as real traffic: the ith
+ * pair is asked for in proportion to 1 / i (Zipf's law), each time in a
+ * random direction.
+ */
+vector<pair<int, int> > skewQueries(const vector<pair<int, int> >& pairs, const int count, uint64_t seed)
+{
+  vector<double> cumulative;
+  double total = 0;
+  for (size_t i = 0; i < pairs.size(); i++) cumulative.push_back(total += 1.0 / (i + 1));
+  vector<pair<int, int> > queries;
+  while ((int) queries.size() < count) {
+    const double drawn = total * (splitMix(seed) >> 11) / double(1ULL << 53);
+    const size_t i = min(pairs.size() - 1, size_t(lower_bound(cumulative.begin(), cumulative.end(), drawn) - cumulative.begin()));
+    const bool flip = splitMix(seed) & 1;
+    queries.push_back(flip ? make_pair(pairs[i].second, pairs[i].first) : pairs[i]);
+  }
+  return queries;
+}
+
+/**
+ * Function: runCachedSearch
+ * -------------------------
+ * runIdSearch with a pathCache in front of the search.
+ */
+template <typename Graph>
+engineReport runCachedSearch(const Graph& graph, const imdb& db, const vector<pair<int, int> >& queries,
+                             pathCache& cache)
+{
+  engineReport report = engineReport();
+  graphSearch<Graph> search(graph);
+  vector<int> hops;
+  bool found;
+  const size_t heapBefore = heapAllocations.load();
+  const double start = now();
+  for (size_t i = 0; i < queries.size(); i++) {
+    const double began = now();
+    const int source = queries[i].first, target = queries[i].second;
+    if (!cache.lookup(source, target, found, hops)) {
+      found = search.shortestPath(source, target, kMaxDepth, hops);
+      cache.insert(source, target, found, hops);
+    }
+    if (found) {
+      report.found++;
+      makePath(db, source, hops);
+    }
+    report.latencies.push_back(now() - began);
+  }
+  report.seconds = now() - start;
+  report.heapAllocations = heapAllocations.load() - heapBefore;
+  return report;
+}
+
+/**
+ * Function: timeLookups
+ * ---------------------
+ * Times name to id lookups of random actors and movies (one in sixteen of
+ * them misspelled, so misses are timed too): getActorId/getMovieId one at a
+ * time, then getActorIds/getMovieIds at several depths of interleaving,
+ * checking each depth's ids against the serial ones.
+ */
+void timeLookups(const imdb& db, const int count, uint64_t seed)
+{
+  vector<string> players;
+  vector<film> movies;
+  for (int i = 0; i < count; i++) {
+    players.push_back(db.getActorName(1 + splitMix(seed) % db.getActorCount()));
+    movies.push_back(db.getFilm(1 + splitMix(seed) % db.getMovieCount()));
+    if (i % 16 == 15) {
+      players.back() += " (?)";
+      movies.back().title += " (?)";
+    }
+  }
+
+  vector<int> actorIds, movieIds;
+  const size_t heapBefore = heapAllocations.load();
+  double start = now();
+  for (int i = 0; i < count; i++) actorIds.push_back(db.getActorId(players[i]));
+  const double actorSeconds = now() - start;
+  start = now();
+  for (int i = 0; i < count; i++) movieIds.push_back(db.getMovieId(movies[i]));
+  const double movieSeconds = now() - start;
+  const size_t heapSerial = heapAllocations.load() - heapBefore;
+
+  cout << endl << count << " actor and " << count << " movie name lookups" << endl;
+  cout << "lookup      depth  ns/actor  ns/movie   speedup  heap/lookup  agrees" << endl;
+  cout << setw(11) << left << "serial" << right << setw(6) << 1 << setw(10) << setprecision(0) << 1e9 * actorSeconds / count
+       << setw(10) << 1e9 * movieSeconds / count << setw(10) << setprecision(2) << 1.0
+       << setw(13) << setprecision(1) << heapSerial / (2.0 * count) << endl;
+
+  const int depths[] = { 1, 4, 8, 16, 32, 64 };
+  for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+    vector<int> interleavedActors, interleavedMovies;
+    const size_t heapStart = heapAllocations.load();
+    start = now();
+    db.getActorIds(players, interleavedActors, depths[d]);
+    const double actors = now() - start;
+    start = now();
+    db.getMovieIds(movies, interleavedMovies, depths[d]);
+    const double films = now() - start;
+    const size_t heap = heapAllocations.load() - heapStart;
+    cout << setw(11) << left << "interleaved" << right << setw(6) << depths[d]
+         << setw(10) << setprecision(0) << 1e9 * actors / count << setw(10) << 1e9 * films / count
+         << setw(10) << setprecision(2) << (actorSeconds + movieSeconds) / (actors + films)
+         << setw(13) << setprecision(1) << heap / (2.0 * count)
+         << setw(8) << (interleavedActors == actorIds && interleavedMovies == movieIds ? "yes" : "NO") << endl;
+  }
+}
+
+double percentile(vector<double> latencies, const double fraction)
+{
+  sort(latencies.begin(), latencies.end());
+  return latencies[min(latencies.size() - 1, size_t(fraction * latencies.size()))];
+}
+
+void printReport(const string& engine, const engineReport& report, const bool usesArena)
+{
+  const double queries = report.latencies.size();
+  cout << setw(9) << left << engine << right
+       << setw(7) << report.found
+       << setw(11) << setprecision(1) << queries / report.seconds
+       << setw(10) << setprecision(3) << 1e3 * percentile(report.latencies, 0.5)
+       << setw(10) << 1e3 * percentile(report.latencies, 0.99)
+       << setw(12) << setprecision(1) << report.heapAllocations / queries;
+  if (usesArena) {
+    cout << setw(12) << report.arenaAllocations / queries
+         << setw(11) << setprecision(2) << report.arenaPeakBytes / 1048576.0;
+  }
+  cout << endl;
+}
+
+}
+
+/**
+ * Times the shortest path engines on the same random pairs of actors and
+ * reports throughput, latency, and the heap (and arena) allocations each
+ * query makes.  The compressed graph engine only runs if graph.vbyte exists.
+ * With --threads, the compressed graph engine is also run on that many
+ * workers in each NUMA placement: unpinned workers sharing the mapped file,
+ * workers pinned to nodes sharing it, and pinned workers each reading their
+ * node's replica of it.  With --in-memory, the imdb engines run over data
+ * files loaded into huge page backed memory rather than mapped ones.  With
+ * --cache, the id engine also answers a skewed stream of ten queries per
+ * pair, without and then with a path cache of that many MiB.  With
+ * --lookups, that many actor and movie names are also looked up one at a
+ * time and then interleaved as coroutines (see imdb::getActorIds).
+ *
+ * Usage: path-bench [--pairs n] [--seed n] [--engine names|ids|compact] [--threads n] [--in-memory]
+ *                   [--cache MiB] [--lookups n] <data-files-path>
+ */
+
+int main(int argc, char *argv[])
+{
+  int pairCount = 200, threads = 0, cacheMiB = 0, lookups = 0;
+  uint64_t seed = 1;
+  string engine, directory;
+  bool understood = true, inMemory = false;
+  for (int i = 1; i < argc && understood; i++) {
+    const string arg = argv[i];
+    if (arg == "--pairs" && i + 1 < argc) pairCount = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if (arg == "--engine" && i + 1 < argc) engine = argv[++i];
+    else if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (arg == "--in-memory") inMemory = true;
+    else if (arg == "--cache" && i + 1 < argc) cacheMiB = atoi(argv[++i]);
+    else if (arg == "--lookups" && i + 1 < argc) lookups = atoi(argv[++i]);
+    else if (arg[0] != '-' && directory.empty()) directory = arg;
+    else understood = false;
+  }
+  if (!understood || directory.empty() || pairCount <= 0 || threads < 0 || cacheMiB < 0 || lookups < 0 ||
+      !(engine.empty() || engine == "names" || engine == "ids" || engine == "compact")) {
+    cerr << "Usage: path-bench [--pairs n] [--seed n] [--engine names|ids|compact] [--threads n] [--in-memory] "
+         << "[--cache MiB] [--lookups n] <data-files-path>" << endl;
+    return 1;
+  }
+
+  const double loadStart = now();
+  imdb db(directory, inMemory ? imdb::kInMemory : imdb::kFileMapped);
+  if (!db.good()) {
+    cerr << "Data directory not found! Aborting..." << endl;
+    return 1;
+  }
+  db.prefault();
+  const double loadSeconds = now() - loadStart;
+  const vector<pair<int, int> > pairs = pickPairs(db, pairCount, seed);
+  compactGraph graph(directory);
+
+  cout << pairs.size() << " pairs, seed " << seed << endl;
+  cout << fixed << setprecision(1) << (inMemory ? "loaded " : "mapped and prefaulted ") << db.getDataBytes() / 1048576.0
+       << " MiB in " << 1e3 * loadSeconds << " ms, " << db.getHugePageBytes() / 1048576.0 << " MiB on 2 MiB pages" << endl;
+  cout << fixed << "engine     found  queries/s   p50 ms    p99 ms  heap/query arena/query  arena MiB" << endl;
+  if (engine.empty() || engine == "ids") printReport("ids", runIdSearch(db, db, pairs), false);
+  if ((engine.empty() || engine == "compact") && graph.good()) {
+    printReport("compact", runIdSearch(graph, db, pairs), false);
+  }
+  if (engine.empty() || engine == "names") printReport("names", runNameSearch(db, pairs), true);
+
+  if (cacheMiB > 0 && (engine.empty() || engine == "ids")) {
+    const vector<pair<int, int> > queries = skewQueries(pairs, 10 * pairs.size(), seed);
+    pathCache cache(size_t(cacheMiB) << 20);
+    cout << endl << "id engine, " << queries.size() << " skewed queries" << endl;
+    cout << "cache      found  queries/s   p50 ms    p99 ms  heap/query" << endl;
+    printReport("none", runIdSearch(db, db, queries), false);
+    printReport("path", runCachedSearch(db, db, queries, cache), false);
+    const pathCache::statistics cached = cache.getStatistics();
+    cout << cached.hits << " hits, " << cached.misses << " misses, " << cached.evictions << " evictions, "
+         << cached.entries << " pairs in " << setprecision(1) << cached.bytes / 1024.0 << " KiB" << endl;
+  }
+
+  if (threads > 0 && (engine.empty() || engine == "compact") && graph.good()) {
+    const numaTopology topology;
+    const double began = now();
+    const compactGraphReplicas replicas(graph, topology);
+    const double copySeconds = now() - began;
+    if (!replicas.good()) {
+      cerr << "Couldn't replicate the graph on every node." << endl;
+      return 1;
+    }
+    cout << endl << "compact engine, " << threads << " threads, " << topology.getNodeCount() << " NUMA node(s)";
+    if (topology.getNodeCount() > 1) {
+      cout << ", " << setprecision(1) << 1e3 * copySeconds << " ms to replicate";
+    } else {
+      cout << " (pinned and replicated run like shared)";
+    }
+    cout << endl << "placement  found  queries/s   p50 ms    p99 ms  heap/query" << endl;
+    printReport("shared", runParallelSearch(graph, NULL, NULL, pairs, threads), false);
+    printReport("pinned", runParallelSearch(graph, &topology, NULL, pairs, threads), false);
+    printReport("replicas", runParallelSearch(graph, &topology, &replicas, pairs, threads), false);
+  }
+
+  if (lookups > 0) timeLookups(db, lookups, seed);
+  return 0;
+}
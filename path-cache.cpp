@@ -0,0 +1,122 @@
+using namespace std;
+#include <algorithm>
+#include "path-cache.h"
+
+namespace {
+
+// what an entry costs beyond itself and its hops: the list node's links and
+// the index's node and bucket
+const size_t kEntryOverheadBytes = 64;
+
+}
+
+pathCache::pathCache(const size_t budgetBytes) : shardBudget(budgetBytes / kShardCount)
+{
+    for (int i = 0; i < kShardCount; i++) {
+        shards[i].bytes = 0;
+        shards[i].hits = shards[i].misses = shards[i].evictions = 0;
+    }
+}
+
+bool pathCache::lookup(const int source, const int target, bool& found, vector<int>& hops)
+{
+    hops.clear();
+    const uint64_t key = makeKey(source, target);
+    shard& home = shardFor(key);
+    lock_guard<mutex> hold(home.lock);
+    unordered_map<uint64_t, recencyList::iterator>::iterator cached = home.index.find(key);
+    if (cached == home.index.end()) {
+        home.misses++;
+        return false;
+    }
+
+    home.hits++;
+    home.entries.splice(home.entries.begin(), home.entries, cached->second);
+    const entry& hit = *cached->second;
+    found = hit.found;
+    if (hit.source == source) hops = hit.hops;
+    else reverseHops(hit.source, hit.hops, hops);
+    return true;
+}
+
+void pathCache::insert(const int source, const int target, const bool found, const vector<int>& hops)
+{
+    entry fresh;
+    fresh.key = makeKey(source, target);
+    fresh.source = source;
+    fresh.found = found;
+    if (found) fresh.hops = hops;
+    const size_t bytes = entryBytes(fresh);
+    if (bytes > shardBudget) return;
+
+    shard& home = shardFor(fresh.key);
+    lock_guard<mutex> hold(home.lock);
+    unordered_map<uint64_t, recencyList::iterator>::iterator cached = home.index.find(fresh.key);
+    if (cached != home.index.end()) {
+        home.bytes -= entryBytes(*cached->second);
+        home.entries.erase(cached->second);
+        home.index.erase(cached);
+    }
+    while (home.bytes + bytes > shardBudget) {
+        home.bytes -= entryBytes(home.entries.back());
+        home.index.erase(home.entries.back().key);
+        home.entries.pop_back();
+        home.evictions++;
+    }
+    home.entries.push_front(move(fresh));
+    home.index[home.entries.front().key] = home.entries.begin();
+    home.bytes += bytes;
+}
+
+void pathCache::clear()
+{
+    for (int i = 0; i < kShardCount; i++) {
+        lock_guard<mutex> hold(shards[i].lock);
+        shards[i].entries.clear();
+        shards[i].index.clear();
+        shards[i].bytes = 0;
+    }
+}
+
+pathCache::statistics pathCache::getStatistics() const
+{
+    statistics totals = statistics();
+    for (int i = 0; i < kShardCount; i++) {
+        lock_guard<mutex> hold(shards[i].lock);
+        totals.hits += shards[i].hits;
+        totals.misses += shards[i].misses;
+        totals.evictions += shards[i].evictions;
+        totals.entries += shards[i].index.size();
+        totals.bytes += shards[i].bytes;
+    }
+    return totals;
+}
+
+void pathCache::reverseHops(const int source, const vector<int>& hops, vector<int>& reversed)
+{
+    // hops run movie, actor, movie, actor, ..., target; walking back, each
+    // movie is followed by the actor before it, and the first by source
+    reversed.clear();
+    for (size_t i = hops.size(); i >= 2; i -= 2) {
+        reversed.push_back(hops[i - 2]);
+        reversed.push_back(i >= 4 ? hops[i - 3] : source);
+    }
+}
+
+uint64_t pathCache::makeKey(const int source, const int target)
+{
+    const uint32_t low = min(source, target), high = max(source, target);
+    return (uint64_t(high) << 32) | low;
+}
+
+pathCache::shard& pathCache::shardFor(const uint64_t key)
+{
+    // the ids of a pair are correlated, so mix them before picking a shard
+    uint64_t mixed = key * 0x9E3779B97F4A7C15ULL;
+    return shards[(mixed >> 32) % kShardCount];
+}
+
+size_t pathCache::entryBytes(const entry& cached)
+{
+    return sizeof(entry) + cached.hops.size() * sizeof(int) + kEntryOverheadBytes;
+}
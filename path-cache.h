@@ -0,0 +1,122 @@
+#ifndef __path_cache__
+#define __path_cache__
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: pathCache
+ * ----------------
+ * Remembers the outcome of shortest path searches, keyed by the unordered
+ * pair of actor ids, so a pair asked for again (in either direction) is
+ * answered without searching.  Paths are kept as the hops graphSearch
+ * produces (alternating movie and actor ids), and a path found from A to B
+ * is reversed to answer B to A.  Searches that found nothing are
+ * remembered too.
+ *
+ * The cache is bounded by a byte budget and evicts the least recently used
+ * pairs first.  It is split into shards, each with its own lock, budget
+ * and recency list, so threads sharing a cache only contend when they
+ * happen to want the same shard.
+ *
+ * Entries are only as good as the data they were found in: clear the
+ * cache when the data files change.
+ */
+
+class pathCache {
+
+ public:
+
+  /**
+   * Constructor: pathCache
+   * ----------------------
+   * @param budgetBytes roughly the most memory the entries may take
+   */
+  pathCache(const size_t budgetBytes);
+
+  /**
+   * Method: lookup
+   * --------------
+   * @param source, target the ids of the actors being connected
+   * @param found set to whether the search that was cached found a path
+   * @param hops cleared and, if a path was found, filled with it as
+   *             graphSearch::shortestPath would, from source to target
+   * @return true if and only if the pair was cached
+   */
+  bool lookup(const int source, const int target, bool& found, vector<int>& hops);
+
+  /**
+   * Method: insert
+   * --------------
+   * Caches the outcome of a search, replacing whatever was cached for the
+   * pair, and evicts older pairs as needed to stay within budget.  Only
+   * complete searches belong here, never ones that were cut short.
+   *
+   * @param hops the path from source to target, or empty if found is false
+   */
+  void insert(const int source, const int target, const bool found, const vector<int>& hops);
+
+  /**
+   * Method: clear
+   * -------------
+   * Forgets every entry (the counters carry on).
+   */
+  void clear();
+
+  /**
+   * Struct: statistics
+   * ------------------
+   * Totals across the shards since the cache was made.
+   */
+  struct statistics {
+    uint64_t hits, misses, evictions;
+    size_t entries, bytes;
+  };
+
+  statistics getStatistics() const;
+
+  /**
+   * Static Method: reverseHops
+   * --------------------------
+   * Turns hops from source to some target into hops from that target back
+   * to source.
+   */
+  static void reverseHops(const int source, const vector<int>& hops, vector<int>& reversed);
+
+ private:
+  struct entry {
+    uint64_t key;
+    int source;        // the direction hops run in, from source to the other actor of the key
+    bool found;
+    vector<int> hops;
+  };
+
+  typedef list<entry> recencyList;
+
+  struct shard {
+    mutable mutex lock;
+    recencyList entries; // most recently used first
+    unordered_map<uint64_t, recencyList::iterator> index;
+    size_t bytes;
+    uint64_t hits, misses, evictions;
+  };
+
+  static const int kShardCount = 16;
+
+  size_t shardBudget;
+  shard shards[kShardCount];
+
+  static uint64_t makeKey(const int source, const int target);
+  shard& shardFor(const uint64_t key);
+  static size_t entryBytes(const entry& cached);
+
+  pathCache(const pathCache& original);
+  pathCache& operator=(const pathCache& rhs);
+};
+
+#endif
@@ -0,0 +1,60 @@
+using namespace std;
+#include <algorithm>
+#include "path-count.h"
+
+void pathCount::appendLimbs(const pathCount& count, vector<uint32_t>& limbs)
+{
+    if (!count.limbs.empty()) {
+        limbs = count.limbs;
+        return;
+    }
+    limbs.clear();
+    limbs.push_back(uint32_t(count.small));
+    limbs.push_back(uint32_t(count.small >> 32));
+}
+
+void pathCount::addLong(const pathCount& other)
+{
+    vector<uint32_t> mine, theirs;
+    appendLimbs(*this, mine);
+    appendLimbs(other, theirs);
+    if (mine.size() < theirs.size()) mine.resize(theirs.size(), 0);
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < mine.size(); i++) {
+        carry += uint64_t(mine[i]) + (i < theirs.size() ? theirs[i] : 0);
+        mine[i] = uint32_t(carry);
+        carry >>= 32;
+    }
+    if (carry != 0) mine.push_back(uint32_t(carry));
+    limbs.swap(mine);
+}
+
+string pathCount::toString() const
+{
+    if (limbs.empty()) return to_string(small);
+
+    // peel off nine decimal digits at a time by long division
+    vector<uint32_t> rest = limbs;
+    string digits;
+    while (!rest.empty()) {
+        uint64_t remainder = 0;
+        for (size_t i = rest.size(); i-- > 0;) {
+            const uint64_t part = (remainder << 32) | rest[i];
+            rest[i] = uint32_t(part / 1000000000);
+            remainder = part % 1000000000;
+        }
+        while (!rest.empty() && rest.back() == 0) rest.pop_back();
+        for (int i = 0; i < 9 && (remainder != 0 || !rest.empty()); i++) {
+            digits.push_back(char('0' + remainder % 10));
+            remainder /= 10;
+        }
+    }
+    reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+ostream& operator<<(ostream& os, const pathCount& count)
+{
+    return os << count.toString();
+}
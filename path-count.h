@@ -0,0 +1,57 @@
+#ifndef __path_count__
+#define __path_count__
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: pathCount
+ * ----------------
+ * A count of paths, which only ever grows by adding other counts.  Between
+ * two well connected actors the number of shortest paths overflows 64 bits
+ * quickly, so a count that no longer fits in one word carries on as an
+ * arbitrarily long number in 32-bit limbs.  Counts that do fit (nearly all
+ * of them) never allocate.
+ */
+
+class pathCount {
+
+  friend ostream& operator<<(ostream& os, const pathCount& count);
+
+ public:
+  pathCount(const uint64_t count = 0) : small(count) {}
+
+  /**
+   * Method: add
+   * -----------
+   * Adds another count to this one.
+   */
+  void add(const pathCount& other)
+  {
+    uint64_t sum;
+    if (limbs.empty() && other.limbs.empty() && !__builtin_add_overflow(small, other.small, &sum)) {
+      small = sum;
+      return;
+    }
+    addLong(other);
+  }
+
+  /**
+   * Method: toString
+   * ----------------
+   * @return the count in decimal
+   */
+  string toString() const;
+
+ private:
+  uint64_t small;           // the whole count, while limbs is empty
+  vector<uint32_t> limbs;   // otherwise the count, least significant limb first
+
+  void addLong(const pathCount& other);
+  static void appendLimbs(const pathCount& count, vector<uint32_t>& limbs);
+};
+
+#endif
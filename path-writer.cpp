@@ -0,0 +1,226 @@
+using namespace std;
+#include <unistd.h>
+#include <errno.h>
+#include <charconv>
+#include "path-writer.h"
+
+namespace {
+
+const char kHexDigits[] = "0123456789abcdef";
+
+/**
+ * Function: utf8SequenceLength
+ * ----------------------------
+ * @return the length of the well-formed UTF-8 sequence starting at text[i]
+ *         (no overlong forms or surrogates), or 0 if there isn't one
+ */
+size_t utf8SequenceLength(const string& text, const size_t i)
+{
+    const unsigned char lead = text[i];
+    size_t length;
+    unsigned char low = 0x80, high = 0xbf;  // the range of the second byte
+    if (lead >= 0xc2 && lead <= 0xdf) length = 2;
+    else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) low = 0xa0;
+        if (lead == 0xed) high = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) low = 0x90;
+        if (lead == 0xf4) high = 0x8f;
+    } else return 0;
+    if (i + length > text.size()) return 0;
+    for (size_t k = 1; k < length; k++) {
+        const unsigned char next = text[i + k];
+        if (next < (k == 1 ? low : 0x80) || next > (k == 1 ? high : 0xbf)) return 0;
+    }
+    return length;
+}
+
+// the link columns of a TSV row, named once in the header
+const char kTsvHeader[] = "source_id\tsource\ttarget_id\ttarget\tlength\tmovie_id\ttitle\tyear\tactor_id\tactor\n";
+
+}
+
+pathWriter::pathWriter(const int fd, const format how, const size_t bufferBytes) :
+    fd(fd), how(how), bufferBytes(bufferBytes), failed(false), bytesWritten(0), writes(0)
+{
+    // a record is appended whole before the buffer is checked, so leave room for one past the limit
+    buffer.reserve(bufferBytes + 4096);
+}
+
+pathWriter::~pathWriter()
+{
+    flush();
+}
+
+void pathWriter::writeHeader()
+{
+    if (how == kTsv) buffer += kTsvHeader;
+}
+
+void pathWriter::write(const imdb& db, const int source, const int target, const bool found, const vector<int>& hops)
+{
+    const long long length = found ? (long long) hops.size() / 2 : -1;
+    if (how == kJsonLines) {
+        buffer += "{\"source\":";
+        appendActor(db, source);
+        buffer += ",\"target\":";
+        appendActor(db, target);
+        buffer += found ? ",\"found\":true,\"length\":" : ",\"found\":false,\"length\":";
+        appendNumber(length);
+        buffer += ",\"hops\":[";
+        for (size_t i = 0; found && i + 1 < hops.size(); i += 2) {
+            buffer += i == 0 ? "{\"movie\":" : ",{\"movie\":";
+            appendMovie(db, hops[i]);
+            buffer += ",\"actor\":";
+            appendActor(db, hops[i + 1]);
+            buffer += '}';
+        }
+        buffer += "]}\n";
+    } else {
+        appendActor(db, source);
+        buffer += '\t';
+        appendActor(db, target);
+        buffer += '\t';
+        appendNumber(length);
+        for (size_t i = 0; found && i + 1 < hops.size(); i += 2) {
+            buffer += '\t';
+            appendMovie(db, hops[i]);
+            buffer += '\t';
+            appendActor(db, hops[i + 1]);
+        }
+        buffer += '\n';
+    }
+    endRecord();
+}
+
+void pathWriter::write(const imdb& db, const string& source, const string& target, const path& p)
+{
+    hops.clear();
+    for (int i = 0; i < p.getLength(); i++) {
+        hops.push_back(db.getMovieId(p.getMovie(i)));
+        hops.push_back(db.getActorId(p.getPlayer(i + 1)));
+    }
+    write(db, db.getActorId(source), db.getActorId(target), p.getLength() > 0, hops);
+}
+
+bool pathWriter::flush()
+{
+    const char *next = buffer.data();
+    size_t left = buffer.size();
+    while (left > 0 && !failed) {
+        const ssize_t written = ::write(fd, next, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            failed = true;
+            break;
+        }
+        writes++;
+        bytesWritten += written;
+        next += written;
+        left -= written;
+    }
+    buffer.clear();
+    return !failed;
+}
+
+void pathWriter::appendNumber(const long long value)
+{
+    char digits[24];
+    buffer.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+/**
+ * Method: appendText
+ * ------------------
+ * Appends text escaped for the format, copying the runs that need no
+ * escaping whole.  JSON gets its two-character escapes for the common
+ * cases and \u00XX for the other control characters.
+ *
+ * Both formats come out as UTF-8.  Data files written by imdb-import are
+ * UTF-8 already, and their sequences are copied as they are; the original
+ * data files are Latin-1, so any byte that doesn't start a well-formed
+ * sequence is taken to be a Latin-1 character and re-encoded (as \u00XX
+ * in JSON).
+ */
+void pathWriter::appendText(const string& text)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ) {
+        const unsigned char c = text[i];
+        if (c >= 0x80) {
+            const size_t length = utf8SequenceLength(text, i);
+            if (length > 0) {
+                i += length;
+                continue;
+            }
+        } else if (c >= 0x20 && c != '\\' && (how != kJsonLines || c != '"')) {
+            i++;
+            continue;
+        }
+
+        buffer.append(text, start, i - start);
+        start = ++i;
+        if (c >= 0x80 && how == kTsv) {
+            buffer += (char) (0xc0 | c >> 6);
+            buffer += (char) (0x80 | (c & 0x3f));
+            continue;
+        }
+        buffer += '\\';
+        if (c == '\\' || c == '"') buffer += c;
+        else if (c == '\t') buffer += 't';
+        else if (c == '\n') buffer += 'n';
+        else if (c == '\r') buffer += 'r';
+        else if (how == kJsonLines) {
+            buffer += "u00";
+            buffer += kHexDigits[c >> 4];
+            buffer += kHexDigits[c & 0xf];
+        } else {
+            // TSV has no escape for the other control characters, and they're harmless in a field
+            buffer.back() = c;
+        }
+    }
+    buffer.append(text, start, text.size() - start);
+}
+
+void pathWriter::appendActor(const imdb& db, const int actorId)
+{
+    const string name = actorId > 0 ? db.getActorName(actorId) : string();
+    if (how == kJsonLines) {
+        buffer += "{\"id\":";
+        appendNumber(actorId);
+        buffer += ",\"name\":\"";
+        appendText(name);
+        buffer += "\"}";
+    } else {
+        appendNumber(actorId);
+        buffer += '\t';
+        appendText(name);
+    }
+}
+
+void pathWriter::appendMovie(const imdb& db, const int movieId)
+{
+    const film movie = db.getFilm(movieId);
+    if (how == kJsonLines) {
+        buffer += "{\"id\":";
+        appendNumber(movieId);
+        buffer += ",\"title\":\"";
+        appendText(movie.title);
+        buffer += "\",\"year\":";
+        appendNumber(movie.year);
+        buffer += '}';
+    } else {
+        appendNumber(movieId);
+        buffer += '\t';
+        appendText(movie.title);
+        buffer += '\t';
+        appendNumber(movie.year);
+    }
+}
+
+void pathWriter::endRecord()
+{
+    if (buffer.size() >= bufferBytes) flush();
+}
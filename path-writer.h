@@ -0,0 +1,119 @@
+#ifndef __path_writer__
+#define __path_writer__
+
+#include "imdb.h"
+#include "path.h"
+#include <string>
+#include <vector>
+#include <stddef.h>
+using namespace std;
+
+/**
+ * Class: pathWriter
+ * -----------------
+ * Writes shortest path results for programs rather than people, one
+ * record per query, with both the ids and the names of everything on the
+ * path.  Records are built in one buffer that is reused throughout and
+ * handed to write(2) only when it fills (or on flush), so streaming
+ * millions of results costs a system call per megabyte or so rather than
+ * one per line, as endl does.
+ *
+ * JSON Lines records look like
+ *
+ *     {"source":{"id":1,"name":"..."},"target":{"id":2,"name":"..."},"found":true,"length":1,
+ *      "hops":[{"movie":{"id":3,"title":"...","year":1999},"actor":{"id":2,"name":"..."}}]}
+ *
+ * all on one line, with a length of -1 and no hops if there is no path.
+ * TSV rows are the source's id and name, the target's id and name, the
+ * length, then five columns per link: movie id, title, year, actor id,
+ * actor.  Text is escaped as each format requires (\t, \n, \r and \\ in
+ * TSV), and always written as UTF-8: bytes of the data files that aren't
+ * UTF-8 are taken to be Latin-1, as the original data files are.
+ */
+
+class pathWriter {
+
+ public:
+  enum format { kJsonLines, kTsv };
+
+  /**
+   * Constructor: pathWriter
+   * -----------------------
+   * @param fd where the records go; the writer doesn't close it
+   * @param bufferBytes how much to collect before writing it out
+   */
+  pathWriter(const int fd, const format how, const size_t bufferBytes = 1 << 20);
+
+  /**
+   * Destructor: ~pathWriter
+   * -----------------------
+   * Flushes whatever is still buffered.
+   */
+  ~pathWriter();
+
+  /**
+   * Method: writeHeader
+   * -------------------
+   * Writes the TSV column names, with the link columns once; nothing for
+   * JSON Lines.
+   */
+  void writeHeader();
+
+  /**
+   * Method: write
+   * -------------
+   * Writes one query's result as graphSearch::shortestPath produces it.
+   *
+   * @param source, target the ids of the actors asked about (0 for a
+   *                       name that wasn't found, which is written empty)
+   * @param hops alternating movie and actor ids, ending with target
+   */
+  void write(const imdb& db, const int source, const int target, const bool found, const vector<int>& hops);
+
+  /**
+   * Method: write
+   * -------------
+   * Writes a path found by name, looking up the ids; an empty path is a
+   * query with no path.
+   */
+  void write(const imdb& db, const string& source, const string& target, const path& p);
+
+  /**
+   * Method: flush
+   * -------------
+   * Writes out everything buffered.
+   *
+   * @return false if the descriptor refused some of it
+   */
+  bool flush();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if every write to the descriptor so far succeeded.
+   */
+  bool good() const { return !failed; }
+
+  size_t getBytesWritten() const { return bytesWritten; }
+  size_t getWriteCount() const { return writes; }
+
+ private:
+  int fd;
+  format how;
+  size_t bufferBytes;
+  string buffer;
+  bool failed;
+  size_t bytesWritten, writes;
+  vector<int> hops;     // reused by the by-name write
+
+  void appendNumber(const long long value);
+  void appendText(const string& text);
+  void appendActor(const imdb& db, const int actorId);
+  void appendMovie(const imdb& db, const int movieId);
+  void endRecord();
+
+  pathWriter(const pathWriter& original);
+  pathWriter& operator=(const pathWriter& rhs);
+};
+
+#endif
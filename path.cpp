@@ -49,6 +49,22 @@ const string& path::getLastPlayer() const
   return links.back().player;
 }
 
+/**
+ * Player 0 is the start player; the rest are
+ * found at the end of each connection.
+ */
+
+const string& path::getPlayer(int i) const
+{
+  if (i == 0) return startPlayer;
+  return links[i - 1].player;
+}
+
+const film& path::getMovie(int i) const
+{
+  return links[i].movie;
+}
+
 /**
  * NB: Our implementation uses the path output operator
  * to produce its output. You should probably leave it well
@@ -57,12 +73,12 @@ const string& path::getLastPlayer() const
  */
 ostream& operator<<(ostream& os, const path& p)
 {
-  if (p.links.size() == 0) return os << string("[Empty path]") << endl;
+  if (p.links.size() == 0) return os << string("[Empty path]") << '\n';
   
   os << "\t" << p.startPlayer << " was in ";
   for (int i = 0; i < (int) p.links.size(); i++) {
     os << "\"" << p.links[i].movie.title << "\" (" << p.links[i].movie.year << ") with " 
-       << p.links[i].player << "." << endl;
+       << p.links[i].player << "." << '\n';
     if (i + 1 == (int) p.links.size()) break;
     os << "\t" << p.links[i].player << " was in ";
   }
@@ -105,6 +105,20 @@ class path {
    */
   
   const string& getLastPlayer() const;
+
+  /**
+   * Methods: getPlayer
+   *          getMovie
+   * ------------------
+   * Walks the path one connection at a time: player 0 is the
+   * first player, and movie i (counting from 0) is the one
+   * shared by players i and i + 1.
+   *
+   * @param i a position along the path, in the range [0, getLength()]
+   *          for players and [0, getLength()) for movies.
+   */
+  const string& getPlayer(int i) const;
+  const film& getMovie(int i) const;
   
  private:
   // private struct definition... no one else uses it, so I define it internally
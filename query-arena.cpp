@@ -0,0 +1,61 @@
+using namespace std;
+#include <string.h>
+#include <algorithm>
+#include "query-arena.h"
+
+queryArena::queryArena(const size_t blockBytes) :
+    blockBytes(blockBytes), current(0), usedBefore(0), allocations(0), reserved(0)
+{
+    const block first = { new char[blockBytes], blockBytes };
+    blocks.push_back(first);
+    reserved = blockBytes;
+    cursor = first.memory;
+    limit = first.memory + first.size;
+}
+
+queryArena::~queryArena()
+{
+    for (size_t i = 0; i < blocks.size(); i++) delete[] blocks[i].memory;
+}
+
+string_view queryArena::copy(const string_view text)
+{
+    char *memory = static_cast<char *>(allocate(text.size(), 1));
+    memcpy(memory, text.data(), text.size());
+    return string_view(memory, text.size());
+}
+
+void queryArena::reset()
+{
+    current = 0;
+    cursor = blocks[0].memory;
+    limit = blocks[0].memory + blocks[0].size;
+    usedBefore = 0;
+    allocations = 0;
+}
+
+/**
+ * Method: allocateSlow
+ * --------------------
+ * Moves on to the next block that can take the request, reusing the blocks
+ * earlier queries left behind before asking the heap for another.
+ */
+void *queryArena::allocateSlow(const size_t bytes, const size_t alignment)
+{
+    usedBefore += cursor - blocks[current].memory;
+    while (current + 1 < blocks.size()) {
+        current++;
+        cursor = blocks[current].memory;
+        limit = cursor + blocks[current].size;
+        if (bytes + alignment <= blocks[current].size) return allocate(bytes, alignment);
+    }
+
+    const size_t size = max(blockBytes, bytes + alignment);
+    const block fresh = { new char[size], size };
+    blocks.push_back(fresh);
+    reserved += size;
+    current = blocks.size() - 1;
+    cursor = fresh.memory;
+    limit = fresh.memory + size;
+    return allocate(bytes, alignment);
+}
@@ -0,0 +1,132 @@
+#ifndef __query_arena__
+#define __query_arena__
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stddef.h>
+using namespace std;
+
+/**
+ * Class: queryArena
+ * -----------------
+ * A bump allocator for everything one query allocates: memory is handed
+ * out from large blocks by advancing a cursor, is never freed piece by
+ * piece, and is all given back at once by reset, which just rewinds the
+ * cursor to the start of the first block.  Blocks stay allocated for the
+ * next query, so a worker that reuses its arena stops touching the heap
+ * once it has seen its largest query.
+ *
+ * An arena belongs to one thread at a time; give each worker its own.
+ */
+
+class queryArena {
+
+ public:
+
+  /**
+   * Constructor: queryArena
+   * -----------------------
+   * @param blockBytes the size of the blocks taken from the heap (bigger
+   *                   requests get a block of their own size)
+   */
+  queryArena(const size_t blockBytes = 1 << 20);
+  ~queryArena();
+
+  /**
+   * Method: allocate
+   * ----------------
+   * @param alignment a power of two
+   * @return bytes of uninitialized memory, valid until the next reset
+   */
+  void *allocate(const size_t bytes, const size_t alignment);
+
+  /**
+   * Method: copy
+   * ------------
+   * Copies text into the arena.
+   *
+   * @return a view of the copy, valid until the next reset
+   */
+  string_view copy(const string_view text);
+
+  /**
+   * Method: reset
+   * -------------
+   * Releases everything allocated since the last reset, in constant time.
+   */
+  void reset();
+
+  /**
+   * Methods: getAllocationCount
+   *          getBytesInUse
+   *          getBytesReserved
+   * -------------------------
+   * Allocations made and bytes handed out since the last reset, and the
+   * bytes held in blocks.
+   */
+  size_t getAllocationCount() const { return allocations; }
+  size_t getBytesInUse() const { return usedBefore + (cursor - blocks[current].memory); }
+  size_t getBytesReserved() const { return reserved; }
+
+ private:
+  struct block {
+    char *memory;
+    size_t size;
+  };
+
+  size_t blockBytes;
+  vector<block> blocks;
+  size_t current;       // the block being carved up
+  char *cursor, *limit; // what's left of it
+  size_t usedBefore;    // bytes in the blocks before current
+  size_t allocations, reserved;
+
+  void *allocateSlow(const size_t bytes, const size_t alignment);
+
+  queryArena(const queryArena& original);
+  queryArena& operator=(const queryArena& rhs);
+};
+
+inline void *queryArena::allocate(const size_t bytes, const size_t alignment)
+{
+  char *start = reinterpret_cast<char *>((reinterpret_cast<size_t>(cursor) + alignment - 1) & ~(alignment - 1));
+  if (start + bytes > limit) return allocateSlow(bytes, alignment);
+  cursor = start + bytes;
+  allocations++;
+  return start;
+}
+
+/**
+ * Class: arenaAllocator
+ * ---------------------
+ * Lets standard containers allocate from a queryArena.  Deallocation does
+ * nothing: the memory comes back when the arena is reset, so containers
+ * using it must not be used (or destroyed after owning anything that
+ * needs destroying) past that.
+ */
+
+template <typename T>
+class arenaAllocator {
+
+ public:
+  typedef T value_type;
+
+  arenaAllocator(queryArena& arena) : arena(&arena) {}
+  template <typename U>
+  arenaAllocator(const arenaAllocator<U>& other) : arena(other.getArena()) {}
+
+  T *allocate(const size_t count) { return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T))); }
+  void deallocate(T *, const size_t) {}
+
+  queryArena *getArena() const { return arena; }
+  template <typename U>
+  bool operator==(const arenaAllocator<U>& rhs) const { return arena == rhs.getArena(); }
+  template <typename U>
+  bool operator!=(const arenaAllocator<U>& rhs) const { return arena != rhs.getArena(); }
+
+ private:
+  queryArena *arena;
+};
+
+#endif
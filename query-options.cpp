@@ -0,0 +1,35 @@
+using namespace std;
+#include "query-options.h"
+
+queryOptions::queryOptions() : hasDeadline(false), token(NULL), memoryBudget(0)
+{
+}
+
+void queryOptions::setTimeout(const int timeoutMillis)
+{
+    setDeadline(clock::now() + chrono::milliseconds(timeoutMillis));
+}
+
+void queryOptions::setDeadline(const clock::time_point when)
+{
+    hasDeadline = true;
+    deadline = when;
+}
+
+void queryOptions::setCancellation(const cancellationToken *cancellation)
+{
+    token = cancellation;
+}
+
+void queryOptions::setMemoryBudget(const size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+queryStatus queryOptions::check(const size_t bytesInUse) const
+{
+    if (token != NULL && token->isCancelled()) return kCancelled;
+    if (memoryBudget != 0 && bytesInUse > memoryBudget) return kOverBudget;
+    if (hasDeadline && clock::now() >= deadline) return kTimedOut;
+    return kSearching;
+}
@@ -0,0 +1,95 @@
+#ifndef __query_options__
+#define __query_options__
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+using namespace std;
+
+/**
+ * Enumerated type: queryStatus
+ * ----------------------------
+ * How a bounded query ended.  kSearching is only ever returned by
+ * queryOptions::check, to say the query may carry on.
+ */
+enum queryStatus { kPathFound, kNoPath, kTimedOut, kCancelled, kOverBudget, kSearching };
+
+/**
+ * Class: cancellationToken
+ * ------------------------
+ * Lets another thread (or a signal handler: cancel is lock free) stop a
+ * query that is already running.  A token can be reset and reused.
+ */
+
+class cancellationToken {
+
+ public:
+  cancellationToken() : cancelled(false) {}
+
+  void cancel() { cancelled.store(true, memory_order_relaxed); }
+  void reset() { cancelled.store(false, memory_order_relaxed); }
+  bool isCancelled() const { return cancelled.load(memory_order_relaxed); }
+
+ private:
+  atomic<bool> cancelled;
+
+  cancellationToken(const cancellationToken& original);
+  cancellationToken& operator=(const cancellationToken& rhs);
+};
+
+/**
+ * Class: queryOptions
+ * -------------------
+ * The limits one query runs under: a wall clock deadline, a cancellation
+ * token and a budget for the memory its frontier and visited records may
+ * grow to.  New options impose no limits at all.  Searches call check
+ * between chunks of work rather than on every node, so the limits cost
+ * next to nothing, and a search can overrun them by one chunk.
+ */
+
+class queryOptions {
+
+ public:
+  typedef chrono::steady_clock clock;
+
+  queryOptions();
+
+  /**
+   * Methods: setTimeout
+   *          setDeadline
+   * --------------------
+   * Stops the query after timeoutMillis from now, or at deadline.
+   */
+  void setTimeout(const int timeoutMillis);
+  void setDeadline(const clock::time_point deadline);
+
+  /**
+   * Method: setCancellation
+   * -----------------------
+   * @param token checked by the query; it must outlive the query, and NULL means none
+   */
+  void setCancellation(const cancellationToken *token);
+
+  /**
+   * Method: setMemoryBudget
+   * -----------------------
+   * @param bytes the most the query's frontier and visited records may take, or 0 for no limit
+   */
+  void setMemoryBudget(const size_t bytes);
+
+  /**
+   * Method: check
+   * -------------
+   * @param bytesInUse what the query's frontier and visited records take right now
+   * @return kSearching if the query may go on, or else why it has to stop
+   */
+  queryStatus check(const size_t bytesInUse) const;
+
+ private:
+  bool hasDeadline;
+  clock::time_point deadline;
+  const cancellationToken *token;
+  size_t memoryBudget;
+};
+
+#endif
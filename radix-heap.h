@@ -0,0 +1,95 @@
+#ifndef __radix_heap__
+#define __radix_heap__
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: radixHeap
+ * ----------------
+ * A monotone priority queue of (key, value) pairs: keys pushed may never be
+ * smaller than the last key popped, which is always the case in Dijkstra's
+ * algorithm.  Bucket i holds the keys whose highest bit differing from the
+ * last popped key is bit i - 1 (bucket 0 holds keys equal to it), so pushing
+ * is one count-leading-zeros and an append, and popping only ever scans and
+ * redistributes the lowest non-empty bucket, whose keys then all drop to
+ * lower buckets.  Every key moves down at most 64 times in all, and the
+ * buckets are plain arrays that are walked front to back.
+ */
+
+class radixHeap {
+
+ public:
+  radixHeap() : last(0), count(0), buckets(65) {}
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+
+  /**
+   * Method: push
+   * ------------
+   * @param key no smaller than the key of the last pair popped
+   */
+  void push(const uint64_t key, const int value)
+  {
+    buckets[bucketFor(key)].push_back(make_pair(key, value));
+    count++;
+  }
+
+  /**
+   * Method: pop
+   * -----------
+   * Removes a pair with the smallest key.  The heap must not be empty.
+   */
+  pair<uint64_t, int> pop()
+  {
+    if (buckets[0].empty()) refill();
+    const pair<uint64_t, int> smallest = buckets[0].back();
+    buckets[0].pop_back();
+    count--;
+    return smallest;
+  }
+
+  /**
+   * Method: clear
+   * -------------
+   * Empties the heap (keeping its memory) and starts its keys over from 0.
+   */
+  void clear()
+  {
+    for (size_t i = 0; i < buckets.size(); i++) buckets[i].clear();
+    last = 0;
+    count = 0;
+  }
+
+ private:
+  uint64_t last;
+  size_t count;
+  vector<vector<pair<uint64_t, int> > > buckets;
+
+  int bucketFor(const uint64_t key) const
+  {
+    return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+  }
+
+  // moves the smallest keys into bucket 0
+  void refill()
+  {
+    size_t i = 1;
+    while (buckets[i].empty()) i++;
+    vector<pair<uint64_t, int> >& lowest = buckets[i];
+    last = lowest[0].first;
+    for (size_t n = 1; n < lowest.size(); n++) {
+      if (lowest[n].first < last) last = lowest[n].first;
+    }
+    for (size_t n = 0; n < lowest.size(); n++) buckets[bucketFor(lowest[n].first)].push_back(lowest[n]);
+    lowest.clear();
+  }
+
+  radixHeap(const radixHeap& original);
+  radixHeap& operator=(const radixHeap& rhs);
+};
+
+#endif
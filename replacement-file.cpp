@@ -0,0 +1,34 @@
+using namespace std;
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "replacement-file.h"
+
+replacementFile::replacementFile(const string& fileName) :
+    fileName(fileName), tempName(fileName + ".XXXXXX"), created(false), committed(false)
+{
+    const int fd = mkstemp(&tempName[0]);
+    if (fd == -1) return;
+    created = true;
+    // mkstemp makes the file private to its owner, but the readers may be anyone
+    const bool readable = fchmod(fd, 0644) == 0;
+    close(fd);
+    if (readable) out.open(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+    else out.setstate(ios::failbit);
+}
+
+replacementFile::~replacementFile()
+{
+    if (out.is_open()) out.close();
+    if (created && !committed) remove(tempName.c_str());
+}
+
+bool replacementFile::commit()
+{
+    if (!created) return false;
+    out.close();
+    if (!out) return false;
+    committed = rename(tempName.c_str(), fileName.c_str()) == 0;
+    return committed;
+}
@@ -0,0 +1,75 @@
+#ifndef __replacement_file__
+#define __replacement_file__
+
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: replacementFile
+ * ----------------------
+ * Writes a file that the readers map (graph.vbyte, names.index and the
+ * like) beside the one it replaces.  The new file gets a unique name from
+ * mkstemp and is renamed over the original on commit.  That way a reader
+ * never maps half a file, and builders running at once can't write into
+ * each other's.  If the file is destroyed without a successful commit, it
+ * removes what it wrote.
+ */
+
+class replacementFile {
+
+ public:
+
+  /**
+   * Constructor: replacementFile
+   * ----------------------------
+   * @param fileName the file to be replaced (or created) on commit
+   */
+  replacementFile(const string& fileName);
+  ~replacementFile();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the side file was created and every write so far succeeded.
+   */
+  bool good() const { return created && out.good(); }
+
+  /**
+   * Method: stream
+   * --------------
+   * @return the stream to write the new file's contents to
+   */
+  ofstream& stream() { return out; }
+
+  /**
+   * Method: commit
+   * --------------
+   * Closes the side file and renames it over the original.
+   *
+   * @return false if any of the writes, or the rename, failed
+   */
+  bool commit();
+
+ private:
+  string fileName, tempName;
+  ofstream out;
+  bool created, committed;
+
+  replacementFile(const replacementFile& original);
+  replacementFile& operator=(const replacementFile& rhs);
+};
+
+/**
+ * Function: writeBlock
+ * --------------------
+ * Appends a block of ints, or of structs of them, to a file as they lie in memory.
+ */
+template <typename T>
+void writeBlock(ofstream& out, const vector<T>& block)
+{
+  if (!block.empty()) out.write(reinterpret_cast<const char*>(&block[0]), block.size() * sizeof(T));
+}
+
+#endif
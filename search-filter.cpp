@@ -0,0 +1,33 @@
+using namespace std;
+#include "search-filter.h"
+
+movieYears::movieYears(const imdb& db) : years(db.getMovieCount() + 1, 0)
+{
+    for (int movie = 1; movie <= db.getMovieCount(); ++movie) years[movie] = db.getMovieYear(movie);
+}
+
+searchFilter::searchFilter(const movieYears& years, const int actorCount) :
+    years(years), allowedMovies(years.getMovieCount() + 1, true), allowedActors(actorCount + 1, true)
+{
+}
+
+void searchFilter::setYearRange(const int firstYear, const int lastYear)
+{
+    for (int movie = 1; movie <= years.getMovieCount(); ++movie) {
+        const int year = years.getYear(movie);
+        allowedMovies[movie] = firstYear <= year && year <= lastYear;
+    }
+    // the range replaces any earlier one, but exclusions stand
+    for (size_t i = 0; i < excludedMovies.size(); ++i) allowedMovies[excludedMovies[i]] = false;
+}
+
+void searchFilter::excludeMovie(const int movieId)
+{
+    excludedMovies.push_back(movieId);
+    allowedMovies[movieId] = false;
+}
+
+void searchFilter::excludeActor(const int actorId)
+{
+    allowedActors[actorId] = false;
+}
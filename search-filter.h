@@ -0,0 +1,77 @@
+#ifndef __search_filter__
+#define __search_filter__
+
+#include "imdb.h"
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: movieYears
+ * -----------------
+ * The year of every movie as one array indexed by movie id, read from the
+ * imdb once so that filters never have to go back to the movie records.
+ * Build it once per imdb and share it between filters.
+ */
+
+class movieYears {
+
+ public:
+  movieYears(const imdb& db);
+
+  int getMovieCount() const { return years.size() - 1; }
+  int getYear(const int movieId) const { return years[movieId]; }
+
+ private:
+  vector<int16_t> years;
+};
+
+/**
+ * Class: searchFilter
+ * -------------------
+ * Restricts a graphSearch to movies released in a range of years and keeps
+ * it away from particular movies and actors.  Everything is folded into one
+ * bitmap of usable movies and one of usable actors, so the search drops a
+ * movie or an actor with a single bit test and never looks at its record.
+ * A new filter allows everything.
+ */
+
+class searchFilter {
+
+ public:
+
+  /**
+   * Constructor: searchFilter
+   * -------------------------
+   * @param years the year column of the imdb being searched; it must outlive the filter
+   * @param actorCount the number of actors in that imdb
+   */
+  searchFilter(const movieYears& years, const int actorCount);
+
+  /**
+   * Method: setYearRange
+   * --------------------
+   * Only movies released from firstYear to lastYear (inclusive) are used.
+   */
+  void setYearRange(const int firstYear, const int lastYear);
+
+  /**
+   * Methods: excludeMovie
+   *          excludeActor
+   * ---------------------
+   * Keeps the search from going through the movie or actor.  An excluded
+   * actor can't be the source or target of a search either.
+   */
+  void excludeMovie(const int movieId);
+  void excludeActor(const int actorId);
+
+  bool allowsMovie(const int movieId) const { return allowedMovies[movieId]; }
+  bool allowsActor(const int actorId) const { return allowedActors[actorId]; }
+
+ private:
+  const movieYears& years;
+  vector<int> excludedMovies;
+  vector<bool> allowedMovies, allowedActors;
+};
+
+#endif
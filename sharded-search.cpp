@@ -0,0 +1,411 @@
+using namespace std;
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include "sharded-search.h"
+#include "graph-shard.h"
+#include "bench-utils.h"
+
+namespace {
+
+// what the coordinator and workers say to each other
+enum messageKind {
+    kHello,     // worker: shard mapped?, file size (low, high words), actor count, movie count
+    kStart,     // coordinator: source, target
+    kReady,     // worker: frontier size
+    kExpand,    // coordinator: 0 for credits, 1 for cast
+    kOutgoing,  // worker: ids expanded, pairs kept, then per shard a count and that many (id, via) pairs
+    kDeliver,   // coordinator: (id, via) pairs the worker owns
+    kApplied,   // worker: next frontier size, target reached?
+    kVia,       // coordinator: id, whether it's a movie
+    kViaIs,     // worker: the id it was reached through, or 0 for an id it doesn't know
+    kQuit
+};
+
+struct messageHeader {
+    int32_t kind;
+    int32_t unused;
+    int64_t words;
+};
+
+bool writeFully(const int fd, const void *data, size_t bytes)
+{
+    const char *next = static_cast<const char*>(data);
+    while (bytes > 0) {
+        // MSG_NOSIGNAL, so a worker that died shows up as an error rather than SIGPIPE
+        const ssize_t written = ::send(fd, next, bytes, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        next += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+bool readFully(const int fd, void *data, size_t bytes)
+{
+    char *next = static_cast<char*>(data);
+    while (bytes > 0) {
+        const ssize_t got = read(fd, next, bytes);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        next += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+/**
+ * Functions: sendMessage
+ *            receiveMessage
+ * -------------------------
+ * A message is a header (its kind and length) followed by its words.
+ *
+ * @return the bytes moved, or -1 if the other end has gone
+ */
+int64_t sendMessage(const int fd, const int32_t kind, const vector<int32_t>& words)
+{
+    messageHeader header = { kind, 0, (int64_t) words.size() };
+    if (!writeFully(fd, &header, sizeof(header))) return -1;
+    if (!words.empty() && !writeFully(fd, &words[0], words.size() * sizeof(int32_t))) return -1;
+    return sizeof(header) + words.size() * sizeof(int32_t);
+}
+
+int64_t receiveMessage(const int fd, int32_t& kind, vector<int32_t>& words)
+{
+    messageHeader header;
+    if (!readFully(fd, &header, sizeof(header)) || header.words < 0) return -1;
+    kind = header.kind;
+    words.resize(header.words);
+    if (!words.empty() && !readFully(fd, &words[0], words.size() * sizeof(int32_t))) return -1;
+    return sizeof(header) + words.size() * sizeof(int32_t);
+}
+
+bool byId(const pair<int, int>& lhs, const pair<int, int>& rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+bool sameId(const pair<int, int>& lhs, const pair<int, int>& rhs)
+{
+    return lhs.first == rhs.first;
+}
+
+}
+
+shardedSearch::shardedSearch(const string& directory, const int shardCount) :
+    ready(false), bytesMoved(0), actorCount(0), movieCount(0)
+{
+    for (int shard = 0; shard < shardCount; shard++) {
+        int ends[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+            stop();
+            return;
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(ends[0]);
+            for (size_t i = 0; i < channels.size(); i++) close(channels[i]);
+            serve(directory, shard, shardCount, ends[1]);
+            _exit(0);
+        }
+        close(ends[1]);
+        if (pid < 0) {
+            close(ends[0]);
+            stop();
+            return;
+        }
+        workers.push_back(pid);
+        channels.push_back(ends[0]);
+    }
+
+    int32_t kind;
+    vector<int32_t> words;
+    ready = true;
+    for (int shard = 0; shard < shardCount; shard++) {
+        const bool mapped = receive(shard, kind, words) && kind == kHello && words.size() == 5 && words[0] != 0;
+        shardBytes.push_back(mapped ? (uint32_t) words[1] | (uint64_t) (uint32_t) words[2] << 32 : 0);
+        if (mapped && shard == 0) {
+            actorCount = words[3];
+            movieCount = words[4];
+        }
+        // shards of different builds would disagree about what every id means
+        ready = ready && mapped && words[3] == actorCount && words[4] == movieCount;
+    }
+}
+
+shardedSearch::~shardedSearch()
+{
+    stop();
+}
+
+bool shardedSearch::good() const
+{
+    return ready;
+}
+
+int shardedSearch::getShardCount() const
+{
+    return channels.size();
+}
+
+size_t shardedSearch::getShardBytes(const int shard) const
+{
+    return shardBytes[shard];
+}
+
+int shardedSearch::getActorCount() const
+{
+    return actorCount;
+}
+
+int shardedSearch::getMovieCount() const
+{
+    return movieCount;
+}
+
+bool shardedSearch::shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops)
+{
+    hops.clear();
+    steps.clear();
+    if (!ready || source < 1 || source > actorCount || target < 1 || target > actorCount) return false;
+
+    int32_t kind;
+    vector<int32_t> words;
+    vector<int32_t> endpoints;
+    endpoints.push_back(source);
+    endpoints.push_back(target);
+    bytesMoved = 0;
+    if (!broadcast(kStart, endpoints)) return false;
+    for (int shard = 0; shard < getShardCount(); shard++) {
+        if (!receive(shard, kind, words) || kind != kReady) {
+            ready = false;
+            return false;
+        }
+    }
+    if (source == target) return true;
+
+    int64_t reached = 1;
+    bool found = false;
+    for (int level = 1; level <= maxDepth && reached > 0 && !found; level++) {
+        if (!runStep(false, level, reached, found) || reached == 0) break;
+        if (!runStep(true, level, reached, found)) break;
+    }
+    if (!found || !ready) return false;
+
+    // each step back is a question for the worker owning it
+    vector<int> reversed;
+    for (int actor = target; actor != source; ) {
+        int movie;
+        reversed.push_back(actor);
+        if (!askVia(actor, false, movie) || !askVia(movie, true, actor)) return false;
+        reversed.push_back(movie);
+    }
+    hops.assign(reversed.rbegin(), reversed.rend());
+    return true;
+}
+
+/**
+ * Method: runStep
+ * ---------------
+ * One superstep: expand, route, apply.
+ *
+ * @param reached set to the size of the next frontier, over all shards
+ * @param found set to whether the target was reached
+ * @return false if a worker stopped answering
+ */
+bool shardedSearch::runStep(const bool cast, const int level, int64_t& reached, bool& found)
+{
+    const int shardCount = getShardCount();
+    stepReport step = { level, cast, 0, 0, 0, 0, 0 };
+    const double start = now();
+    bytesMoved = 0;
+
+    int32_t kind;
+    vector<int32_t> words;
+    if (!broadcast(kExpand, vector<int32_t>(1, cast ? 1 : 0))) return false;
+    vector<vector<int32_t> > deliveries(shardCount);
+    for (int shard = 0; shard < shardCount; shard++) {
+        if (!receive(shard, kind, words) || kind != kOutgoing) return ready = false;
+        step.expanded += words[0];
+        step.localPairs += words[1];
+        size_t next = 2;
+        for (int owner = 0; owner < shardCount; owner++) {
+            const int count = words[next++];
+            deliveries[owner].insert(deliveries[owner].end(), words.begin() + next, words.begin() + next + 2 * count);
+            next += 2 * count;
+            step.remotePairs += count;
+        }
+    }
+    for (int shard = 0; shard < shardCount; shard++) {
+        if (!send(shard, kDeliver, deliveries[shard])) return ready = false;
+    }
+
+    reached = 0;
+    found = false;
+    for (int shard = 0; shard < shardCount; shard++) {
+        if (!receive(shard, kind, words) || kind != kApplied) return ready = false;
+        reached += words[0];
+        found = found || words[1] != 0;
+    }
+    step.bytes = bytesMoved;
+    step.seconds = now() - start;
+    steps.push_back(step);
+    return true;
+}
+
+bool shardedSearch::askVia(const int id, const bool isMovie, int& via)
+{
+    vector<int32_t> words;
+    words.push_back(id);
+    words.push_back(isMovie ? 1 : 0);
+    int32_t kind;
+    const int owner = graphShard::ownerOf(id, getShardCount());
+    if (!send(owner, kVia, words) || !receive(owner, kind, words) || kind != kViaIs || words.size() != 1) {
+        return ready = false;
+    }
+    via = words[0];
+    return via > 0;
+}
+
+bool shardedSearch::send(const int shard, const int32_t kind, const vector<int32_t>& words)
+{
+    const int64_t bytes = sendMessage(channels[shard], kind, words);
+    if (bytes < 0) return false;
+    bytesMoved += bytes;
+    return true;
+}
+
+bool shardedSearch::receive(const int shard, int32_t& kind, vector<int32_t>& words)
+{
+    const int64_t bytes = receiveMessage(channels[shard], kind, words);
+    if (bytes < 0) return false;
+    bytesMoved += bytes;
+    return true;
+}
+
+bool shardedSearch::broadcast(const int32_t kind, const vector<int32_t>& words)
+{
+    for (int shard = 0; shard < getShardCount(); shard++) {
+        if (!send(shard, kind, words)) return ready = false;
+    }
+    return true;
+}
+
+void shardedSearch::stop()
+{
+    for (size_t i = 0; i < channels.size(); i++) {
+        sendMessage(channels[i], kQuit, vector<int32_t>());
+        close(channels[i]);
+    }
+    for (size_t i = 0; i < workers.size(); i++) waitpid(workers[i], NULL, 0);
+    channels.clear();
+    workers.clear();
+    ready = false;
+}
+
+/**
+ * Method: serve
+ * -------------
+ * A worker's whole life: map the shard, then answer the coordinator until
+ * told to quit (or it goes away).
+ */
+void shardedSearch::serve(const string& directory, const int shard, const int shardCount, const int channel)
+{
+    const graphShard slice(directory, shard, shardCount);
+    vector<int32_t> words;
+    words.push_back(slice.good() ? 1 : 0);
+    words.push_back(slice.good() ? (uint32_t) slice.getFileSize() : 0);
+    words.push_back(slice.good() ? (uint32_t) ((uint64_t) slice.getFileSize() >> 32) : 0);
+    words.push_back(slice.good() ? slice.getActorCount() : 0);
+    words.push_back(slice.good() ? slice.getMovieCount() : 0);
+    if (sendMessage(channel, kHello, words) < 0 || !slice.good()) return;
+
+    // the search's marks, for this shard's ids only, at index id / shardCount
+    vector<unsigned> actorSeen(slice.getActorCount() / shardCount + 1, 0), movieSeen(slice.getMovieCount() / shardCount + 1, 0);
+    vector<int> actorVia(actorSeen.size(), 0), movieVia(movieSeen.size(), 0);
+    unsigned stamp = 0;
+    int target = 0;
+    bool castStep = false, found = false;
+    vector<int> frontier, next, ids;
+    vector<vector<pair<int, int> > > outgoing(shardCount);
+
+    // marks an id of this shard as reached through via, unless it already was
+    // (or is no id of this shard's at all, which a confused coordinator could send)
+    const auto reach = [&](const int id, const int via, const bool isMovie) {
+        vector<unsigned>& seen = isMovie ? movieSeen : actorSeen;
+        const int slot = id / shardCount;
+        if (id < 1 || slot >= (int) seen.size() || graphShard::ownerOf(id, shardCount) != shard) return;
+        if (seen[slot] == stamp) return;
+        seen[slot] = stamp;
+        (isMovie ? movieVia : actorVia)[slot] = via;
+        next.push_back(id);
+        if (!isMovie && id == target) found = true;
+    };
+
+    int32_t kind;
+    while (receiveMessage(channel, kind, words) >= 0 && kind != kQuit) {
+        if (kind == kStart) {
+            if (++stamp == 0) {
+                fill(actorSeen.begin(), actorSeen.end(), 0);
+                fill(movieSeen.begin(), movieSeen.end(), 0);
+                stamp = 1;
+            }
+            const int source = words[0];
+            target = words[1];
+            next.clear();
+            if (graphShard::ownerOf(source, shardCount) == shard) reach(source, 0, false);
+            found = false;
+            frontier.swap(next);
+            next.clear();
+            sendMessage(channel, kReady, vector<int32_t>(1, frontier.size()));
+
+        } else if (kind == kExpand) {
+            castStep = words[0] != 0;
+            for (int owner = 0; owner < shardCount; owner++) outgoing[owner].clear();
+            for (size_t i = 0; i < frontier.size(); i++) {
+                if (castStep) slice.getCastIds(frontier[i], ids);
+                else slice.getCreditIds(frontier[i], ids);
+                for (size_t j = 0; j < ids.size(); j++) {
+                    outgoing[graphShard::ownerOf(ids[j], shardCount)].push_back(make_pair(ids[j], frontier[i]));
+                }
+            }
+
+            // this shard's own pairs never leave it; the rest go once per id
+            next.clear();
+            const vector<pair<int, int> >& kept = outgoing[shard];
+            for (size_t i = 0; i < kept.size(); i++) reach(kept[i].first, kept[i].second, !castStep);
+            words.assign(1, frontier.size());
+            words.push_back(kept.size());
+            for (int owner = 0; owner < shardCount; owner++) {
+                vector<pair<int, int> >& pairs = outgoing[owner];
+                if (owner == shard) pairs.clear();
+                stable_sort(pairs.begin(), pairs.end(), byId);
+                pairs.erase(unique(pairs.begin(), pairs.end(), sameId), pairs.end());
+                words.push_back(pairs.size());
+                for (size_t i = 0; i < pairs.size(); i++) {
+                    words.push_back(pairs[i].first);
+                    words.push_back(pairs[i].second);
+                }
+            }
+            sendMessage(channel, kOutgoing, words);
+
+        } else if (kind == kDeliver) {
+            for (size_t i = 0; i + 1 < words.size(); i += 2) reach(words[i], words[i + 1], !castStep);
+            frontier.swap(next);
+            next.clear();
+            words.assign(1, frontier.size());
+            words.push_back(found ? 1 : 0);
+            sendMessage(channel, kApplied, words);
+
+        } else if (kind == kVia) {
+            const vector<int>& via = words[1] != 0 ? movieVia : actorVia;
+            const int slot = words[0] / shardCount;
+            const bool known = words[0] >= 1 && slot < (int) via.size();
+            sendMessage(channel, kViaIs, vector<int32_t>(1, known ? via[slot] : 0));
+        }
+    }
+}
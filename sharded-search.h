@@ -0,0 +1,135 @@
+#ifndef __sharded_search__
+#define __sharded_search__
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: shardedSearch
+ * --------------------
+ * graphSearch's shortest path search, run across one worker process per
+ * graphShard.  Each worker maps only its own shard and remembers which of
+ * its actors and movies the current search has reached (and through what);
+ * nothing holds the whole graph.
+ *
+ * The search is level synchronous and driven by the process that made the
+ * shardedSearch, talking to each worker over a Unix socket pair.  Every
+ * level is two steps, credits (the actor frontier's movies) then cast (the
+ * movie frontier's actors), and each step is a superstep:
+ *
+ *     1. every worker expands its part of the frontier into (id, via)
+ *        pairs, keeps the ones it owns and sends the rest, deduplicated
+ *        and grouped by owner, to the coordinator
+ *     2. the coordinator routes each group to its owner
+ *     3. every owner marks the ids it hadn't reached, which become its
+ *        part of the next frontier, and reports its size and whether it
+ *        reached the target
+ *
+ * Once the target is reached, the path is read back one hop at a time
+ * from the workers owning each step.  The coordinator only ever holds one
+ * step's pairs in transit, so the transport could as well be TCP between
+ * machines.  Every step's traffic and time is recorded, for reports.
+ *
+ * The workers are forked by the constructor, so make the shardedSearch
+ * before starting any threads or mapping anything large.
+ */
+
+class shardedSearch {
+
+ public:
+
+  /**
+   * Constructor: shardedSearch
+   * --------------------------
+   * Starts one worker per shard; each maps its shard file (see
+   * graphShard::build) in directory.
+   */
+  shardedSearch(const string& directory, const int shardCount);
+
+  /**
+   * Destructor: ~shardedSearch
+   * --------------------------
+   * Stops the workers and waits for them.
+   */
+  ~shardedSearch();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if every worker started and mapped its shard
+   * (see graphShard::good; a stale shard won't map), and they all came
+   * from the same imdb.
+   */
+  bool good() const;
+
+  int getShardCount() const;
+
+  /**
+   * Method: getShardBytes
+   * ---------------------
+   * @return the size of the shard file a worker maps
+   */
+  size_t getShardBytes(const int shard) const;
+
+  /**
+   * Methods: getActorCount
+   *          getMovieCount
+   * ---------------------
+   * @return the counts of the imdb the shards were built from, which every
+   *         worker has to agree on; ids outside them are never searched
+   */
+  int getActorCount() const;
+  int getMovieCount() const;
+
+  /**
+   * Method: shortestPath
+   * --------------------
+   * Same contract as graphSearch::shortestPath; ids past getActorCount
+   * have no path.
+   */
+  bool shortestPath(const int source, const int target, const int maxDepth, vector<int>& hops);
+
+  /**
+   * Struct: stepReport
+   * ------------------
+   * What one superstep of the last search did: the level (in movies) it
+   * reached, whether it expanded credits or cast, how many ids it
+   * expanded, how many (id, via) pairs stayed with their worker and how
+   * many crossed to another, the bytes that crossed the sockets (both
+   * ways, headers included), and how long it took.
+   */
+  struct stepReport {
+    int level;
+    bool cast;
+    int64_t expanded, localPairs, remotePairs, bytes;
+    double seconds;
+  };
+
+  const vector<stepReport>& getSteps() const { return steps; }
+
+ private:
+  vector<pid_t> workers;
+  vector<int> channels;         // the coordinator's end of each worker's socket pair
+  vector<size_t> shardBytes;
+  bool ready;
+  vector<stepReport> steps;
+  int64_t bytesMoved;           // by send and receive, since the last reset
+  int actorCount, movieCount;
+
+  static void serve(const string& directory, const int shard, const int shardCount, const int channel);
+
+  bool send(const int shard, const int32_t kind, const vector<int32_t>& words);
+  bool receive(const int shard, int32_t& kind, vector<int32_t>& words);
+  bool broadcast(const int32_t kind, const vector<int32_t>& words);
+  bool runStep(const bool cast, const int level, int64_t& reached, bool& found);
+  bool askVia(const int id, const bool isMovie, int& via);
+  void stop();
+
+  shardedSearch(const shardedSearch& original);
+  shardedSearch& operator=(const shardedSearch& rhs);
+};
+
+#endif
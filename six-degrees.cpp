@@ -1,16 +1,63 @@
 #include <vector>
-#include <list>
-#include <set>
 #include <string>
 #include <iostream>
 #include <iomanip>
-#include <queue>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <chrono>
+#include <unistd.h>
 #include "imdb.h"
+#include "imdb-handle.h"
 #include "path.h"
+#include "name-index.h"
+#include "compact-graph.h"
+#include "graph-search.h"
+#include "search-filter.h"
+#include "all-shortest-paths.h"
+#include "weighted-search.h"
+#include "query-options.h"
+#include "query-arena.h"
+#include "name-search.h"
+#include "path-cache.h"
 using namespace std;
 
 namespace {
 
+const int kNumSuggestions = 5;
+
+// how often to look for new data files between queries
+const int kReloadCheckMillis = 1000;
+
+// set by Ctrl-C while a query runs, which gives up the query rather than the program
+cancellationToken interrupted;
+
+void interruptQuery(int)
+{
+  interrupted.cancel();
+}
+
+/**
+ * Prints the actors the user most likely meant when a name didn't match
+ * exactly: prefix completions first (so "Kate Ritchie" offers "Kate Ritchie (I)"),
+ * falling back on typo-tolerant matches.  Prints nothing if the index is
+ * unavailable or has nothing to offer.
+ *
+ * @param response the name the user typed
+ * @param names the name index over the imdb
+ */
+void printSuggestions(const string& response, const nameIndex& names)
+{
+  vector<suggestion> matches;
+  names.complete(response, kNumSuggestions, matches, nameIndex::kActorName);
+  if (matches.empty()) names.suggest(response, kNumSuggestions, matches, nameIndex::kActorName);
+  if (matches.empty()) return;
+  cout << "Did you mean:" << endl;
+  for (int i = 0; i < (int) matches.size(); i++) {
+    cout << "    " << matches[i].name << endl;
+  }
+}
+
 /**
  * Using the specified prompt, requests that the user supply
  * the name of an actor or actress.  The code returns
@@ -22,10 +69,12 @@ namespace {
  *               part of the user prompt.
  * @param db a reference to the imdb which can be used to confirm
  *           that a user's response is a legitimate one.
+ * @param names the name index used to suggest alternatives when the
+ *              response doesn't match anyone exactly.
  * @return the name of the user-supplied actor or actress, or the
  *         empty string.
  */
-string promptForActor(const string& prompt, const imdb& db)
+string promptForActor(const string& prompt, const imdb& db, const nameIndex& names)
 {
   string response;
   while (true) {
@@ -36,6 +85,7 @@ string promptForActor(const string& prompt, const imdb& db)
     if (db.getCredits(response, credits)) return response;
     cout << "We couldn't find \"" << response << "\" in the movie database. "
 	 << "Please try again." << endl;
+    printSuggestions(response, names);
   }
 }
 
@@ -47,176 +97,302 @@ string promptForActor(const string& prompt, const imdb& db)
 
 const int MAX_DEPTH = 6;
 
-// common types
-typedef imdb               DB;
-typedef path               NODE;
-typedef list<NODE> QUEUE;
-typedef vector<string> CAST;
-typedef vector<film>   FILMS;
+typedef imdb DB;
 
 /**
  * *****************************************************************
- * class: visitRecord
- * A set of visited films and players
+ *  Method: generateShortestPath
+ *  ------------------
+ *  find the shortest path from source to target with an id-based
+ *  search, e.g. over the compressed graph
+ *
+ *  @param search The search (and the adjacency it runs over)
+ *  @param db The database the ids refer to
+ *  @param source the starting player
+ *  @param target the target player
+ *  @param filter the movies and actors the path may use, or NULL for all
+ *  @param options The limits the search runs under
+ *  @param status Set to how the search ended
+ *
  * *****************************************************************
  */
-class visitRecord {
-    public:
-    void recordVisit (const string& player)
-    {
-         players.insert(player);
-    }
+template <typename Graph>
+path generateShortestPath(graphSearch<Graph>& search, const DB& db, const string& source, const string& target,
+                          const searchFilter *filter, const queryOptions& options, queryStatus& status)
+{
+    vector<int> hops;
+    const int sourceId = db.getActorId(source), targetId = db.getActorId(target);
+    status = filter == NULL ? search.shortestPath(sourceId, targetId, MAX_DEPTH, hops, options)
+                            : search.shortestPath(sourceId, targetId, MAX_DEPTH, hops, *filter, options);
+    if (status != kPathFound) return path("");
+    return makePath(db, sourceId, hops);
+}
 
-    void recordVisit (const film& film)
-    {
-         films.insert(film);
+/**
+ * Answers a shortest path query from the cache if it can.  Otherwise search
+ * (called with status) runs it, and its outcome is cached unless the
+ * search was cut short.
+ */
+template <typename Search>
+path cachedShortestPath(pathCache& cache, const DB& db, const string& source, const string& target,
+                        queryStatus& status, Search search)
+{
+    const int sourceId = db.getActorId(source), targetId = db.getActorId(target);
+    bool found;
+    vector<int> hops;
+    if (cache.lookup(sourceId, targetId, found, hops)) {
+        status = found ? kPathFound : kNoPath;
+        return found ? makePath(db, sourceId, hops) : path("");
     }
 
-    bool visitedBefore (const string& player)
-    {
-        if (players.find(player) != players.end()) {
-            return true;
-        } else {
-            return false;
-        }
+    path p = search(status);
+    if (status != kPathFound && status != kNoPath) return p;
+    for (int i = 0; i < p.getLength(); i++) {
+        hops.push_back(db.getMovieId(p.getMovie(i)));
+        hops.push_back(db.getActorId(p.getPlayer(i + 1)));
     }
+    cache.insert(sourceId, targetId, status == kPathFound, hops);
+    return p;
+}
 
-    bool visitedBefore (const film& film)
-    {
-        if (films.find(film) != films.end()) {
-            return true;
-        } else {
-            return false;
-        }
+/**
+ * Prints why a bounded search came back without a path.
+ */
+void reportNoPath(const queryStatus status)
+{
+    cout << endl;
+    switch (status) {
+    case kTimedOut: cout << "The search ran out of time before it could find a path." << endl; break;
+    case kOverBudget: cout << "The search outgrew its memory budget before it could find a path." << endl; break;
+    case kCancelled: cout << "The search was cancelled." << endl; break;
+    default: cout << "No path between those two people could be found." << endl; break;
     }
-    private:
-    set<string> players;
-    set<film>   films;
-};
+    cout << endl;
+}
 
 /**
- * *****************************************************************
- *  Method: addChildrenNodes
- *  ------------------
- *  Replace the current nodes in the queue with their children
+ * Function: generateCheapestPath
+ * ------------------------------
+ * Like generateShortestPath, but minimizing the summed cost of the movies
+ * on the path rather than their number.
  *
- *  @param db The database to use
- *  @param visited A record of visited players and films
- *  @param searchQueue The queue  
+ *  @param search The weighted search (and the adjacency it runs over)
+ *  @param db The database the ids refer to
+ *  @param source the starting player
+ *  @param target the target player
+ *  @param cost the price of going through each movie
+ *  @param filter the movies and actors the path may use, or NULL for all
+ *  @param options The limits the search runs under
+ *  @param status Set to how the search ended
+ *  @param total set to the cost of the path found
+ */
+template <typename Graph, typename Cost>
+path generateCheapestPath(weightedSearch<Graph>& search, const DB& db, const string& source, const string& target,
+                          const Cost& cost, const searchFilter *filter, const queryOptions& options,
+                          queryStatus& status, uint64_t& total)
+{
+    vector<int> hops;
+    const int sourceId = db.getActorId(source), targetId = db.getActorId(target);
+    status = filter == NULL ? search.cheapestPath(sourceId, targetId, cost, hops, total, options)
+                            : search.cheapestPath(sourceId, targetId, cost, hops, total, *filter, options);
+    if (status != kPathFound) return path("");
+    return makePath(db, sourceId, hops);
+}
+
+/**
+ * Function: printAlternatives
+ * ---------------------------
+ * Lists, for every connection along a path, the other films the two
+ * players could have been connected through.
  *
- * *****************************************************************
+ * @param p the path, as printed
+ * @param db the imdb the path was found in
  */
-void addChildrenNodes(const DB& db, visitRecord& visited, QUEUE& searchQueue)
+void printAlternatives(const path& p, const imdb& db)
 {
-    ///////////////////////////////////////////////////////////////
-    // Go through each node in queue
-    int nodesInQueue = searchQueue.size();
-    for (int n = 0; n < nodesInQueue; ++n) {
-        ///////////////////////////////////////////////////////////////
-        // Get player from node
-        NODE* node = &searchQueue.front();
-        
-        string player = (*node).getLastPlayer();
-        ///////////////////////////////////////////////////////////////
-        // Get movies from player
-        FILMS credits;
-        if(db.getCredits(player, credits) && credits.size() > 0) {
-            for(FILMS::const_iterator f = credits.begin(); f != credits.end(); ++f) {
-                if (!visited.visitedBefore(*f)) {
-                    ///////////////////////////////////////////////////////////////
-                    // Get cast of players from movie
-                    CAST cast;
-                    db.getCast(*f, cast);
-                    for (CAST::const_iterator p = cast.begin(); p != cast.end(); ++p) {
-                        // Add new node if not visited before
-                        if (!visited.visitedBefore(*p)) {
-                            NODE newNode = (*node);
-                            newNode.addConnection(*f,*p);
-                            searchQueue.push_back(newNode);
-
-                            // record visit
-                            visited.recordVisit(*p);
-                        }
-                    }
-                    visited.recordVisit(*f);
-                    ///////////////////////////////////////////////////////////////
-                }
-            }
-        } else {
-            cerr << "addChildrenNodes: Films could not be found for a player" << endl;
+    vector<film> shared;
+    for (int i = 0; i < p.getLength(); i++) {
+        db.getCommonFilms(p.getPlayer(i), p.getPlayer(i + 1), shared);
+        if (shared.size() < 2) continue;
+        cout << "\t" << p.getPlayer(i) << " and " << p.getPlayer(i + 1) << " were also both in";
+        const char *separator = " ";
+        for (size_t f = 0; f < shared.size(); f++) {
+            if (shared[f] == p.getMovie(i)) continue;
+            cout << separator << "\"" << shared[f].title << "\" (" << shared[f].year << ")";
+            separator = ", ";
         }
-        searchQueue.pop_front();
-        ///////////////////////////////////////////////////////////////
+        cout << ".\n";
     }
-    ///////////////////////////////////////////////////////////////
 }
 
-bool isNodeTarget (string target, NODE node)
+/**
+ * Function: listShortestPaths
+ * ---------------------------
+ * Reports how many shortest paths connect the two players and prints the
+ * first few of them.  The paths are produced one at a time, so asking for
+ * a handful between two hubs with millions in common costs a handful.
+ *
+ *  @param paths The path counter (and the adjacency it runs over)
+ *  @param db The database the ids refer to
+ *  @param source the starting player
+ *  @param target the target player
+ *  @param limit how many of the paths to print
+ *  @param filter the movies and actors the paths may use, or NULL for all
+ *  @param showAlternatives whether to list the other films each connection could have used
+ *  @param options The limits counting the paths runs under
+ */
+template <typename Graph>
+void listShortestPaths(allShortestPaths<Graph>& paths, const DB& db, const string& source, const string& target,
+                       const int limit, const searchFilter *filter, const bool showAlternatives,
+                       const queryOptions& options)
 {
-    return (target == node.getLastPlayer());
+    const int sourceId = db.getActorId(source), targetId = db.getActorId(target);
+    const queryStatus status = filter == NULL ? paths.build(sourceId, targetId, MAX_DEPTH, options)
+                                              : paths.build(sourceId, targetId, MAX_DEPTH, *filter, options);
+    if (status != kPathFound) {
+        reportNoPath(status);
+        return;
+    }
+    cout << endl << paths.getCount() << " shortest path(s) of " << paths.getLength() << " movie(s)";
+    cout << (limit > 0 ? ", the first of them:" : ".") << endl << endl;
+    vector<int> hops;
+    for (int n = 0; n < limit && paths.nextPath(hops); n++) {
+        const path p = makePath(db, sourceId, hops);
+        cout << p;
+        if (showAlternatives) printAlternatives(p, db);
+        cout << '\n';
+    }
+}
+
+/**
+ * Says how long loading the data files into memory took, and how much of
+ * them the kernel put on huge pages.
+ */
+void reportLoad(const imdb& db, const chrono::steady_clock::duration took)
+{
+  const double mebibytes = db.getDataBytes() / 1048576.0;
+  const double huge = db.getDataBytes() == 0 ? 0 : 100.0 * db.getHugePageBytes() / db.getDataBytes();
+  const streamsize precision = cout.precision();
+  cout << "Loaded " << fixed << setprecision(1) << mebibytes << " MiB into memory in "
+       << chrono::duration<double, milli>(took).count() << " ms, " << setprecision(0) << huge
+       << "% of it on 2 MiB pages";
+  if (db.getHugePageBytes() < db.getDataBytes()) cout << " and the rest on " << sysconf(_SC_PAGESIZE) / 1024 << " KiB ones";
+  cout << "." << endl;
+  cout.unsetf(ios::floatfield);
+  cout.precision(precision);
 }
 
 /**
  * *****************************************************************
- *  Method: Breadth First Search
- *  ------------------
- *  search for target
- *
- *  @param db The database to use
- *  @param depth Current depth a record of visited players and films
- *  @param target The player to search for
- *  @param visited A class containing information on visited players and films
- *  @param searchQueue The current level of nodes
- *
+ * Command line
  * *****************************************************************
  */
-NODE BFS(const DB&     db,
-         const int&    depth, 
-         const string& target, 
-         visitRecord&  visited,
-         QUEUE&        searchQueue)
+struct searchOptions {
+    bool compact;
+    bool inMemory;
+    bool listAll;
+    bool alternatives;
+    int pathLimit;
+    string weight;
+    int timeoutMillis;
+    int memoryMiB;
+    int cacheMiB;
+    bool hasYearRange;
+    int firstYear, lastYear;
+    vector<string> avoidedActors;
+    vector<string> avoidedFilms;
+    string directory;
+};
+
+/**
+ * Parses a film written the way paths print them: Title (1999)
+ */
+bool parseFilm(const string& text, film& movie)
 {
-    // Check for target
-    for (QUEUE::iterator n = searchQueue.begin(); n != searchQueue.end(); ++n) {
-        if (isNodeTarget(target, *n)) {
-            return (*n);
-        }
-    }
+    const size_t open = text.rfind(" (");
+    if (open == string::npos || text[text.size() - 1] != ')') return false;
+    movie.title = text.substr(0, open);
+    movie.year = atoi(text.substr(open + 2).c_str());
+    return movie.year != 0;
+}
 
-	if (depth < 1) {
-        // return an empty path
-        return path("");
+bool parseOptions(int argc, char *argv[], searchOptions& options)
+{
+    options.compact = false;
+    options.inMemory = false;
+    options.listAll = false;
+    options.alternatives = false;
+    options.timeoutMillis = 0;
+    options.memoryMiB = 0;
+    options.cacheMiB = 0;
+    options.hasYearRange = false;
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--compact") options.compact = true;
+        else if (arg == "--in-memory") options.inMemory = true;
+        else if (arg == "--alternatives") options.alternatives = true;
+        else if (arg == "--years" && i + 1 < argc) {
+            options.hasYearRange = true;
+            if (sscanf(argv[++i], "%d-%d", &options.firstYear, &options.lastYear) != 2) return false;
+        }
+        else if (arg == "--all" && i + 1 < argc) {
+            options.listAll = true;
+            options.pathLimit = atoi(argv[++i]);
+            if (options.pathLimit < 0) return false;
+        }
+        else if (arg == "--weight" && i + 1 < argc) {
+            options.weight = argv[++i];
+            if (options.weight != "recent" && options.weight != "cast") return false;
+        }
+        else if (arg == "--timeout" && i + 1 < argc) {
+            options.timeoutMillis = atoi(argv[++i]);
+            if (options.timeoutMillis <= 0) return false;
+        }
+        else if (arg == "--memory" && i + 1 < argc) {
+            options.memoryMiB = atoi(argv[++i]);
+            if (options.memoryMiB <= 0) return false;
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            options.cacheMiB = atoi(argv[++i]);
+            if (options.cacheMiB <= 0) return false;
+        }
+        else if (arg == "--avoid" && i + 1 < argc) options.avoidedActors.push_back(argv[++i]);
+        else if (arg == "--avoid-film" && i + 1 < argc) options.avoidedFilms.push_back(argv[++i]);
+        else if (arg[0] != '-' && options.directory.empty()) options.directory = arg;
+        else return false;
     }
-
-    // search deeper
-    addChildrenNodes(db, visited, searchQueue);
-    return BFS(db, depth - 1, target, visited, searchQueue);
+    return !options.directory.empty();
 }
 
 /**
- * *****************************************************************
- *  Method: generateShortestPath
- *  ------------------
- *  find the shortest path from source to target
+ * Builds the filter for the constraints on the command line.
  *
- *  @param db The database to use
- *  @param source the starting player 
- *  @param target the target player 
- *
- * *****************************************************************
+ * @return the filter, or NULL if a name or film to avoid isn't in the database
  */
-path generateShortestPath(DB& db, const string& source, const string& target) 
+searchFilter *makeFilter(const searchOptions& options, const DB& db, const movieYears& years)
 {
-    visitRecord visited; // a set of visited actors
-	path p(source); // initial path
-
-    QUEUE searchQueue;
-    searchQueue.push_back(p);
-    
-    visited.recordVisit(source);
-    
-    path res = BFS(db, 6, target, visited, searchQueue);
-    return res;
+    searchFilter *filter = new searchFilter(years, db.getActorCount());
+    if (options.hasYearRange) filter->setYearRange(options.firstYear, options.lastYear);
+    for (size_t i = 0; i < options.avoidedActors.size(); i++) {
+        const int actorId = db.getActorId(options.avoidedActors[i]);
+        if (actorId == 0) {
+            cout << "We couldn't find \"" << options.avoidedActors[i] << "\" in the movie database." << endl;
+            delete filter;
+            return NULL;
+        }
+        filter->excludeActor(actorId);
+    }
+    for (size_t i = 0; i < options.avoidedFilms.size(); i++) {
+        film movie;
+        const int movieId = parseFilm(options.avoidedFilms[i], movie) ? db.getMovieId(movie) : 0;
+        if (movieId == 0) {
+            cout << "We couldn't find the film \"" << options.avoidedFilms[i] << "\" in the movie database." << endl;
+            delete filter;
+            return NULL;
+        }
+        filter->excludeMovie(movieId);
+    }
+    return filter;
 }
 
 void getRandomPlayers (DB& db) {
@@ -233,8 +409,28 @@ void getRandomPlayers (DB& db) {
  * There are no parameters to speak of.
  *
  * @param argc the number of tokens passed to the command line to
- *             invoke this executable.  It's completely ignored
- *             here, because we don't expect any arguments.
+ *             invoke this executable: the data directory, optionally
+ *             preceded by --compact to search the compressed graph
+ *             (graph.vbyte, see graph-compress) instead of the raw files,
+ *             --in-memory to load the raw files into (huge page backed)
+ *             memory rather than map them,
+ *             and by constraints on the paths: --years <first>-<last>,
+ *             --avoid <actor> and --avoid-film "<title> (<year>)" (the
+ *             last two may be repeated).  --all <n> counts every shortest
+ *             path and prints the first n of them, and --weight recent or
+ *             --weight cast finds the cheapest path instead of the
+ *             shortest, preferring recent films or small casts.
+ *             --alternatives also lists the other films each pair of
+ *             neighbours on a path shared.  --timeout <ms> and
+ *             --memory <MiB> give up searches (for the shortest path,
+ *             all of them, or the cheapest) that take longer or whose
+ *             frontier grows bigger than that, and Ctrl-C gives up the
+ *             search in progress.  --cache <MiB>
+ *             remembers that much of the shortest paths found (without
+ *             constraints), answering repeated pairs in either direction
+ *             without a search.  Searching the raw files without
+ *             constraints, new data files are picked up between queries
+ *             without a restart.
  * @param argv the C strings making up the full command line.
  *             We expect argv[0] to be logically equivalent to
  *             "six-degrees" (or whatever absolute path was used to
@@ -245,37 +441,156 @@ void getRandomPlayers (DB& db) {
 
 int main(int argc, char *argv[])
 {
-  if (argc != 2) {
-    cerr << "Usage: six-degrees <data-files-path>" << endl;
+  searchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    cerr << "Usage: six-degrees [--compact] [--in-memory] [--alternatives] [--timeout <ms>] [--memory <MiB>] [--cache <MiB>] [--all <n>] [--weight recent|cast] [--years <first>-<last>] [--avoid <actor>]... "
+         << "[--avoid-film \"<title> (<year>)\"]... <data-files-path>" << endl;
     return 1;
   }
+  const string directory = options.directory;
+  const bool compact = options.compact;
+  const bool constrained = options.hasYearRange || !options.avoidedActors.empty() || !options.avoidedFilms.empty();
+  const bool listAll = options.listAll;
+  const bool weighted = !options.weight.empty();
 
-  imdb db(argv[1]);
+  const chrono::steady_clock::time_point loadStart = chrono::steady_clock::now();
+  imdbHandle handle(directory, options.inMemory ? imdb::kInMemory : imdb::kFileMapped);
   
-  if (!db.good()) {
+  if (!handle.good()) {
     cout << "Failed to properly initialize the imdb database." << endl;
     cout << "Please check to make sure the source files exist and that you have permission to read them." << endl;
     exit(1);
   }
+  if (options.inMemory) reportLoad(*handle.acquire(), chrono::steady_clock::now() - loadStart);
+
+  // the compressed graph, the filter's ids and the other searches below are made over one
+  // snapshot, so a mode using them pins it for good and never reloads; otherwise nothing
+  // holds a snapshot past the query it was acquired for
+  const bool reloads = !compact && !constrained && !listAll && !weighted;
+  const imdbHandle::snapshot pinned = reloads ? imdbHandle::snapshot() : handle.acquire();
+  if (reloads) handle.watch(kReloadCheckMillis);
+
+  compactGraph graph(directory);
+  if (compact && (!graph.good() || graph.getFingerprint() != pinned->getFingerprint())) {
+    cout << "No up-to-date compressed graph in " << directory << "; run graph-compress first." << endl;
+    exit(1);
+  }
+  graphSearch<compactGraph> *compactSearch = compact ? new graphSearch<compactGraph>(graph) : NULL;
+  graphSearch<imdb> *constrainedSearch = constrained && !compact ? new graphSearch<imdb>(*pinned) : NULL;
+  allShortestPaths<compactGraph> *compactPaths = listAll && compact ? new allShortestPaths<compactGraph>(graph) : NULL;
+  allShortestPaths<imdb> *paths = listAll && !compact ? new allShortestPaths<imdb>(*pinned) : NULL;
+  weightedSearch<compactGraph> *compactWeighted = weighted && compact ? new weightedSearch<compactGraph>(graph) : NULL;
+  weightedSearch<imdb> *rawWeighted = weighted && !compact ? new weightedSearch<imdb>(*pinned) : NULL;
+
+  movieYears *years = constrained ? new movieYears(*pinned) : NULL;
+  searchFilter *filter = constrained ? makeFilter(options, *pinned, *years) : NULL;
+  if (constrained && filter == NULL) exit(1);
+
+  if (weighted && years == NULL) years = new movieYears(*pinned);
+  recentFilmCost *recentCost = options.weight == "recent" ? new recentFilmCost(*years) : NULL;
+  smallCastCost *castCost = options.weight == "cast" ? (compact ? new smallCastCost(graph) : new smallCastCost(*pinned)) : NULL;
+
+  // the name-based search allocates from here, and gives it all back after each query
+  queryArena arena;
+
+  // cached paths are in the ids of the snapshot they were found in, and the name index
+  // serves one snapshot's names, so a query on any other snapshot clears the one and
+  // reopens the other (rebuilding names.index from the new files).  The snapshot they
+  // belong to is held on to, so its address can't be reused by a later one.
+  pathCache *cache = options.cacheMiB > 0 && !constrained ? new pathCache(size_t(options.cacheMiB) << 20) : NULL;
+  nameIndex *names = NULL;
+  imdbHandle::snapshot indexed;
   
   while (true) {
-    string source = promptForActor("Actor or actress", db);
+    const imdbHandle::snapshot current = reloads ? handle.acquire() : pinned;
+    if (current != indexed) {
+      if (cache != NULL) cache->clear();
+      delete names;
+      names = new nameIndex(directory, *current);
+      indexed = current;
+    }
+    string source = promptForActor("Actor or actress", *current, *names);
     if (source == "") break;
-    string target = promptForActor("Another actor or actress", db);
+    string target = promptForActor("Another actor or actress", *current, *names);
     if (target == "") break;
     if (source == target) {
       cout << "Good one.  This is only interesting if you specify two different people." << endl;
     } else {
       //getRandomPlayers(db);
-      path p = generateShortestPath(db, source, target);
+      queryOptions limits;
+      if (options.timeoutMillis > 0) limits.setTimeout(options.timeoutMillis);
+      limits.setMemoryBudget(size_t(options.memoryMiB) << 20);
+      interrupted.reset();
+      limits.setCancellation(&interrupted);
+      signal(SIGINT, interruptQuery);
+
+      if (listAll) {
+        if (compact) listShortestPaths(*compactPaths, *current, source, target, options.pathLimit, filter, options.alternatives, limits);
+        else listShortestPaths(*paths, *current, source, target, options.pathLimit, filter, options.alternatives, limits);
+        signal(SIGINT, SIG_DFL);
+        continue;
+      }
+      if (weighted) {
+        uint64_t total;
+        queryStatus status;
+        path p = compact ? (recentCost ? generateCheapestPath(*compactWeighted, *current, source, target, *recentCost, filter, limits, status, total)
+                                       : generateCheapestPath(*compactWeighted, *current, source, target, *castCost, filter, limits, status, total))
+                         : (recentCost ? generateCheapestPath(*rawWeighted, *current, source, target, *recentCost, filter, limits, status, total)
+                                       : generateCheapestPath(*rawWeighted, *current, source, target, *castCost, filter, limits, status, total));
+        signal(SIGINT, SIG_DFL);
+        if (p.getLength() > 0) {
+          cout << endl << p;
+          if (options.alternatives) printAlternatives(p, *current);
+          cout << "(" << options.weight << " cost " << total << ")" << endl << endl;
+        } else {
+          reportNoPath(status);
+        }
+        continue;
+      }
+
+      queryStatus status;
+      path p("");
+      if (constrained) {
+        // constrainedSearch is only made over the raw files; the compressed graph is searched as is
+        p = compact ? generateShortestPath(*compactSearch, *current, source, target, filter, limits, status)
+                    : generateShortestPath(*constrainedSearch, *current, source, target, filter, limits, status);
+      } else if (cache != NULL) {
+        p = cachedShortestPath(*cache, *current, source, target, status, [&](queryStatus& searched) {
+          return compact ? generateShortestPath(*compactSearch, *current, source, target, filter, limits, searched)
+                         : generateShortestPath(*current, source, target, limits, searched, arena);
+        });
+      } else {
+        p = compact ? generateShortestPath(*compactSearch, *current, source, target, filter, limits, status)
+                    : generateShortestPath(*current, source, target, limits, status, arena);
+      }
+      arena.reset();
+      signal(SIGINT, SIG_DFL);
       if (p.getLength() > 0) {
-        cout << endl << p << endl;
+        cout << endl << p;
+        if (options.alternatives) printAlternatives(p, *current);
+        cout << endl;
       } else {
-        cout << endl << "No path between those two people could be found." << endl << endl;
+        reportNoPath(status);
       }
     }
   }
   
+  delete names;
+  delete compactSearch;
+  delete constrainedSearch;
+  delete compactPaths;
+  delete paths;
+  delete compactWeighted;
+  delete rawWeighted;
+  delete recentCost;
+  delete castCost;
+  delete filter;
+  delete years;
+  if (cache != NULL) {
+    const pathCache::statistics cached = cache->getStatistics();
+    cout << "The path cache answered " << cached.hits << " of " << cached.hits + cached.misses << " searches." << endl;
+    delete cache;
+  }
   cout << "Thanks for playing!" << endl;
   return 0;
 }
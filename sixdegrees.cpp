@@ -0,0 +1,245 @@
+using namespace std;
+#include <string.h>
+#include <limits.h>
+#include <new>
+#include "sixdegrees.h"
+#include "imdb.h"
+#include "compact-graph.h"
+#include "graph-search.h"
+#include "query-options.h"
+#include "bench-utils.h"
+
+/**
+ * The C handles are these structs, so nothing of imdb's or graphSearch's
+ * layout shows through the header.  No exception may cross into C, so
+ * everything that allocates is wrapped.
+ */
+struct sd_database {
+    imdb db;
+    const compactGraph *graph;  // NULL unless SD_COMPACT found a graph.vbyte matching the data files
+
+    sd_database(const char *directory, const int flags) :
+        db(directory, (flags & SD_IN_MEMORY) ? imdb::kInMemory : imdb::kFileMapped), graph(NULL) {}
+    ~sd_database() { delete graph; }
+};
+
+struct sd_search {
+    const sd_database *owner;
+    graphSearch<imdb> *overFiles;
+    graphSearch<compactGraph> *overGraph;
+    vector<int> hops;
+
+    sd_search(const sd_database *owner) : owner(owner), overFiles(NULL), overGraph(NULL) {}
+    ~sd_search() { delete overFiles; delete overGraph; }
+};
+
+namespace {
+
+bool isActor(const sd_database *db, const int32_t actor)
+{
+    return db != NULL && actor >= 1 && actor <= db->db.getActorCount();
+}
+
+bool isMovie(const sd_database *db, const int32_t movie)
+{
+    return db != NULL && movie >= 1 && movie <= db->db.getMovieCount();
+}
+
+void copyOut(const string& text, char *out, const size_t capacity, size_t *length)
+{
+    if (length != NULL) *length = text.size();
+    if (capacity == 0) return;
+    const size_t copied = min(text.size(), capacity - 1);
+    memcpy(out, text.data(), copied);
+    out[copied] = '\0';
+}
+
+sd_status copyIds(const vector<int>& ids, int32_t *out, const size_t capacity, size_t *count)
+{
+    *count = ids.size();
+    if (ids.size() > capacity) return SD_TOO_SMALL;
+    for (size_t i = 0; i < ids.size(); i++) out[i] = ids[i];
+    return SD_OK;
+}
+
+}
+
+int sd_api_version(void)
+{
+    return SD_API_VERSION;
+}
+
+const char *sd_status_string(const sd_status status)
+{
+    switch (status) {
+        case SD_OK: return "ok";
+        case SD_NOT_FOUND: return "not found";
+        case SD_NO_PATH: return "no path";
+        case SD_TIMED_OUT: return "timed out";
+        case SD_TOO_SMALL: return "buffer too small";
+        case SD_BAD_ARGUMENT: return "bad argument";
+        case SD_ERROR: return "internal error";
+    }
+    return "unknown status";
+}
+
+sd_database *sd_open(const char *directory, const int flags)
+{
+    if (directory == NULL) return NULL;
+    try {
+        sd_database *db = new sd_database(directory, flags);
+        if (!db->db.good()) {
+            delete db;
+            return NULL;
+        }
+        if (flags & SD_COMPACT) {
+            compactGraph *graph = new compactGraph(directory);
+            // a graph.vbyte built from other data files, or before the delta changed, is of no use
+            if (graph->good() && graph->getFingerprint() == db->db.getFingerprint()) db->graph = graph;
+            else delete graph;
+        }
+        return db;
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void sd_close(sd_database *db)
+{
+    delete db;
+}
+
+int32_t sd_actor_count(const sd_database *db)
+{
+    return db == NULL ? 0 : db->db.getActorCount();
+}
+
+int32_t sd_movie_count(const sd_database *db)
+{
+    return db == NULL ? 0 : db->db.getMovieCount();
+}
+
+int32_t sd_actor_id(const sd_database *db, const char *name)
+{
+    if (db == NULL || name == NULL) return 0;
+    try {
+        return db->db.getActorId(name);
+    } catch (...) {
+        return 0;
+    }
+}
+
+int32_t sd_movie_id(const sd_database *db, const char *title, const int32_t year)
+{
+    if (db == NULL || title == NULL) return 0;
+    try {
+        film movie;
+        movie.title = title;
+        movie.year = year;
+        return db->db.getMovieId(movie);
+    } catch (...) {
+        return 0;
+    }
+}
+
+sd_status sd_actor_name(const sd_database *db, const int32_t actor, char *name, const size_t capacity, size_t *length)
+{
+    if (!isActor(db, actor)) return SD_NOT_FOUND;
+    if (name == NULL && capacity > 0) return SD_BAD_ARGUMENT;
+    try {
+        copyOut(db->db.getActorName(actor), name, capacity, length);
+        return SD_OK;
+    } catch (...) {
+        return SD_ERROR;
+    }
+}
+
+sd_status sd_movie_title(const sd_database *db, const int32_t movie, char *title, const size_t capacity,
+                         size_t *length, int32_t *year)
+{
+    if (!isMovie(db, movie)) return SD_NOT_FOUND;
+    if (title == NULL && capacity > 0) return SD_BAD_ARGUMENT;
+    try {
+        const film found = db->db.getFilm(movie);
+        copyOut(found.title, title, capacity, length);
+        if (year != NULL) *year = found.year;
+        return SD_OK;
+    } catch (...) {
+        return SD_ERROR;
+    }
+}
+
+sd_status sd_credits(const sd_database *db, const int32_t actor, int32_t *movies, const size_t capacity, size_t *count)
+{
+    if (!isActor(db, actor)) return SD_NOT_FOUND;
+    if (count == NULL || (movies == NULL && capacity > 0)) return SD_BAD_ARGUMENT;
+    try {
+        vector<int> ids;
+        db->db.getCreditIds(actor, ids);
+        return copyIds(ids, movies, capacity, count);
+    } catch (...) {
+        return SD_ERROR;
+    }
+}
+
+sd_status sd_cast(const sd_database *db, const int32_t movie, int32_t *actors, const size_t capacity, size_t *count)
+{
+    if (!isMovie(db, movie)) return SD_NOT_FOUND;
+    if (count == NULL || (actors == NULL && capacity > 0)) return SD_BAD_ARGUMENT;
+    try {
+        vector<int> ids;
+        db->db.getCastIds(movie, ids);
+        return copyIds(ids, actors, capacity, count);
+    } catch (...) {
+        return SD_ERROR;
+    }
+}
+
+int32_t sd_random_actor(const sd_database *db, uint64_t *state)
+{
+    if (db == NULL || state == NULL || db->db.getActorCount() == 0) return 0;
+    return 1 + splitMix(*state) % db->db.getActorCount();
+}
+
+sd_search *sd_search_new(const sd_database *db)
+{
+    if (db == NULL) return NULL;
+    try {
+        sd_search *search = new sd_search(db);
+        if (db->graph != NULL) search->overGraph = new graphSearch<compactGraph>(*db->graph);
+        else search->overFiles = new graphSearch<imdb>(db->db);
+        return search;
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void sd_search_free(sd_search *search)
+{
+    delete search;
+}
+
+sd_status sd_shortest_path(sd_search *search, const int32_t source, const int32_t target, const int32_t maxDepth,
+                           const int64_t timeoutMillis, int32_t *hops, const size_t capacity, size_t *count)
+{
+    if (search == NULL || count == NULL || (hops == NULL && capacity > 0) || maxDepth < 0 || timeoutMillis < 0) {
+        return SD_BAD_ARGUMENT;
+    }
+    if (!isActor(search->owner, source) || !isActor(search->owner, target)) return SD_BAD_ARGUMENT;
+    try {
+        queryOptions options;
+        if (timeoutMillis > 0) options.setTimeout(min<int64_t>(timeoutMillis, INT_MAX));
+        const queryStatus status = search->overGraph != NULL
+            ? search->overGraph->shortestPath(source, target, maxDepth, search->hops, options)
+            : search->overFiles->shortestPath(source, target, maxDepth, search->hops, options);
+        *count = 0;
+        switch (status) {
+            case kPathFound: return copyIds(search->hops, hops, capacity, count);
+            case kNoPath: return SD_NO_PATH;
+            case kTimedOut: return SD_TIMED_OUT;
+            default: return SD_ERROR;
+        }
+    } catch (...) {
+        return SD_ERROR;
+    }
+}
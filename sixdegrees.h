@@ -0,0 +1,145 @@
+#ifndef __sixdegrees__
+#define __sixdegrees__
+
+/**
+ * libsixdegrees
+ * -------------
+ * The imdb lookups and the shortest path search, for programs that link
+ * them in rather than running six-degrees.  This is a C interface, so it
+ * can be called from C, or from C++ built with another compiler or
+ * standard library, or from anything with a C FFI; only these functions
+ * and types are exported from the shared library.
+ *
+ * An sd_database is opened once and shared: every function taking a
+ * const sd_database * may be called from any number of threads at once.
+ * A search keeps the visited marks of one search at a time, so each
+ * thread makes its own sd_search (cheap to reuse, costly to make: it
+ * allocates a few bytes per actor and movie).  Nothing in the library
+ * keeps global state; random draws take the caller's own state.
+ *
+ * Ids are as in the data files: actors 1 through sd_actor_count, movies
+ * 1 through sd_movie_count.  Functions that fill a caller's array take its
+ * capacity and always report the full count, returning SD_TOO_SMALL (with
+ * nothing written past the capacity) if it didn't fit.  Strings are
+ * copied out NUL-terminated, truncated to fit.
+ *
+ * SD_API_VERSION changes only when an existing function changes; see
+ * sd_api_version to check the library matches the header.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define SD_API __attribute__((visibility("default")))
+#else
+#define SD_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_API_VERSION 1
+
+typedef struct sd_database sd_database;
+typedef struct sd_search sd_search;
+
+typedef enum {
+  SD_OK = 0,
+  SD_NOT_FOUND,     /* no such actor or movie */
+  SD_NO_PATH,       /* the search finished without reaching the target */
+  SD_TIMED_OUT,     /* the search ran out of time first */
+  SD_TOO_SMALL,     /* the caller's array couldn't hold the result */
+  SD_BAD_ARGUMENT,
+  SD_ERROR          /* out of memory, or something else went wrong inside */
+} sd_status;
+
+/* sd_open flags */
+#define SD_IN_MEMORY 1  /* read the data files into (huge page backed) memory rather than mapping them */
+#define SD_COMPACT 2    /* search graph.vbyte (see graph-compress) instead of the data files, if it matches them */
+
+SD_API int sd_api_version(void);
+SD_API const char *sd_status_string(sd_status status);
+
+/**
+ * Function: sd_open
+ * -----------------
+ * @param directory the directory housing actors.data and movies.data
+ * @param flags SD_IN_MEMORY and SD_COMPACT, or'ed together, or 0
+ * @return the database, or NULL if the files couldn't be opened
+ */
+SD_API sd_database *sd_open(const char *directory, int flags);
+SD_API void sd_close(sd_database *db);
+
+SD_API int32_t sd_actor_count(const sd_database *db);
+SD_API int32_t sd_movie_count(const sd_database *db);
+
+/**
+ * Functions: sd_actor_id
+ *            sd_movie_id
+ * ----------------------
+ * @return the id of the actor or movie named, or 0 if there is none
+ */
+SD_API int32_t sd_actor_id(const sd_database *db, const char *name);
+SD_API int32_t sd_movie_id(const sd_database *db, const char *title, int32_t year);
+
+/**
+ * Functions: sd_actor_name
+ *            sd_movie_title
+ * -------------------------
+ * @param length set, if not NULL, to the full length of the name (without
+ *               the NUL), so a truncated one can be asked for again
+ * @param year set, if not NULL, to the movie's year
+ */
+SD_API sd_status sd_actor_name(const sd_database *db, int32_t actor, char *name, size_t capacity, size_t *length);
+SD_API sd_status sd_movie_title(const sd_database *db, int32_t movie, char *title, size_t capacity, size_t *length,
+                                int32_t *year);
+
+/**
+ * Functions: sd_credits
+ *            sd_cast
+ * ------------------
+ * The ids of an actor's movies, or of a movie's actors, in increasing order.
+ */
+SD_API sd_status sd_credits(const sd_database *db, int32_t actor, int32_t *movies, size_t capacity, size_t *count);
+SD_API sd_status sd_cast(const sd_database *db, int32_t movie, int32_t *actors, size_t capacity, size_t *count);
+
+/**
+ * Function: sd_random_actor
+ * -------------------------
+ * @param state the caller's generator state, advanced by the draw; seed
+ *              it with anything, and keep one per thread
+ * @return the id of an actor picked uniformly at random
+ */
+SD_API int32_t sd_random_actor(const sd_database *db, uint64_t *state);
+
+/**
+ * Function: sd_search_new
+ * -----------------------
+ * @return a search over db (which must outlive it), or NULL if it
+ *         couldn't be allocated
+ */
+SD_API sd_search *sd_search_new(const sd_database *db);
+SD_API void sd_search_free(sd_search *search);
+
+/**
+ * Function: sd_shortest_path
+ * --------------------------
+ * Finds a shortest path from source to target, at most max_depth movies
+ * long.  The path goes into hops as graphSearch produces it: movie, actor,
+ * movie, actor, ..., the last actor being target, so count is twice the
+ * number of movies.  A source equal to its target is a path of no hops.
+ *
+ * @param timeout_ms how long the search may take, or 0 for no limit
+ * @return SD_OK, SD_NO_PATH, SD_TIMED_OUT, SD_TOO_SMALL, or SD_BAD_ARGUMENT
+ *         for ids out of range
+ */
+SD_API sd_status sd_shortest_path(sd_search *search, int32_t source, int32_t target, int32_t max_depth,
+                                  int64_t timeout_ms, int32_t *hops, size_t capacity, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+using namespace std;
+#include <algorithm>
+#include "sorted-intersect.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SORTED_INTERSECT_SSE2 1
+#endif
+
+namespace {
+
+// the longer array must be this many times the shorter before galloping beats merging
+const size_t kGallopRatio = 32;
+
+template <typename T>
+size_t gallop(const T *small, size_t smallCount, const T *large, size_t largeCount, T *out)
+{
+    size_t found = 0, from = 0;
+    for (size_t i = 0; i < smallCount && from < largeCount; i++) {
+        const T value = small[i];
+        size_t step = 1;
+        while (from + step < largeCount && large[from + step] < value) step *= 2;
+        const T *at = lower_bound(large + from + step / 2, large + min(from + step + 1, largeCount), value);
+        from = at - large;
+        if (from < largeCount && *at == value) out[found++] = value;
+    }
+    return found;
+}
+
+template <typename T>
+size_t mergeScalar(const T *a, size_t aCount, const T *b, size_t bCount, T *out, size_t found)
+{
+    size_t i = 0, j = 0;
+    while (i < aCount && j < bCount) {
+        if (a[i] < b[j]) i++;
+        else if (b[j] < a[i]) j++;
+        else {
+            out[found++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return found;
+}
+
+template <typename T>
+size_t merge(const T *a, size_t aCount, const T *b, size_t bCount, T *out)
+{
+    return mergeScalar(a, aCount, b, bCount, out, 0);
+}
+
+#ifdef SORTED_INTERSECT_SSE2
+// compares every value of a block of four from a against all four of a block from b,
+// then moves on past whichever block ends lower (both, if they end alike)
+template <>
+size_t merge<int32_t>(const int32_t *a, size_t aCount, const int32_t *b, size_t bCount, int32_t *out)
+{
+    size_t i = 0, j = 0, found = 0;
+    while (i + 4 <= aCount && j + 4 <= bCount) {
+        const __m128i blockA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i blockB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_cmpeq_epi32(blockA, blockB);
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(0, 3, 2, 1))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(1, 0, 3, 2))));
+        equal = _mm_or_si128(equal, _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(2, 1, 0, 3))));
+        for (int mask = _mm_movemask_ps(_mm_castsi128_ps(equal)); mask != 0; mask &= mask - 1) {
+            out[found++] = a[i + __builtin_ctz(mask)];
+        }
+
+        const int32_t lastA = a[i + 3], lastB = b[j + 3];
+        if (lastA <= lastB) i += 4;
+        if (lastB <= lastA) j += 4;
+    }
+    return mergeScalar(a + i, aCount - i, b + j, bCount - j, out, found);
+}
+#endif
+
+template <typename T>
+size_t intersect(const T *a, size_t aCount, const T *b, size_t bCount, T *out)
+{
+    if (aCount > bCount) {
+        swap(a, b);
+        swap(aCount, bCount);
+    }
+    if (aCount == 0) return 0;
+    if (bCount / aCount >= kGallopRatio) return gallop(a, aCount, b, bCount, out);
+    return merge(a, aCount, b, bCount, out);
+}
+
+}
+
+size_t intersectSorted(const int32_t *a, size_t aCount, const int32_t *b, size_t bCount, int32_t *out)
+{
+    return intersect(a, aCount, b, bCount, out);
+}
+
+size_t intersectSorted(const int64_t *a, size_t aCount, const int64_t *b, size_t bCount, int64_t *out)
+{
+    return intersect(a, aCount, b, bCount, out);
+}
@@ -0,0 +1,23 @@
+#ifndef __sorted_intersect__
+#define __sorted_intersect__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Function: intersectSorted
+ * -------------------------
+ * Writes the values two ascending, duplicate free arrays have in common to
+ * out (which must have room for the shorter of the two), in ascending order.
+ * When one array is dozens of times longer than the other, each value of the
+ * short one is galloped for (an exponential then a binary search, starting
+ * where the last one was found), so the cost follows the short array.
+ * Otherwise the two are merged, four values against four at a time with SSE2
+ * where the CPU has it (the 4-byte version only).
+ *
+ * @return the number of values written to out
+ */
+size_t intersectSorted(const int32_t *a, size_t aCount, const int32_t *b, size_t bCount, int32_t *out);
+size_t intersectSorted(const int64_t *a, size_t aCount, const int64_t *b, size_t bCount, int64_t *out);
+
+#endif
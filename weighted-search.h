@@ -0,0 +1,257 @@
+#ifndef __weighted_search__
+#define __weighted_search__
+
+#include "radix-heap.h"
+#include "search-filter.h"
+#include "query-options.h"
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: weightedSearch
+ * ---------------------
+ * Dijkstra's algorithm for the cheapest path between two actors, where
+ * going through a movie costs whatever a cost function says it does
+ * rather than 1.  Cost is any function object with
+ *
+ *     unsigned operator()(const int movieId) const;
+ *
+ * returning a cost of at least 1, such as recentFilmCost or smallCastCost
+ * below.  Every costar of a movie is the same price away, so the first
+ * time an actor is settled the movie is settled too, with all of its cast
+ * relaxed at once, and the movie is never looked at again.  Tentative
+ * distances go through a radixHeap, and stale entries are skipped when
+ * popped instead of being decreased in place.
+ *
+ * Graph is anything graphSearch can search, and the visited marks are
+ * stamped per search, as they are there.  A searchFilter keeps it to the
+ * movies and actors it allows, and queryOptions bound a search, the same
+ * way they do graphSearch's, the heap standing in for its frontier.
+ */
+
+template <typename Graph>
+class weightedSearch {
+
+ public:
+
+  /**
+   * Constructor: weightedSearch
+   * ---------------------------
+   * @param graph the adjacency to search; it must outlive the weightedSearch
+   */
+  weightedSearch(const Graph& graph) : graph(graph), stamp(0),
+    actorSeen(graph.getActorCount() + 1, 0), movieSettled(graph.getMovieCount() + 1, 0),
+    actorDistance(graph.getActorCount() + 1, 0), actorVia(graph.getActorCount() + 1, 0),
+    movieVia(graph.getMovieCount() + 1, 0) {}
+
+  /**
+   * Method: cheapestPath
+   * --------------------
+   * @param source the id of the starting actor
+   * @param target the id of the actor being searched for
+   * @param cost the price of going through each movie
+   * @param hops cleared and filled with the path as alternating movie and actor ids,
+   *             ending with target.  Left empty if there is no path.
+   * @param total set to the summed cost of the movies on the path
+   * @return true if and only if the two are connected at all
+   */
+  template <typename Cost>
+  bool cheapestPath(const int source, const int target, const Cost& cost, vector<int>& hops, uint64_t& total)
+  {
+    return search(source, target, cost, hops, total, noFilter(), noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: cheapestPath
+   * --------------------
+   * As above, but only through the movies and actors the filter allows.
+   */
+  template <typename Cost>
+  bool cheapestPath(const int source, const int target, const Cost& cost, vector<int>& hops, uint64_t& total,
+                    const searchFilter& filter)
+  {
+    return filteredSearch(source, target, cost, hops, total, filter, noLimits()) == kPathFound;
+  }
+
+  /**
+   * Method: cheapestPath
+   * --------------------
+   * Either of the above, but giving up once the options say so.
+   *
+   * @return kPathFound, kNoPath, or why the search was given up
+   */
+  template <typename Cost>
+  queryStatus cheapestPath(const int source, const int target, const Cost& cost, vector<int>& hops,
+                           uint64_t& total, const queryOptions& options)
+  {
+    return search(source, target, cost, hops, total, noFilter(), options);
+  }
+
+  template <typename Cost>
+  queryStatus cheapestPath(const int source, const int target, const Cost& cost, vector<int>& hops,
+                           uint64_t& total, const searchFilter& filter, const queryOptions& options)
+  {
+    return filteredSearch(source, target, cost, hops, total, filter, options);
+  }
+
+ private:
+  const Graph& graph;
+  unsigned stamp;
+  vector<unsigned> actorSeen, movieSettled;
+  vector<uint64_t> actorDistance;
+  vector<int> actorVia, movieVia;
+  vector<int> credits, cast;
+  radixHeap queue;
+
+  // edges looked at between checks of the query options
+  static constexpr size_t kCheckInterval = 1 << 16;
+
+  // lets the unfiltered search compile without any of the filter's tests
+  struct noFilter {
+    bool allowsMovie(const int) const { return true; }
+    bool allowsActor(const int) const { return true; }
+  };
+
+  // and the unbounded search without any of the options' checks
+  struct noLimits {
+    queryStatus check(const size_t) const { return kSearching; }
+  };
+
+  template <typename Cost, typename Limits>
+  queryStatus filteredSearch(const int source, const int target, const Cost& cost, vector<int>& hops,
+                             uint64_t& total, const searchFilter& filter, const Limits& limits)
+  {
+    hops.clear();
+    total = 0;
+    if (!filter.allowsActor(source) || !filter.allowsActor(target)) return kNoPath;
+    return search(source, target, cost, hops, total, filter, limits);
+  }
+
+  template <typename Cost, typename Filter, typename Limits>
+  queryStatus search(const int source, const int target, const Cost& cost, vector<int>& hops, uint64_t& total,
+                     const Filter& filter, const Limits& limits)
+  {
+    hops.clear();
+    total = 0;
+    if (++stamp == 0) resetStamps();
+
+    queue.clear();
+    reach(source, 0, 0);
+    queue.push(0, source);
+    size_t work = 0, nextCheck = kCheckInterval;
+    while (!queue.empty()) {
+      const pair<uint64_t, int> next = queue.pop();
+      const int actor = next.second;
+      if (next.first != actorDistance[actor]) continue; // superseded by a cheaper entry
+      if (actor == target) {
+        total = next.first;
+        tracePath(source, target, hops);
+        return kPathFound;
+      }
+
+      graph.getCreditIds(actor, credits);
+      for (size_t f = 0; f < credits.size(); ++f) {
+        const int movie = credits[f];
+        if (movieSettled[movie] == stamp || !filter.allowsMovie(movie)) continue;
+        movieSettled[movie] = stamp;
+        movieVia[movie] = actor;
+
+        const uint64_t distance = next.first + cost(movie);
+        graph.getCastIds(movie, cast);
+        for (size_t p = 0; p < cast.size(); ++p) {
+          const int costar = cast[p];
+          if (!filter.allowsActor(costar)) continue;
+          if (actorSeen[costar] == stamp && actorDistance[costar] <= distance) continue;
+          reach(costar, distance, movie);
+          queue.push(distance, costar);
+        }
+
+        if ((work += cast.size()) >= nextCheck) {
+          nextCheck = work + kCheckInterval;
+          const queryStatus status = limits.check(queue.size() * sizeof(pair<uint64_t, int>));
+          if (status != kSearching) return status;
+        }
+      }
+    }
+    return kNoPath;
+  }
+
+  void reach(const int actor, const uint64_t distance, const int movie)
+  {
+    actorSeen[actor] = stamp;
+    actorDistance[actor] = distance;
+    actorVia[actor] = movie;
+  }
+
+  void tracePath(const int source, const int target, vector<int>& hops) const
+  {
+    for (int actor = target; actor != source; actor = movieVia[actorVia[actor]]) {
+      hops.push_back(actor);
+      hops.push_back(actorVia[actor]);
+    }
+    reverse(hops.begin(), hops.end());
+  }
+
+  void resetStamps()
+  {
+    fill(actorSeen.begin(), actorSeen.end(), 0);
+    fill(movieSettled.begin(), movieSettled.end(), 0);
+    stamp = 1;
+  }
+
+  weightedSearch(const weightedSearch& original);
+  weightedSearch& operator=(const weightedSearch& rhs);
+};
+
+/**
+ * Class: recentFilmCost
+ * ---------------------
+ * Prefers recent films: a movie costs one more than its age in years,
+ * counted from the newest movie in the database.
+ */
+
+class recentFilmCost {
+
+ public:
+  recentFilmCost(const movieYears& years) : years(years), newest(0)
+  {
+    for (int movie = 1; movie <= years.getMovieCount(); ++movie) newest = max(newest, years.getYear(movie));
+  }
+
+  unsigned operator()(const int movieId) const { return 1 + newest - years.getYear(movieId); }
+
+ private:
+  const movieYears& years;
+  int newest;
+};
+
+/**
+ * Class: smallCastCost
+ * --------------------
+ * Prefers small casts, whose members are more likely to actually know each
+ * other: a movie costs the number of people in it.  The cast sizes are
+ * counted once, up front.
+ */
+
+class smallCastCost {
+
+ public:
+  template <typename Graph>
+  smallCastCost(const Graph& graph) : castSizes(graph.getMovieCount() + 1, 0)
+  {
+    vector<int> cast;
+    for (int movie = 1; movie <= graph.getMovieCount(); ++movie) {
+      graph.getCastIds(movie, cast);
+      castSizes[movie] = cast.size();
+    }
+  }
+
+  unsigned operator()(const int movieId) const { return castSizes[movieId]; }
+
+ private:
+  vector<unsigned> castSizes;
+};
+
+#endif
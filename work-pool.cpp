@@ -0,0 +1,114 @@
+using namespace std;
+#include "work-pool.h"
+
+namespace {
+
+// which pool, and which of its workers, the current thread is (if any)
+thread_local const void *currentPool = NULL;
+thread_local int currentWorker = -1;
+
+}
+
+workStealingPool::workStealingPool(const int threads) :
+    queues(threads), queued(0), unfinished(0), tasksRun(0), steals(0), nextQueue(0), stopping(false)
+{
+    for (int worker = 0; worker < threads; worker++) {
+        workers.push_back(thread(&workStealingPool::work, this, worker));
+    }
+}
+
+workStealingPool::~workStealingPool()
+{
+    {
+        lock_guard<mutex> hold(idleLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+int workStealingPool::getThreadCount() const
+{
+    return queues.size();
+}
+
+void workStealingPool::submit(const task& work)
+{
+    const int home = currentPool == this ? currentWorker : nextQueue.fetch_add(1) % queues.size();
+    unfinished++;
+    {
+        lock_guard<mutex> hold(queues[home].lock);
+        queues[home].tasks.push_back(work);
+    }
+    queued++;
+
+    // taking idleLock orders this against a worker deciding to sleep
+    lock_guard<mutex> hold(idleLock);
+    workAvailable.notify_one();
+}
+
+void workStealingPool::wait()
+{
+    unique_lock<mutex> hold(idleLock);
+    allDone.wait(hold, [this]() { return unfinished == 0; });
+}
+
+uint64_t workStealingPool::getTasksRun() const
+{
+    return tasksRun;
+}
+
+uint64_t workStealingPool::getSteals() const
+{
+    return steals;
+}
+
+void workStealingPool::work(const int worker)
+{
+    currentPool = this;
+    currentWorker = worker;
+    task next;
+    while (true) {
+        if (takeTask(worker, next)) {
+            next(worker);
+            next = task();
+            tasksRun++;
+            if (--unfinished == 0) {
+                lock_guard<mutex> hold(idleLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> hold(idleLock);
+        workAvailable.wait(hold, [this]() { return queued > 0 || stopping; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+/**
+ * Method: takeTask
+ * ----------------
+ * The newest task on the worker's own deque, or failing that the oldest on
+ * someone else's, starting with its neighbour so thieves spread out.
+ */
+bool workStealingPool::takeTask(const int worker, task& next)
+{
+    const int count = queues.size();
+    for (int i = 0; i < count; i++) {
+        workerQueue& victim = queues[(worker + i) % count];
+        lock_guard<mutex> hold(victim.lock);
+        if (victim.tasks.empty()) continue;
+        if (i == 0) {
+            next = move(victim.tasks.back());
+            victim.tasks.pop_back();
+        } else {
+            next = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals++;
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
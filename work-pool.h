@@ -0,0 +1,90 @@
+#ifndef __work_pool__
+#define __work_pool__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * Class: workStealingPool
+ * -----------------------
+ * A fixed set of worker threads, each with its own deque of tasks.  A
+ * worker takes its newest task first (the one it most likely has in
+ * cache), and a worker with nothing left steals the oldest task of
+ * another, which for tasks that split themselves is the biggest piece
+ * going.  Tasks are told which worker runs them, so they can keep scratch
+ * space and partial results per worker rather than share them.
+ *
+ * Tasks submitted by a worker go on its own deque; tasks submitted from
+ * outside are dealt round robin.  Tasks must not throw.
+ */
+
+class workStealingPool {
+
+ public:
+  typedef function<void(int worker)> task;
+
+  /**
+   * Constructor: workStealingPool
+   * -----------------------------
+   * Starts the workers; they idle until given tasks.
+   */
+  workStealingPool(const int threads);
+  ~workStealingPool();
+
+  int getThreadCount() const;
+
+  /**
+   * Method: submit
+   * --------------
+   * Queues a task.  Safe to call from any thread, including from a task.
+   */
+  void submit(const task& work);
+
+  /**
+   * Method: wait
+   * ------------
+   * Blocks until every task submitted so far, and every task those
+   * submitted in turn, has run.  Not to be called from a task.
+   */
+  void wait();
+
+  /**
+   * Methods: getTasksRun
+   *          getSteals
+   * ------------------
+   * Totals since the pool started, for reports.
+   */
+  uint64_t getTasksRun() const;
+  uint64_t getSteals() const;
+
+ private:
+  struct workerQueue {
+    mutex lock;
+    deque<task> tasks;
+  };
+
+  vector<workerQueue> queues;
+  vector<thread> workers;
+  atomic<int> queued;           // tasks sitting in the deques
+  atomic<int> unfinished;       // tasks submitted and not yet run to completion
+  atomic<uint64_t> tasksRun, steals;
+  atomic<unsigned> nextQueue;   // round robin for submissions from outside
+  bool stopping;
+  mutex idleLock;
+  condition_variable workAvailable, allDone;
+
+  void work(const int worker);
+  bool takeTask(const int worker, task& next);
+
+  workStealingPool(const workStealingPool& original);
+  workStealingPool& operator=(const workStealingPool& rhs);
+};
+
+#endif